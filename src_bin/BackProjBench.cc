@@ -0,0 +1,196 @@
+#include <LORList.h>
+#include <ScannerData.h>
+#include <console.h>
+#include <macros.h>
+#include <projections.h>
+#include <tools.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// Compare the back-projection times with atomic, private and
+// scheduled accumulation, and with atomic accumulation of the
+// LORs in locality order
+// Input 1: Input projection header file
+// Input 2: Scanner file
+// Input 3: Output volume template header file
+// Input 4 (optional): Number of repetitions (defaults to 3)
+// Input 5 (optional): Memory budget of private accumulation in
+// MB (defaults to 0, no limit)
+
+// Best time of the back-projections in s
+static double timeBackward(
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  int nRepeats,
+  projections::Accumulation accumulation,
+  double maxMemoryMB,
+  const LORList& lorList)
+{
+  auto bestTime = 0.0;
+
+  LOOP(repeat, 0, nRepeats - 1)
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    projections::backward(
+      inputProj,
+      scanner,
+      outputVol,
+      1,
+      nullptr,
+      projections::Projector::PACKET,
+      accumulation,
+      maxMemoryMB,
+      0,
+      &lorList);
+
+    const std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+
+    bestTime = repeat == 0 ? time.count() :
+                             MIN(bestTime, time.count());
+  }
+
+  return bestTime;
+}
+
+// Maximum difference relative to the maximum voxel value
+static double maxRelativeDifference(
+  const VolData& reference,
+  const VolData& vol)
+{
+  double maxDiff{0.0};
+  double maxValue{0.0};
+
+  LOOP(i, 0, reference.getNVoxelsPerFrame() - 1)
+  {
+    const double referenceValue = reference.getDataArray()[i];
+    const double value = vol.getDataArray()[i];
+
+    maxDiff = MAX(maxDiff, ABS(referenceValue - value));
+    maxValue = MAX(maxValue, ABS(referenceValue));
+  }
+
+  return maxValue > 0.0 ? maxDiff / maxValue : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    if (argc < 4)
+    {
+      error("Requires at least three input arguments");
+    }
+
+    const auto nRepeats = argc > 4 ? std::atoi(argv[4]) : 3;
+    const auto maxMemoryMB =
+      argc > 5 ? std::atof(argv[5]) : 0.0;
+
+    if (nRepeats < 1)
+    {
+      error("Number of repetitions must be positive");
+    }
+
+    // Initialize input projection
+    ProjData inputProj(
+      argv[1],
+      ProjData::ConstructionMode::READ_DATA);
+
+    // Initialize scanner
+    ScannerData scanner(argv[2]);
+
+    // Initialize output volumes
+    VolData atomicVol(
+      argv[3],
+      VolData::ConstructionMode::ALLOCATE);
+    VolData privateVol(
+      argv[3],
+      VolData::ConstructionMode::ALLOCATE);
+    VolData scheduledVol(
+      argv[3],
+      VolData::ConstructionMode::ALLOCATE);
+    VolData orderedVol(
+      argv[3],
+      VolData::ConstructionMode::ALLOCATE);
+
+    // LOR lists computed once, out of the timings
+    const LORList lorList(inputProj, scanner, atomicVol, 1);
+    const LORList orderedLORList(
+      inputProj,
+      scanner,
+      atomicVol,
+      1,
+      0.0,
+      LORList::Ordering::MORTON);
+
+    const auto atomicTime = timeBackward(
+      inputProj,
+      scanner,
+      atomicVol,
+      nRepeats,
+      projections::Accumulation::ATOMIC,
+      0.0,
+      lorList);
+
+    const auto privateTime = timeBackward(
+      inputProj,
+      scanner,
+      privateVol,
+      nRepeats,
+      projections::Accumulation::PRIVATE,
+      maxMemoryMB,
+      lorList);
+
+    const auto scheduledTime = timeBackward(
+      inputProj,
+      scanner,
+      scheduledVol,
+      nRepeats,
+      projections::Accumulation::SCHEDULED,
+      0.0,
+      lorList);
+
+    const auto orderedTime = timeBackward(
+      inputProj,
+      scanner,
+      orderedVol,
+      nRepeats,
+      projections::Accumulation::ATOMIC,
+      0.0,
+      orderedLORList);
+
+    echo("=== Back-projection benchmark");
+    printValue("Number of threads", getNThreads());
+    printValue("Number of repetitions", nRepeats);
+    printValue("Atomic accumulation time (s)", atomicTime);
+    printValue("Private accumulation time (s)", privateTime);
+    printValue("Private speedup", atomicTime / privateTime);
+    printValue(
+      "Private max relative difference",
+      maxRelativeDifference(atomicVol, privateVol));
+    printValue(
+      "Scheduled accumulation time (s)",
+      scheduledTime);
+    printValue("Scheduled speedup", atomicTime / scheduledTime);
+    printValue(
+      "Scheduled max relative difference",
+      maxRelativeDifference(atomicVol, scheduledVol));
+    printValue("Ordered atomic time (s)", orderedTime);
+    printValue("Ordered speedup", atomicTime / orderedTime);
+    printValue(
+      "Ordered max relative difference",
+      maxRelativeDifference(atomicVol, orderedVol));
+    printEmptyLine();
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << ex.what();
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
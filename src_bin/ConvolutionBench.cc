@@ -0,0 +1,168 @@
+#include <GaussianFilter.h>
+#include <VolData.h>
+#include <console.h>
+#include <macros.h>
+#include <tools.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compare the gaussian filtering times of the direct, recursive
+// and FFT backends for kernels of increasing FWHM
+// Input 1: Volume template header file (filled with
+// pseudo-random values)
+// Input 2 (optional): Number of repetitions (defaults to 3)
+// Input 3... (optional): FWHM of the kernels in mm, the same in
+// X, Y and Z (defaults to 2 4 8 16 32)
+
+// Best time of the filtering in s, the filter being set up out
+// of the timing
+static double timeFilter(
+  const VolData& inputVol,
+  VolData& outputVol,
+  float fwhm,
+  int nRepeats,
+  GaussianFilter::Backend backend)
+{
+  GaussianFilter filter(
+    outputVol,
+    {fwhm, fwhm, fwhm},
+    0.0,
+    backend);
+
+  auto bestTime = 0.0;
+
+  LOOP(repeat, 0, nRepeats - 1)
+  {
+    outputVol.assign(inputVol);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    filter.apply(outputVol);
+
+    const std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+
+    bestTime = repeat == 0 ? time.count() :
+                             MIN(bestTime, time.count());
+  }
+
+  return bestTime;
+}
+
+// Maximum difference relative to the maximum voxel value
+static double maxRelativeDifference(
+  const VolData& reference,
+  const VolData& vol)
+{
+  double maxDiff{0.0};
+  double maxValue{0.0};
+
+  LOOP(i, 0, reference.getNVoxelsPerFrame() - 1)
+  {
+    const double referenceValue = reference.getDataArray()[i];
+    const double value = vol.getDataArray()[i];
+
+    maxDiff = MAX(maxDiff, ABS(referenceValue - value));
+    maxValue = MAX(maxValue, ABS(referenceValue));
+  }
+
+  return maxValue > 0.0 ? maxDiff / maxValue : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    if (argc < 2)
+    {
+      error("Requires at least one input argument");
+    }
+
+    const auto nRepeats = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    if (nRepeats < 1)
+    {
+      error("Number of repetitions must be positive");
+    }
+
+    std::vector<float> fwhms;
+    LOOP(arg, 3, argc - 1)
+    {
+      fwhms.push_back(std::atof(argv[arg]));
+    }
+    if (fwhms.empty())
+    {
+      fwhms = {2.0, 4.0, 8.0, 16.0, 32.0};
+    }
+
+    // Input volume
+    VolData inputVol(
+      argv[1],
+      VolData::ConstructionMode::ALLOCATE);
+    std::srand(1);
+    LOOP(i, 0, inputVol.getNVoxelsPerFrame() - 1)
+    {
+      inputVol.getDataArray()[i] =
+        (types::VoxelValue)std::rand() / RAND_MAX;
+    }
+
+    VolData directVol(
+      inputVol,
+      VolData::ConstructionMode::ALLOCATE);
+    VolData recursiveVol(
+      inputVol,
+      VolData::ConstructionMode::ALLOCATE);
+    VolData fftVol(
+      inputVol,
+      VolData::ConstructionMode::ALLOCATE);
+
+    echo("=== Convolution benchmark");
+    printValue("Number of threads", getNThreads());
+    printValue("Number of repetitions", nRepeats);
+    printEmptyLine();
+
+    for (const auto fwhm : fwhms)
+    {
+      const auto directTime = timeFilter(
+        inputVol,
+        directVol,
+        fwhm,
+        nRepeats,
+        GaussianFilter::Backend::DIRECT);
+      const auto recursiveTime = timeFilter(
+        inputVol,
+        recursiveVol,
+        fwhm,
+        nRepeats,
+        GaussianFilter::Backend::RECURSIVE);
+      const auto fftTime = timeFilter(
+        inputVol,
+        fftVol,
+        fwhm,
+        nRepeats,
+        GaussianFilter::Backend::FFT);
+
+      printValue("FWHM in mm", fwhm);
+      printValue("Direct time (s)", directTime);
+      printValue("Recursive time (s)", recursiveTime);
+      printValue(
+        "Recursive max relative difference",
+        maxRelativeDifference(directVol, recursiveVol));
+      printValue("FFT time (s)", fftTime);
+      printValue(
+        "FFT max relative difference",
+        maxRelativeDifference(directVol, fftVol));
+      printEmptyLine();
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << ex.what();
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include <ScannerData.h>
 #include <VolData.h>
 #include <console.h>
+#include <macros.h>
 #include <operations.h>
 #include <projections.h>
 #include <tools.h>
@@ -71,32 +72,65 @@ int main(int argc, char** argv)
     // Initialize scanner
     ScannerData scanner(params.scannerFile);
 
-    // Initialize output projection
-    ProjData outputProj(
-      params.outputProjHeader,
-      ProjData::ConstructionMode::ALLOCATE);
-
+    // Apply mask if provided
     for (const auto frameIndex : params.frames)
     {
       inputVol.setActiveFrame(frameIndex);
 
-      // Apply mask if provided
       if (maskVol.has_value())
       {
         operations::applyMask(inputVol, *maskVol);
       }
+    }
 
-      // Execute forward projection
-      projections::forward(inputVol, scanner, outputProj);
+    if (singleFrame)
+    {
+      ProjData outputProj(
+        params.outputProjHeader,
+        ProjData::ConstructionMode::ALLOCATE);
+
+      // Execute forward projection, skipping the LORs
+      // crossing zero voxels only (same projection)
+      inputVol.setActiveFrame(params.frames[0]);
+      projections::forward(
+        inputVol,
+        scanner,
+        outputProj,
+        nullptr,
+        projections::Projector::PACKET,
+        0,
+        nullptr,
+        true);
+
+      outputProj.write(params.outputProjFileName);
+      return EXIT_SUCCESS;
+    }
 
-      // Get name for saved projection
-      const auto outputProjFileName = singleFrame ?
-        params.outputProjFileName :
-        params.outputProjFileName + "_frame_" +
-          std::to_string(frameIndex);
+    // Frames projected at once, each LOR being traced once
+    const int nFrames = params.frames.size();
+
+    VolData framesVol;
+    framesVol.allocateAsMultiVol(inputVol, nFrames);
 
-      // Save projection
-      outputProj.write(outputProjFileName);
+    std::vector<ProjData> outputProjs;
+    LOOP(frame, 0, nFrames - 1)
+    {
+      framesVol.setActiveFrame(frame);
+      framesVol.assignFrame(inputVol, params.frames[frame]);
+
+      outputProjs.emplace_back(
+        params.outputProjHeader,
+        ProjData::ConstructionMode::ALLOCATE);
+    }
+
+    projections::forwardFrames(framesVol, scanner, outputProjs);
+
+    // Save projections
+    LOOP(frame, 0, nFrames - 1)
+    {
+      outputProjs[frame].write(
+        params.outputProjFileName + "_frame_" +
+        std::to_string(params.frames[frame]));
     }
   }
   catch (const std::exception& ex)
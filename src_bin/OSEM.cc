@@ -1,6 +1,11 @@
+#include <GaussianFilter.h>
 #include <KeyParser.h>
+#include <LORList.h>
+#include <PrecomputationCache.h>
 #include <ProjData.h>
 #include <ScannerData.h>
+#include <SensitivityStore.h>
+#include <SystemMatrix.h>
 #include <VolData.h>
 #include <console.h>
 #include <operations.h>
@@ -12,6 +17,7 @@
 #include <iostream>
 #include <optional>
 #include <string>
+#include <vector>
 
 // Notes on parameter file:
 //
@@ -56,6 +62,16 @@
 //     saved if 'attenuation volume file' is provided. This
 //     should be done if the scanner or number of subsets is
 //     changed from the last time sensitivity was computed.
+//    -Parameter "sensitivity storage" sets how the map of each
+//     subset is kept during the reconstruction: "half" or
+//     "scaled" keep it in 16 bits per voxel (half floats or
+//     integers scaled to the maximum of each subset), "lazy"
+//     keeps nothing and computes the map of a subset when it is
+//     used (the sensitivity file is then ignored). Defaults to
+//     "full". Not used with a PSF kernel volume.
+//    -Parameter "sensitivity cached frames" sets the number of
+//     subset maps decoded or computed at once with those
+//     storages (defaults to 1).
 //
 // 5: -Volume provided by parameter "attenuation volume in HU"
 //     does not have to be the same size as the output volume.
@@ -67,6 +83,96 @@
 // 6: -Projection provided by parameter "bias projection" must
 //     have the same dimensions as the input projection.
 //    -If absent, no bias is added to the projection.
+//
+// 7: -If parameter "use system matrix" is 1, the paths of all
+//     LORs are computed once and kept in memory instead of
+//     being traced at each iteration (defaults to 0).
+//    -Parameter "system matrix memory budget in MB" limits the
+//     memory used. LORs left out are traced at each iteration.
+//     Defaults to 0 (no limit).
+//    -If parameter "system matrix file" is provided, the
+//     matrix is read from that file if it was computed for the
+//     same configuration, and computed and saved to that file
+//     otherwise.
+//
+// 8: -If parameter "use factorized projector" is 1, the
+//     transaxial path of each view and tangential coordinate is
+//     traced once and reused for all axial coordinates and
+//     segments (defaults to 0).
+//    -If parameter "use symmetric projector" is 1, the same is
+//     done for the LORs that aren't the images of other LORs
+//     by a rotation or a mirror of the scanner only, and their
+//     paths are mapped to the other LORs (defaults to 0). The
+//     system matrix then only stores the paths of those LORs.
+//    -Parameter "packets per tile" sets the number of packets
+//     of LORs taken at once by a thread with the default
+//     projector. Threads steal tiles from each other across
+//     all segments. Defaults to 0 (16 packets).
+//    -If parameter "use ray cache" is 1, the setup of each LOR
+//     (entry and exit points, entry voxel, steps) is computed
+//     once and kept in memory, so that the default projector
+//     starts straight at the voxel walk (defaults to 0). Not
+//     used with scheduled accumulation.
+//    -Parameter "ray cache memory budget in MB" limits the
+//     memory used. LORs left out are set up at each iteration.
+//     Defaults to 0 (no limit).
+//    -If parameter "use locality ordering" is 1, the default
+//     projector takes the LORs of each subset in the Morton
+//     order of their view and middle voxel instead of the
+//     order of the bins, for better cache reuse (defaults to
+//     0).
+//
+// 9: -If parameter "use private accumulation" is 1, each thread
+//     back-projects into a volume of its own without atomics,
+//     the volumes being summed after each sub-iteration
+//     (defaults to 0).
+//    -Parameter "accumulation memory budget in MB" limits the
+//     memory of those volumes. Threads left out use atomics.
+//     Defaults to 0 (no limit).
+//    -If parameter "use scheduled accumulation" is 1, the LORs
+//     are instead back-projected in groups crossing disjoint
+//     slices, without atomics nor extra volumes (defaults to
+//     0).
+//
+// 10: -Parameter "convolution backend" sets how the gaussian
+//     kernels are applied: "direct" sums shifted rows,
+//     "recursive" approximates the gaussian with a recursive
+//     filter and "FFT" convolves in the frequency domain, the
+//     last two at a cost independent of the kernel size.
+//     Defaults to "auto" (recursive for kernels of more than 10
+//     voxels on a side, direct otherwise).
+//    -If parameter "PSF kernel volume" is provided,
+//     reconstruction uses resolution recovery with that
+//     measured kernel (odd number of voxels on each side, of
+//     the voxel size of the output volume) as resolution
+//     model, applied with the FFT backend.
+//
+// 11: -If parameter "precomputation cache directory" is
+//     provided, the sensitivity map and the attenuation
+//     correction factors computed from an attenuation volume
+//     are kept in that directory, under a hash of the scanner,
+//     the projection and volume dimensions, the number of
+//     subsets and the values of the mu map. They are read from
+//     it by later reconstructions of the same configuration
+//     and computed otherwise, the flags being ignored. Files
+//     named by "sensitivity map volume" and "attenuation
+//     correction factors" are still written when computed, but
+//     not read.
+//
+// 12: -Parameter "crystal correction factors" gives a factor
+//     for each crystal of a ring (normalization, dead time).
+//     Each bin of the input projection is multiplied by the
+//     factors of its two crystals, computed when it is read.
+//     Defaults to none.
+//    -The attenuation correction factors multiply the input
+//     projection before the reconstruction. If parameter
+//     "compress correction factors" is 1, they are instead kept
+//     in half precision and multiply the bins when they are
+//     read, with a relative error below 5e-4 (defaults to 0).
+//     This keeps half a projection in memory in addition to
+//     the input projection, and saves memory only when the
+//     input projection is mapped from its file and not
+//     written to (see MappedFile).
 
 struct Params
 {
@@ -86,6 +192,8 @@ struct Params
 
   // Sensitivity
   std::string sensVolFile;
+  std::string sensStorage{"full"};
+  int sensNCachedFrames{1};
 
   // Bias
   std::string biasProjFile;
@@ -93,6 +201,31 @@ struct Params
   // Attenuation
   std::string attenVolHUFile;
   std::string attenCorrFactorsFile;
+
+  // System matrix
+  int useSystemMatrix{0};
+  double systemMatrixMaxMemoryMB{0.0};
+  std::string systemMatrixFile;
+
+  // Projector
+  int useFactorizedProjector{0};
+  int useSymmetricProjector{0};
+  int useRayCache{0};
+  int useLocalityOrdering{0};
+
+  // Accumulation
+  int usePrivateAccumulation{0};
+  int useScheduledAccumulation{0};
+
+  // Convolution
+  std::string convolutionBackend{"auto"};
+
+  // Cache
+  std::string cacheDirectory;
+
+  // Corrections
+  std::vector<float> crystalWeights;
+  int compressCorrectionFactors{0};
 };
 
 int main(int argc, char** argv)
@@ -142,6 +275,17 @@ int main(int argc, char** argv)
         argv[3][0] == '0' ? false : true;
     }
 
+    // The cache decides what is computed instead of the flags
+    std::optional<PrecomputationCache> cache = std::nullopt;
+    if (!params.cacheDirectory.empty())
+    {
+      cache.emplace(params.cacheDirectory);
+      cache->printContent();
+
+      recomputeSensitivityFlag = true;
+      recomputeAttenuationCorrectionFlag = true;
+    }
+
     // If sensitivity is being asked not to be recomputed,
     // recompute it anyway if sensitivity map file is not
     // provided or if it is provided but doesn't exist.
@@ -196,22 +340,148 @@ int main(int argc, char** argv)
     printEmptyLine();
     // outputVol.printContent();
 
-    // Get sensitivity map
-    VolData sensVol;
-    if (recomputeSensitivityFlag)
+    // Compute or read system matrix if requested
+    std::optional<SystemMatrix> systemMatrix = std::nullopt;
+    if (params.useSystemMatrix != 0)
+    {
+      systemMatrix.emplace(
+        inputProj,
+        scanner,
+        outputVol,
+        params.algoParams.nSubsets,
+        params.systemMatrixMaxMemoryMB,
+        params.systemMatrixFile,
+        params.algoParams.projector ==
+          projections::Projector::SYMMETRIC);
+      systemMatrix->printContent();
+    }
+    const auto* systemMatrixPtr =
+      systemMatrix.has_value() ? &*systemMatrix : nullptr;
+
+    // Resolution recovery with a measured PSF kernel
+    const auto resoRecoFlag =
+      !params.algoParams.psfKernelFile.empty();
+
+    // Compute LORs crossing the volume once for the
+    // sensitivity map and the reconstruction
+    // OSEM leaves out the LORs missing the cut cylinder, which
+    // the sensitivity map and resolution recovery keep
+    const auto lorOrdering = params.useLocalityOrdering != 0 ?
+      LORList::Ordering::MORTON :
+      LORList::Ordering::CACHE;
+    const LORList lorList(
+      inputProj,
+      scanner,
+      outputVol,
+      params.algoParams.nSubsets,
+      0.0,
+      lorOrdering);
+    lorList.printContent();
+
+    std::optional<LORList> cutLORList;
+    if (!resoRecoFlag && params.algoParams.cutRadius > 0.0)
+    {
+      cutLORList.emplace(
+        inputProj,
+        scanner,
+        outputVol,
+        params.algoParams.nSubsets,
+        params.algoParams.cutRadius,
+        lorOrdering);
+      cutLORList->printContent();
+    }
+    const auto* reconLORList =
+      cutLORList.has_value() ? &*cutLORList : &lorList;
+
+    // Get sensitivity map, computed one subset at a time if
+    // kept in a compact storage without being saved, or when
+    // used with lazy storage
+    const auto sensStorage =
+      SensitivityStore::getStorage(params.sensStorage);
+    if (
+      resoRecoFlag &&
+      sensStorage != SensitivityStore::Storage::FULL)
+    {
+      error("Sensitivity storage must be full with a PSF "
+            "kernel volume");
+    }
+    if (
+      sensStorage == SensitivityStore::Storage::LAZY &&
+      sensVolFileProvided)
+    {
+      warning("Sensitivity map file ignored with lazy storage");
+    }
+
+    const auto sensKey = PrecomputationCache::getSensitivityKey(
+      inputProj,
+      scanner,
+      outputVol,
+      params.algoParams.nSubsets);
+    const auto sensCached = cache.has_value() &&
+      cache->contains("sensitivity", sensKey);
+
+    std::optional<VolData> sensVol = std::nullopt;
+    std::optional<SensitivityStore> sensStore = std::nullopt;
+    if (
+      sensStorage == SensitivityStore::Storage::LAZY ||
+      (sensStorage != SensitivityStore::Storage::FULL &&
+       recomputeSensitivityFlag && !sensVolFileProvided &&
+       !cache.has_value()))
+    {
+      echo("Computing sensitivity map by subset");
+      printEmptyLine();
+
+      sensStore.emplace(
+        inputProj,
+        scanner,
+        outputVol,
+        params.algoParams.nSubsets,
+        sensStorage,
+        params.sensNCachedFrames,
+        systemMatrixPtr,
+        params.algoParams.projector,
+        params.algoParams.accumulation,
+        params.algoParams.maxAccumulationMemoryMB,
+        params.algoParams.tileSize,
+        &lorList);
+    }
+    else if (sensCached)
+    {
+      echo("Reading sensitivity map from cache");
+      printEmptyLine();
+
+      sensVol.emplace();
+      cache->read("sensitivity", sensKey, *sensVol);
+
+      if (
+        sensVol->getHeader() != outputVol.getHeader() ||
+        sensVol->getNFrames() != params.algoParams.nSubsets)
+      {
+        error("Cached sensitivity volume doesn't fit with "
+              "output volume provided");
+      }
+    }
+    else if (recomputeSensitivityFlag)
     {
       echo("Computing sensitivity map");
       printEmptyLine();
 
-      sensVol.allocateAsMultiVol(
+      sensVol.emplace();
+      sensVol->allocateAsMultiVol(
         outputVol,
         params.algoParams.nSubsets);
 
       projections::computeSensitivityVol(
         inputProj,
         scanner,
-        sensVol,
-        params.algoParams.nSubsets);
+        *sensVol,
+        params.algoParams.nSubsets,
+        systemMatrixPtr,
+        params.algoParams.projector,
+        params.algoParams.accumulation,
+        params.algoParams.maxAccumulationMemoryMB,
+        params.algoParams.tileSize,
+        &lorList);
 
       // Save sensitivity map
       if (sensVolFileProvided)
@@ -221,7 +491,12 @@ int main(int argc, char** argv)
           params.sensVolFile);
         printEmptyLine();
 
-        sensVol.write(params.sensVolFile);
+        sensVol->write(params.sensVolFile);
+      }
+
+      if (cache.has_value())
+      {
+        cache->write("sensitivity", sensKey, *sensVol);
       }
     }
     else
@@ -231,17 +506,32 @@ int main(int argc, char** argv)
         params.sensVolFile);
       printEmptyLine();
 
-      sensVol.read(
+      sensVol.emplace(
         params.sensVolFile,
         VolData::ConstructionMode::READ_DATA);
 
-      if (sensVol.getHeader() != outputVol.getHeader())
+      if (sensVol->getHeader() != outputVol.getHeader())
       {
         error("Sensitivity volume provided doesn't fit with "
               "output volume provided");
       }
     }
-    // sensVol.printContent();
+
+    // Encode the frames of the map, and free it if compact
+    if (!sensStore.has_value())
+    {
+      sensStore.emplace(
+        *sensVol,
+        sensStorage,
+        params.sensNCachedFrames);
+
+      if (sensStorage != SensitivityStore::Storage::FULL)
+      {
+        sensVol.reset();
+      }
+    }
+    sensStore->printContent();
+    // sensVol->printContent();
 
     // Read bias projection if provided
     std::optional<ProjData> biasProj = std::nullopt;
@@ -286,9 +576,6 @@ int main(int argc, char** argv)
       ProjData attenCorrFactors;
       if (recomputeAttenuationCorrectionFlag)
       {
-        echo("Computing attenuation correction factors");
-        printEmptyLine();
-
         // Open attenuation volume in Hounsfield units and
         // convert to attenuation factors in mm^-1 (mu map)
         VolData muMap(
@@ -299,26 +586,75 @@ int main(int argc, char** argv)
           muMap,
           params.algoParams.cutRadius);
 
-        // Compute exponential of line integrals of mu
-        // => The attenuation correction factors are the
-        //    inverse of the attenuation factors, given by
-        //    exp(-lineIntegralOfMuMap)
-        attenCorrFactors.copy(
-          inputProj,
-          ProjData::ConstructionMode::INITIALIZE);
-        projections::forward(muMap, scanner, attenCorrFactors);
-        attenCorrFactors.exponential();
-
-        // Save attenuation correction factors if file name
-        // provided
-        if (attenCorrFactorsFileProvided)
+        const auto attenKey =
+          PrecomputationCache::getAttenuationKey(
+            inputProj,
+            scanner,
+            muMap);
+
+        if (
+          cache.has_value() &&
+          cache->contains("attenuation", attenKey))
+        {
+          echo("Reading attenuation correction factors from "
+               "cache");
+          printEmptyLine();
+
+          cache->read(
+            "attenuation",
+            attenKey,
+            attenCorrFactors);
+
+          if (!(attenCorrFactors.getHeader() ==
+                inputProj.getHeader()))
+          {
+            error("Cached attenuation correction factors don't "
+                  "fit with input projection provided");
+          }
+        }
+        else
         {
-          printQuotedValue(
-            "Saving attenuation correction factors to file",
-            params.attenCorrFactorsFile);
+          echo("Computing attenuation correction factors");
           printEmptyLine();
 
-          attenCorrFactors.write(params.attenCorrFactorsFile);
+          // Compute exponential of line integrals of mu,
+          // skipping the LORs crossing air only
+          // => The attenuation correction factors are the
+          //    inverse of the attenuation factors, given by
+          //    exp(-lineIntegralOfMuMap)
+          attenCorrFactors.copy(
+            inputProj,
+            ProjData::ConstructionMode::INITIALIZE);
+          projections::forward(
+            muMap,
+            scanner,
+            attenCorrFactors,
+            nullptr,
+            params.algoParams.projector,
+            params.algoParams.tileSize,
+            nullptr,
+            true);
+          attenCorrFactors.exponential();
+
+          // Save attenuation correction factors if file name
+          // provided
+          if (attenCorrFactorsFileProvided)
+          {
+            printQuotedValue(
+              "Saving attenuation correction factors to file",
+              params.attenCorrFactorsFile);
+            printEmptyLine();
+
+            attenCorrFactors.write(params.attenCorrFactorsFile);
+          }
+
+          if (cache.has_value())
+          {
+            cache->write(
+              "attenuation",
+              attenKey,
+              attenCorrFactors);
+          }
         }
       }
       else
@@ -333,12 +669,27 @@ int main(int argc, char** argv)
           ProjData::ConstructionMode::READ_DATA);
       }
 
-      // Multiply inputProj by attenCorrFactors
-      inputProj *= attenCorrFactors;
+      // Multiply inputProj by attenCorrFactors, or keep them in
+      // half precision as weights of the bins of inputProj,
+      // multiplying them when they are read by the
+      // reconstruction
+      if (params.compressCorrectionFactors != 0)
+      {
+        inputProj.multiplyBinWeights(attenCorrFactors);
+        inputProj.compressBinWeights();
+      }
+      else
+      {
+        inputProj *= attenCorrFactors;
+      }
     }
 
-    // TODO: Provide that parameter somehow
-    const auto resoRecoFlag = false;
+    // Normalization and dead time of each crystal, applied to
+    // the bins of inputProj when they are read
+    if (!params.crystalWeights.empty())
+    {
+      inputProj.multiplyCrystalWeights(params.crystalWeights);
+    }
 
     //// 4) Execute reconstruction
     if (!resoRecoFlag)
@@ -349,8 +700,10 @@ int main(int argc, char** argv)
         outputVol,
         params.outputVolFileName,
         params.algoParams,
-        sensVol,
-        biasProj);
+        *sensStore,
+        biasProj,
+        systemMatrixPtr,
+        reconLORList);
     }
     else
     {
@@ -360,8 +713,10 @@ int main(int argc, char** argv)
         outputVol,
         params.outputVolFileName,
         params.algoParams,
-        sensVol,
-        biasProj);
+        *sensVol,
+        biasProj,
+        systemMatrixPtr,
+        &lorList);
     }
 
     //// 5) Save reconstructed volume
@@ -411,11 +766,15 @@ Params::Params(const char* paramFile)
     "convolution interval",
     &algoParams.convolutionInterval);
   kp.addKey("convolution FHWM XYZ in mm", &algoParams.fwhmXYZ);
+  kp.addKey("convolution backend", &convolutionBackend);
+  kp.addKey("PSF kernel volume", &algoParams.psfKernelFile);
 
   // Optional files
 
   // Sensitivity
   kp.addKey("sensitivity map volume", &sensVolFile);
+  kp.addKey("sensitivity storage", &sensStorage);
+  kp.addKey("sensitivity cached frames", &sensNCachedFrames);
 
   // Bias
   kp.addKey("bias projection", &biasProjFile);
@@ -426,10 +785,66 @@ Params::Params(const char* paramFile)
     "attenuation correction factors",
     &attenCorrFactorsFile);
 
+  // System matrix
+  kp.addKey("use system matrix", &useSystemMatrix);
+  kp.addKey(
+    "system matrix memory budget in MB",
+    &systemMatrixMaxMemoryMB);
+  kp.addKey("system matrix file", &systemMatrixFile);
+
+  // Projector
+  kp.addKey(
+    "use factorized projector",
+    &useFactorizedProjector);
+  kp.addKey(
+    "use symmetric projector",
+    &useSymmetricProjector);
+  kp.addKey("packets per tile", &algoParams.tileSize);
+  kp.addKey("use ray cache", &useRayCache);
+  kp.addKey(
+    "ray cache memory budget in MB",
+    &algoParams.maxRayCacheMemoryMB);
+  kp.addKey("use locality ordering", &useLocalityOrdering);
+
+  // Accumulation
+  kp.addKey(
+    "use private accumulation",
+    &usePrivateAccumulation);
+  kp.addKey(
+    "accumulation memory budget in MB",
+    &algoParams.maxAccumulationMemoryMB);
+  kp.addKey(
+    "use scheduled accumulation",
+    &useScheduledAccumulation);
+
+  // Cache
+  kp.addKey("precomputation cache directory", &cacheDirectory);
+
+  // Corrections
+  kp.addKey("crystal correction factors", &crystalWeights);
+  kp.addKey(
+    "compress correction factors",
+    &compressCorrectionFactors);
+
   kp.addStopKey("!END OF OSEM PARAMETERS");
 
   kp.parse(paramFile);
 
+  algoParams.projector = useSymmetricProjector != 0 ?
+    projections::Projector::SYMMETRIC :
+    useFactorizedProjector != 0 ?
+    projections::Projector::FACTORIZED :
+    projections::Projector::PACKET;
+  algoParams.useRayCache = useRayCache != 0;
+  algoParams.convolutionBackend =
+    GaussianFilter::getBackend(convolutionBackend);
+
+  algoParams.accumulation = useScheduledAccumulation != 0 ?
+    projections::Accumulation::SCHEDULED :
+    usePrivateAccumulation != 0 ?
+    projections::Accumulation::PRIVATE :
+    projections::Accumulation::ATOMIC;
+
   // Check mandatory parameters
   if (inputProjFile.empty())
   {
@@ -480,6 +895,8 @@ void Params::printContent()
     "convolution interval",
     algoParams.convolutionInterval);
   printVector("convolution FHWM XYZ in mm", algoParams.fwhmXYZ);
+  printValue("convolution backend", convolutionBackend);
+  printValue("PSF kernel volume", algoParams.psfKernelFile);
   printEmptyLine();
 
   echo("== Optional files");
@@ -487,6 +904,8 @@ void Params::printContent()
 
   echo("=== Sensitivity");
   printValue("sensitivity map volume", sensVolFile);
+  printValue("sensitivity storage", sensStorage);
+  printValue("sensitivity cached frames", sensNCachedFrames);
   printEmptyLine();
 
   echo("=== Bias");
@@ -499,4 +918,50 @@ void Params::printContent()
     "attenuation correction factors",
     attenCorrFactorsFile);
   printEmptyLine();
+
+  echo("=== System matrix");
+  printValue("use system matrix", useSystemMatrix);
+  printValue(
+    "system matrix memory budget in MB",
+    systemMatrixMaxMemoryMB);
+  printValue("system matrix file", systemMatrixFile);
+  printEmptyLine();
+
+  echo("=== Projector");
+  printValue(
+    "use factorized projector",
+    useFactorizedProjector);
+  printValue(
+    "use symmetric projector",
+    useSymmetricProjector);
+  printValue("packets per tile", algoParams.tileSize);
+  printValue("use ray cache", useRayCache);
+  printValue(
+    "ray cache memory budget in MB",
+    algoParams.maxRayCacheMemoryMB);
+  printValue("use locality ordering", useLocalityOrdering);
+  printEmptyLine();
+
+  echo("=== Accumulation");
+  printValue(
+    "use private accumulation",
+    usePrivateAccumulation);
+  printValue(
+    "accumulation memory budget in MB",
+    algoParams.maxAccumulationMemoryMB);
+  printValue(
+    "use scheduled accumulation",
+    useScheduledAccumulation);
+  printEmptyLine();
+
+  echo("=== Cache");
+  printValue("precomputation cache directory", cacheDirectory);
+  printEmptyLine();
+
+  echo("=== Corrections");
+  printVector("crystal correction factors", crystalWeights);
+  printValue(
+    "compress correction factors",
+    compressCorrectionFactors);
+  printEmptyLine();
 }
@@ -0,0 +1,335 @@
+#include <FFTConvolver.h>
+
+#include <console.h>
+#include <macros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Smallest power of 2 not less than n
+static int getPowerOf2(int n)
+{
+  auto powerOf2 = 1;
+  while (powerOf2 < n)
+  {
+    powerOf2 *= 2;
+  }
+
+  return powerOf2;
+}
+
+FFTConvolver::FFTConvolver(
+  const types::VolSize& volSize,
+  const types::VolSize& kernelSize,
+  const std::vector<float>& kernel):
+  mVolSize{volSize}
+{
+  const std::vector<int> volSizeXYZ{
+    volSize.nPixelsX,
+    volSize.nPixelsY,
+    volSize.nSlices};
+  const std::vector<int> kernelSizeXYZ{
+    kernelSize.nPixelsX,
+    kernelSize.nPixelsY,
+    kernelSize.nSlices};
+
+  if ((types::Size)kernel.size() != kernelSize.nVoxelsTotal())
+  {
+    error("Kernel doesn't fit with its size");
+  }
+
+  mPaddedSize.resize(3);
+  mTwiddles.resize(3);
+  LOOP(dim, 0, 2)
+  {
+    if (kernelSizeXYZ[dim] % 2 == 0)
+    {
+      error("Kernel must have an odd number of voxels");
+    }
+
+    // Volume followed by the half kernel size, and whole kernel
+    const auto halfSize = kernelSizeXYZ[dim] / 2;
+    mPaddedSize[dim] = getPowerOf2(
+      MAX(volSizeXYZ[dim] + halfSize, kernelSizeXYZ[dim]));
+
+    const auto n = mPaddedSize[dim];
+    mTwiddles[dim].resize(MAX(1, n / 2));
+    LOOP(k, 0, n / 2 - 1)
+    {
+      mTwiddles[dim][k] =
+        Complex(std::polar(1.0, -2.0 * PI * k / n));
+    }
+  }
+
+  // Normalization needs a weight at the center
+  if (kernel[kernel.size() / 2] <= 0.0)
+  {
+    error("Kernel weight at the center must be positive");
+  }
+
+  const auto paddedX = (std::size_t)mPaddedSize[0];
+  const auto paddedY = (std::size_t)mPaddedSize[1];
+  const auto nPadded = paddedX * paddedY * mPaddedSize[2];
+
+  // Kernel centered on the first voxel, wrapped around, scaled
+  // for the inverse transform
+  mKernelSpectrum.assign(nPadded, 0.0);
+  LOOP(c, 0, kernelSize.nSlices - 1)
+  LOOP(b, 0, kernelSize.nPixelsY - 1)
+  LOOP(a, 0, kernelSize.nPixelsX - 1)
+  {
+    const auto x = (a - kernelSize.nPixelsX / 2 + paddedX) %
+      paddedX;
+    const auto y = (b - kernelSize.nPixelsY / 2 + paddedY) %
+      paddedY;
+    const auto z = (c - kernelSize.nSlices / 2 +
+                    mPaddedSize[2]) %
+      mPaddedSize[2];
+
+    mKernelSpectrum[(z * paddedY + y) * paddedX + x] =
+      kernel
+        [((std::size_t)c * kernelSize.nPixelsY + b) *
+           kernelSize.nPixelsX +
+         a] /
+      (float)nPadded;
+  }
+  transform(mKernelSpectrum, false, false);
+
+  // Normalization from the convolution of the volume support
+  mPadded.assign(nPadded, 0.0);
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  {
+    std::fill_n(
+      mPadded.begin() + (k * paddedY + j) * paddedX,
+      volSize.nPixelsX,
+      1.0);
+  }
+  convolvePadded(mPadded);
+
+  mNorms.resize(volSize.nVoxelsTotal());
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  LOOP(i, 0, volSize.nPixelsX - 1)
+  {
+    mNorms[((std::size_t)k * volSize.nPixelsY + j) *
+             volSize.nPixelsX +
+           i] = mPadded[(k * paddedY + j) * paddedX + i].real();
+  }
+}
+
+void FFTConvolver::apply(
+  types::VoxelValue* dataArray,
+  const std::vector<std::pair<int, int>>& filteredRows)
+{
+  const auto nPixelsX = mVolSize.nPixelsX;
+  const auto nPixelsY = mVolSize.nPixelsY;
+  const auto paddedX = (std::size_t)mPaddedSize[0];
+  const auto paddedY = (std::size_t)mPaddedSize[1];
+
+  std::fill(mPadded.begin(), mPadded.end(), 0.0);
+
+#pragma omp parallel for
+  LOOP(k, 0, mVolSize.nSlices - 1)
+  LOOP(j, 0, nPixelsY - 1)
+  {
+    const auto* row =
+      dataArray + ((std::size_t)k * nPixelsY + j) * nPixelsX;
+    auto* paddedRow =
+      mPadded.data() + (k * paddedY + j) * paddedX;
+
+    LOOP(i, 0, nPixelsX - 1)
+    {
+      paddedRow[i] = row[i];
+    }
+  }
+
+  convolvePadded(mPadded);
+
+#pragma omp parallel for
+  LOOP(k, 0, mVolSize.nSlices - 1)
+  LOOP(j, 0, nPixelsY - 1)
+  {
+    const auto rowOffset =
+      ((std::size_t)k * nPixelsY + j) * nPixelsX;
+    const auto* paddedRow =
+      mPadded.data() + (k * paddedY + j) * paddedX;
+    const auto [firstX, endX] = filteredRows[j];
+
+    LOOP(i, firstX, endX - 1)
+    {
+      dataArray[rowOffset + i] =
+        paddedRow[i].real() / mNorms[rowOffset + i];
+    }
+  }
+}
+
+void FFTConvolver::convolvePadded(
+  std::vector<Complex>& data) const
+{
+  transform(data, false, true);
+
+  // Complex products written out, without the checks of
+  // std::complex for infinite values
+#pragma omp parallel for
+  LOOP(index, 0, (int)data.size() - 1)
+  {
+    const auto value = data[index];
+    const auto weight = mKernelSpectrum[index];
+    const auto real = value.real() * weight.real() -
+      value.imag() * weight.imag();
+    const auto imag = value.real() * weight.imag() +
+      value.imag() * weight.real();
+
+    data[index] = Complex(real, imag);
+  }
+
+  transform(data, true, true);
+}
+
+void FFTConvolver::transform(
+  std::vector<Complex>& data,
+  bool inverse,
+  bool volumeOnly) const
+{
+  const auto paddedX = mPaddedSize[0];
+  const auto paddedY = mPaddedSize[1];
+  const auto paddedZ = mPaddedSize[2];
+  const auto sliceSize = (std::size_t)paddedX * paddedY;
+
+  // Rows in X and slices in Y crossing the volume
+  const auto nRowsY = volumeOnly ? mVolSize.nPixelsY : paddedY;
+  const auto nSlices = volumeOnly ? mVolSize.nSlices : paddedZ;
+
+  const auto transformX = [&]()
+  {
+#pragma omp parallel for
+    LOOP(rowIndex, 0, nSlices * nRowsY - 1)
+    {
+      const auto k = rowIndex / nRowsY;
+      const auto j = rowIndex % nRowsY;
+
+      transformLines(
+        data.data() + k * sliceSize + (std::size_t)j * paddedX,
+        paddedX,
+        1,
+        1,
+        mTwiddles[0],
+        inverse);
+    }
+  };
+
+  // Rows of a slice at once in Y
+  const auto transformY = [&]()
+  {
+#pragma omp parallel for
+    LOOP(k, 0, nSlices - 1)
+    {
+      transformLines(
+        data.data() + k * sliceSize,
+        paddedY,
+        paddedX,
+        paddedX,
+        mTwiddles[1],
+        inverse);
+    }
+  };
+
+  // Same rows of all slices at once in Z
+  const auto transformZ = [&]()
+  {
+#pragma omp parallel for
+    LOOP(j, 0, paddedY - 1)
+    {
+      transformLines(
+        data.data() + (std::size_t)j * paddedX,
+        paddedZ,
+        sliceSize,
+        paddedX,
+        mTwiddles[2],
+        inverse);
+    }
+  };
+
+  if (!inverse)
+  {
+    transformX();
+    transformY();
+    transformZ();
+  }
+  else
+  {
+    transformZ();
+    transformY();
+    transformX();
+  }
+}
+
+void FFTConvolver::transformLines(
+  Complex* first,
+  int n,
+  std::size_t stride,
+  int width,
+  const std::vector<Complex>& twiddles,
+  bool inverse)
+{
+  // Bit reversal permutation
+  for (int i = 1, j = 0; i < n; i++)
+  {
+    auto bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j)
+    {
+      std::swap_ranges(
+        first + i * stride,
+        first + i * stride + width,
+        first + j * stride);
+    }
+  }
+
+  // Butterflies of increasing length
+  for (auto length = 2; length <= n; length *= 2)
+  {
+    const auto halfLength = length / 2;
+    const auto step = n / length;
+
+    for (auto start = 0; start < n; start += length)
+    {
+      LOOP(k, 0, halfLength - 1)
+      {
+        const auto twiddle = twiddles[k * step];
+        const auto twiddleReal = twiddle.real();
+        const auto twiddleImag =
+          inverse ? -twiddle.imag() : twiddle.imag();
+
+        auto* even = first + (start + k) * stride;
+        auto* odd = even + halfLength * stride;
+
+        LOOP(c, 0, width - 1)
+        {
+          const auto evenValue = even[c];
+          const auto oddValue = odd[c];
+          const auto productReal =
+            oddValue.real() * twiddleReal -
+            oddValue.imag() * twiddleImag;
+          const auto productImag =
+            oddValue.real() * twiddleImag +
+            oddValue.imag() * twiddleReal;
+
+          even[c] = Complex(
+            evenValue.real() + productReal,
+            evenValue.imag() + productImag);
+          odd[c] = Complex(
+            evenValue.real() - productReal,
+            evenValue.imag() - productImag);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <types.h>
+
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Convolution of the volumes of a given size by a 3D kernel in
+// the frequency domain (see GaussianFilter)
+//
+// The volume is zero padded to power of 2 sizes that leave no
+// wrap around, and the spectrum of the kernel and the
+// normalization at the edges of the volume are computed once.
+// The cost doesn't depend on the kernel size, which makes it
+// the backend of large and non-separable kernels.
+
+class FFTConvolver
+{
+public:
+
+  // kernelSize: Odd number of voxels of the kernel in X, Y and
+  // Z, centered on its middle voxel
+  // kernel: Weights of the kernel voxels (X fastest), of the
+  // voxel size of the volumes
+  FFTConvolver(
+    const types::VolSize& volSize,
+    const types::VolSize& kernelSize,
+    const std::vector<float>& kernel);
+
+  // Convolve a volume (X fastest) in place, normalized by the
+  // weights of the kernel within the volume. Voxels outside
+  // filteredRows ([j] first and end X indices of row j of each
+  // slice) are left unchanged.
+  void apply(
+    types::VoxelValue* dataArray,
+    const std::vector<std::pair<int, int>>& filteredRows);
+
+private:
+
+  using Complex = std::complex<float>;
+
+  // Forward (or inverse) FFT of the padded volume along each
+  // dimension
+  // volumeOnly: Lines in X and Y that only cross padding are
+  // zero before the forward transform in the other dimensions
+  // and not needed after the inverse one, and are skipped
+  void transform(
+    std::vector<Complex>& data,
+    bool inverse,
+    bool volumeOnly) const;
+
+  // In place radix 2 FFT along n elements at stride apart, each
+  // element being width contiguous values transformed at once,
+  // with the twiddle factors of size n
+  static void transformLines(
+    Complex* first,
+    int n,
+    std::size_t stride,
+    int width,
+    const std::vector<Complex>& twiddles,
+    bool inverse);
+
+  // Convolve the padded volume by the kernel spectrum, the
+  // voxels out of the volume being zero
+  void convolvePadded(std::vector<Complex>& data) const;
+
+  types::VolSize mVolSize;
+
+  // [dim] Padded number of voxels
+  std::vector<int> mPaddedSize;
+
+  // [dim][k] exp(-2 i pi k / paddedSize) for k < paddedSize / 2
+  std::vector<std::vector<Complex>> mTwiddles;
+
+  // Spectrum of the kernel centered on the first voxel
+  std::vector<Complex> mKernelSpectrum;
+
+  // [voxel] Sum of the weights of the kernel within the volume
+  std::vector<float> mNorms;
+
+  // Padded volume
+  std::vector<Complex> mPadded;
+};
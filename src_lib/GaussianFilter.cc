@@ -0,0 +1,657 @@
+#include <GaussianFilter.h>
+
+#include <console.h>
+#include <macros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+GaussianFilter::GaussianFilter(
+  const VolData& vol,
+  const std::vector<float>& fwhmXYZ,
+  float cutRadius,
+  Backend backend):
+  mVolSize{vol.getHeader().volSize},
+  mVoxelExtent{vol.getHeader().voxelExtent},
+  mEnabled{
+    fwhmXYZ[0] > 0.0 && fwhmXYZ[1] > 0.0 && fwhmXYZ[2] > 0.0},
+  mBackend{backend}
+{
+  if (!mEnabled)
+  {
+    mBackend = Backend::DIRECT;
+    return;
+  }
+
+  // Kernels in X and Y with sigma in single precision, and in Z
+  // in double precision
+  const auto sigmaX = fwhmXYZ[0] / 2.3548f;
+  mKernelX = getKernel(
+    sigmaX,
+    2 * sigmaX * sigmaX,
+    mVoxelExtent.pixelWidth,
+    mVolSize.nPixelsX);
+
+  const auto sigmaY = fwhmXYZ[1] / 2.3548f;
+  mKernelY = getKernel(
+    sigmaY,
+    2 * sigmaY * sigmaY,
+    mVoxelExtent.pixelHeight,
+    mVolSize.nPixelsY);
+
+  const auto sigmaZ = fwhmXYZ[2] / 2.3548;
+  mKernelZ = getKernel(
+    sigmaZ,
+    2 * sigmaZ * sigmaZ,
+    mVoxelExtent.sliceThickness,
+    mVolSize.nSlices);
+
+  if (mBackend == Backend::AUTO)
+  {
+    const auto maxHalfSize = MAX(
+      mKernelX.halfSize,
+      MAX(mKernelY.halfSize, mKernelZ.halfSize));
+
+    mBackend = maxHalfSize > RECURSIVE_MIN_HALF_SIZE ?
+      Backend::RECURSIVE :
+      Backend::DIRECT;
+  }
+
+  if (mBackend == Backend::RECURSIVE)
+  {
+    mRecursiveKernelX = getRecursiveKernel(
+      sigmaX,
+      mVoxelExtent.pixelWidth,
+      mVolSize.nPixelsX);
+    mRecursiveKernelY = getRecursiveKernel(
+      sigmaY,
+      mVoxelExtent.pixelHeight,
+      mVolSize.nPixelsY);
+    mRecursiveKernelZ = getRecursiveKernel(
+      sigmaZ,
+      mVoxelExtent.sliceThickness,
+      mVolSize.nSlices);
+  }
+  else if (mBackend == Backend::FFT)
+  {
+    // Product of the kernels in X, Y and Z
+    const types::VolSize kernelSize{
+      2 * mKernelX.halfSize + 1,
+      2 * mKernelY.halfSize + 1,
+      2 * mKernelZ.halfSize + 1};
+
+    std::vector<float> kernel;
+    kernel.reserve(kernelSize.nVoxelsTotal());
+    for (const auto weightZ : mKernelZ.weights)
+    for (const auto weightY : mKernelY.weights)
+    for (const auto weightX : mKernelX.weights)
+    {
+      kernel.push_back(weightX * weightY * weightZ);
+    }
+
+    mFFTConvolver = std::make_unique<FFTConvolver>(
+      mVolSize,
+      kernelSize,
+      kernel);
+  }
+
+  setFilteredRows(vol, fwhmXYZ, cutRadius);
+}
+
+GaussianFilter::GaussianFilter(
+  const VolData& vol,
+  const VolData& kernel,
+  const std::vector<float>& fwhmXYZ,
+  float cutRadius,
+  bool mirrored):
+  mVolSize{vol.getHeader().volSize},
+  mVoxelExtent{vol.getHeader().voxelExtent},
+  mEnabled{true},
+  mBackend{Backend::FFT}
+{
+  const auto& kernelHeader = kernel.getHeader();
+  if (!(kernelHeader.voxelExtent == mVoxelExtent))
+  {
+    error("Kernel voxel size doesn't fit with the volume");
+  }
+
+  const auto* kernelArray = kernel.getDataArray();
+  std::vector<float> weights(
+    kernelArray,
+    kernelArray + kernelHeader.volSize.nVoxelsTotal());
+
+  // Reversed order of the voxels mirrors X, Y and Z
+  if (mirrored)
+  {
+    std::reverse(weights.begin(), weights.end());
+  }
+
+  mFFTConvolver = std::make_unique<FFTConvolver>(
+    mVolSize,
+    kernelHeader.volSize,
+    weights);
+
+  setFilteredRows(vol, fwhmXYZ, cutRadius);
+}
+
+void GaussianFilter::setFilteredRows(
+  const VolData& vol,
+  const std::vector<float>& fwhmXYZ,
+  float cutRadius)
+{
+  // Voxels filtered form a single range per row
+  mFilteredRows.assign(
+    mVolSize.nPixelsY,
+    {0, mVolSize.nPixelsX});
+  if (cutRadius > 0.0)
+  {
+    const auto fwhm = MAX(fwhmXYZ[0], fwhmXYZ[1]);
+    const auto& volExtent = vol.getVolExtent();
+
+    LOOP(j, 0, mVolSize.nPixelsY - 1)
+    {
+      auto& [firstX, endX] = mFilteredRows[j];
+      firstX = mVolSize.nPixelsX;
+      endX = 0;
+
+      LOOP(i, 0, mVolSize.nPixelsX - 1)
+      {
+        const auto px = i * mVoxelExtent.pixelWidth +
+          mVoxelExtent.pixelWidth / 2.0 -
+          volExtent.sliceWidth / 2.0;
+
+        const auto py = j * mVoxelExtent.pixelHeight +
+          mVoxelExtent.pixelHeight / 2.0 -
+          volExtent.sliceHeight / 2.0;
+
+        if (
+          std::sqrt(px * px + py * py) <
+          cutRadius - 5.0 * fwhm)
+        {
+          firstX = MIN(firstX, i);
+          endX = i + 1;
+        }
+      }
+    }
+  }
+}
+
+void GaussianFilter::apply(VolData& vol)
+{
+  if (!mEnabled)
+  {
+    return;
+  }
+
+  const auto& header = vol.getHeader();
+  if (
+    !(header.volSize == mVolSize) ||
+    !(header.voxelExtent == mVoxelExtent))
+  {
+    error("Volume doesn't fit with the filter");
+  }
+
+  // Intermediate volumes allocated on first use
+  if (mBackend != Backend::FFT)
+  {
+    const auto nVoxels = (std::size_t)mVolSize.nPixelsX *
+      mVolSize.nPixelsY * mVolSize.nSlices;
+    mImage1.resize(nVoxels);
+    mImage2.resize(nVoxels);
+  }
+
+  // Loop over frames
+  LOOP(frame, 0, header.nFrames - 1)
+  {
+    vol.setActiveFrame(frame);
+    auto* dataArray = vol.getDataArray();
+
+    if (mBackend == Backend::RECURSIVE)
+    {
+      applyRecursive(dataArray);
+    }
+    else if (mBackend == Backend::FFT)
+    {
+      mFFTConvolver->apply(dataArray, mFilteredRows);
+    }
+    else
+    {
+      filterX(dataArray, mImage1.data());
+      filterY(mImage1.data(), mImage2.data());
+      filterZ(mImage2.data(), dataArray);
+    }
+  }
+}
+
+GaussianFilter::Backend GaussianFilter::getBackend() const
+{
+  return mBackend;
+}
+
+GaussianFilter::Backend GaussianFilter::getBackend(
+  const std::string& name)
+{
+  if (name == "auto")
+  {
+    return Backend::AUTO;
+  }
+  if (name == "direct")
+  {
+    return Backend::DIRECT;
+  }
+  if (name == "recursive")
+  {
+    return Backend::RECURSIVE;
+  }
+  if (name == "FFT")
+  {
+    return Backend::FFT;
+  }
+
+  error("Unknown convolution backend: ", name);
+  return Backend::AUTO;
+}
+
+std::string GaussianFilter::getBackendName(Backend backend)
+{
+  switch (backend)
+  {
+  case Backend::DIRECT:
+    return "direct";
+  case Backend::RECURSIVE:
+    return "recursive";
+  case Backend::FFT:
+    return "FFT";
+  default:
+    return "auto";
+  }
+}
+
+GaussianFilter::Kernel GaussianFilter::getKernel(
+  double sigma,
+  double twoSigmaSquared,
+  types::SpatialExtent voxelExtent,
+  int nVoxels)
+{
+  Kernel kernel;
+  kernel.halfSize =
+    (static_cast<int>(6.0 * sigma / voxelExtent) + 1) / 2;
+
+  kernel.weights.resize(2 * kernel.halfSize + 1);
+  LOOP(offset, -kernel.halfSize, kernel.halfSize)
+  {
+    kernel.weights[kernel.halfSize + offset] = std::exp(
+      -(offset * offset * voxelExtent * voxelExtent) /
+      twoSigmaSquared);
+  }
+
+  // Weights are summed in the order of the passes
+  kernel.norms.assign(nVoxels, 0.0);
+  LOOP(coord, 0, nVoxels - 1)
+  LOOP(offset, -kernel.halfSize, kernel.halfSize)
+  {
+    if (coord + offset >= 0 && coord + offset < nVoxels)
+    {
+      kernel.norms[coord] +=
+        kernel.weights[kernel.halfSize + offset];
+    }
+  }
+
+  return kernel;
+}
+
+GaussianFilter::RecursiveKernel
+GaussianFilter::getRecursiveKernel(
+  double sigma,
+  types::SpatialExtent voxelExtent,
+  int nVoxels)
+{
+  // Young - van Vliet coefficients, valid from half a voxel
+  const auto s = MAX(sigma / voxelExtent, 0.5);
+  const auto q = s >= 2.5 ?
+    0.98711 * s - 0.96330 :
+    3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * s);
+
+  const auto b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q +
+    0.422205 * q * q * q;
+
+  RecursiveKernel kernel;
+  kernel.b1 = (2.44413 * q + 2.85619 * q * q +
+               1.26661 * q * q * q) /
+    b0;
+  kernel.b2 = -(1.4281 * q * q + 1.26661 * q * q * q) / b0;
+  kernel.b3 = 0.422205 * q * q * q / b0;
+  kernel.gain = 1.0 - (kernel.b1 + kernel.b2 + kernel.b3);
+
+  // Causal response decayed before the anti-causal pass
+  kernel.nPaddingVoxels = static_cast<int>(std::ceil(6.0 * s));
+
+  // Response to a line of ones, normalized by ones
+  const std::vector<types::VoxelValue> ones(nVoxels, 1.0);
+  std::vector<types::VoxelValue> response(nVoxels);
+  std::vector<double> buffer;
+
+  kernel.norms.assign(nVoxels, 1.0);
+  filterRecursive(
+    kernel,
+    ones.data(),
+    response.data(),
+    nVoxels,
+    1,
+    1,
+    0,
+    1,
+    buffer);
+  kernel.norms.assign(response.cbegin(), response.cend());
+
+  return kernel;
+}
+
+void GaussianFilter::filterRecursive(
+  const RecursiveKernel& kernel,
+  const types::VoxelValue* input,
+  types::VoxelValue* output,
+  int n,
+  std::size_t stride,
+  int width,
+  int first,
+  int end,
+  std::vector<double>& buffer)
+{
+  const auto gain = kernel.gain;
+  const auto b1 = kernel.b1;
+  const auto b2 = kernel.b2;
+  const auto b3 = kernel.b3;
+
+  // Elements of the padded line after 3 elements of zeros, and
+  // followed by 3 elements of zeros
+  const auto nPadded = n + kernel.nPaddingVoxels;
+  buffer.assign((nPadded + 6) * (std::size_t)width, 0.0);
+  auto* padded = buffer.data() + 3 * (std::size_t)width;
+
+  // Causal pass
+  LOOP(m, 0, nPadded - 1)
+  {
+    auto* element = padded + (std::size_t)m * width;
+    const auto* previous1 = element - width;
+    const auto* previous2 = previous1 - width;
+    const auto* previous3 = previous2 - width;
+
+    if (m < n)
+    {
+      const auto* inputElement = input + m * stride;
+
+#pragma omp simd
+      LOOP(c, 0, width - 1)
+      {
+        element[c] = gain * inputElement[c] +
+          b1 * previous1[c] + b2 * previous2[c] +
+          b3 * previous3[c];
+      }
+    }
+    else
+    {
+#pragma omp simd
+      LOOP(c, 0, width - 1)
+      {
+        element[c] = b1 * previous1[c] + b2 * previous2[c] +
+          b3 * previous3[c];
+      }
+    }
+  }
+
+  // Anti-causal pass in place
+  for (auto m = nPadded - 1; m >= 0; m--)
+  {
+    auto* element = padded + (std::size_t)m * width;
+    const auto* next1 = element + width;
+    const auto* next2 = next1 + width;
+    const auto* next3 = next2 + width;
+
+#pragma omp simd
+    LOOP(c, 0, width - 1)
+    {
+      element[c] = gain * element[c] + b1 * next1[c] +
+        b2 * next2[c] + b3 * next3[c];
+    }
+  }
+
+  LOOP(m, 0, n - 1)
+  {
+    const auto* element = padded + (std::size_t)m * width;
+    const auto norm = kernel.norms[m];
+    auto* outputElement = output + m * stride;
+
+#pragma omp simd
+    LOOP(c, first, end - 1)
+    {
+      outputElement[c] = element[c] / norm;
+    }
+  }
+}
+
+void GaussianFilter::applyRecursive(
+  types::VoxelValue* dataArray)
+{
+  const auto nPixelsX = mVolSize.nPixelsX;
+  const auto nPixelsY = mVolSize.nPixelsY;
+  const auto nSlices = mVolSize.nSlices;
+  const auto sliceSize = (std::size_t)nPixelsY * nPixelsX;
+
+#pragma omp parallel
+  {
+    std::vector<double> buffer;
+
+    // Transposed slice and its filtering
+    std::vector<types::VoxelValue> transposed(sliceSize);
+    std::vector<types::VoxelValue> filtered(sliceSize);
+
+    // Slices transposed in X, columns being the elements
+#pragma omp for
+    LOOP(k, 0, nSlices - 1)
+    {
+      const auto* inputSlice = dataArray + k * sliceSize;
+      auto* outputSlice = mImage1.data() + k * sliceSize;
+
+      LOOP(j, 0, nPixelsY - 1)
+      LOOP(i, 0, nPixelsX - 1)
+      {
+        transposed[(std::size_t)i * nPixelsY + j] =
+          inputSlice[(std::size_t)j * nPixelsX + i];
+      }
+
+      filterRecursive(
+        mRecursiveKernelX,
+        transposed.data(),
+        filtered.data(),
+        nPixelsX,
+        nPixelsY,
+        nPixelsY,
+        0,
+        nPixelsY,
+        buffer);
+
+      LOOP(j, 0, nPixelsY - 1)
+      LOOP(i, 0, nPixelsX - 1)
+      {
+        outputSlice[(std::size_t)j * nPixelsX + i] =
+          filtered[(std::size_t)i * nPixelsY + j];
+      }
+    }
+
+    // Slices in Y, rows being the elements
+#pragma omp for
+    LOOP(k, 0, nSlices - 1)
+    {
+      filterRecursive(
+        mRecursiveKernelY,
+        mImage1.data() + k * sliceSize,
+        mImage2.data() + k * sliceSize,
+        nPixelsY,
+        nPixelsX,
+        nPixelsX,
+        0,
+        nPixelsX,
+        buffer);
+    }
+
+    // Same rows of the slices in Z, voxels outside
+    // mFilteredRows left unchanged
+#pragma omp for
+    LOOP(j, 0, nPixelsY - 1)
+    {
+      const auto [firstX, endX] = mFilteredRows[j];
+
+      filterRecursive(
+        mRecursiveKernelZ,
+        mImage2.data() + j * nPixelsX,
+        dataArray + j * nPixelsX,
+        nSlices,
+        sliceSize,
+        nPixelsX,
+        firstX,
+        endX,
+        buffer);
+    }
+  }
+}
+
+void GaussianFilter::filterX(
+  const types::VoxelValue* input,
+  types::VoxelValue* output) const
+{
+  const auto nPixelsX = mVolSize.nPixelsX;
+  const auto halfSize = mKernelX.halfSize;
+  const auto* weights = mKernelX.weights.data();
+  const auto* norms = mKernelX.norms.data();
+
+#pragma omp parallel for
+  LOOP(k, 0, mVolSize.nSlices - 1)
+  LOOP(j, 0, mVolSize.nPixelsY - 1)
+  {
+    const auto rowOffset =
+      ((std::size_t)k * mVolSize.nPixelsY + j) * nPixelsX;
+    const auto* inputRow = input + rowOffset;
+    auto* outputRow = output + rowOffset;
+
+    std::fill(outputRow, outputRow + nPixelsX, 0.0);
+
+    // Row shifted by each offset within the row
+    LOOP(offset, -halfSize, halfSize)
+    {
+      const auto weight = weights[halfSize + offset];
+      const auto firstX = MAX(0, -offset);
+      const auto endX = MIN(nPixelsX, nPixelsX - offset);
+
+#pragma omp simd
+      LOOP(i, firstX, endX - 1)
+      {
+        outputRow[i] += weight * inputRow[i + offset];
+      }
+    }
+
+#pragma omp simd
+    LOOP(i, 0, nPixelsX - 1)
+    {
+      outputRow[i] /= norms[i];
+    }
+  }
+}
+
+void GaussianFilter::filterY(
+  const types::VoxelValue* input,
+  types::VoxelValue* output) const
+{
+  const auto nPixelsX = mVolSize.nPixelsX;
+  const auto nPixelsY = mVolSize.nPixelsY;
+  const auto halfSize = mKernelY.halfSize;
+
+#pragma omp parallel for
+  LOOP(k, 0, mVolSize.nSlices - 1)
+  LOOP(j, 0, nPixelsY - 1)
+  {
+    const auto* inputSlice =
+      input + (std::size_t)k * nPixelsY * nPixelsX;
+    auto* outputRow =
+      output + ((std::size_t)k * nPixelsY + j) * nPixelsX;
+
+    std::fill(outputRow, outputRow + nPixelsX, 0.0);
+
+    // Rows of the slice within the kernel
+    const auto firstOffset = MAX(-halfSize, -j);
+    const auto lastOffset = MIN(halfSize, nPixelsY - 1 - j);
+    LOOP(offset, firstOffset, lastOffset)
+    {
+      const auto weight = mKernelY.weights[halfSize + offset];
+      const auto* inputRow =
+        inputSlice + (std::size_t)(j + offset) * nPixelsX;
+
+#pragma omp simd
+      LOOP(i, 0, nPixelsX - 1)
+      {
+        outputRow[i] += weight * inputRow[i];
+      }
+    }
+
+    const auto norm = mKernelY.norms[j];
+
+#pragma omp simd
+    LOOP(i, 0, nPixelsX - 1)
+    {
+      outputRow[i] /= norm;
+    }
+  }
+}
+
+void GaussianFilter::filterZ(
+  const types::VoxelValue* input,
+  types::VoxelValue* output) const
+{
+  const auto nPixelsX = mVolSize.nPixelsX;
+  const auto nSlices = mVolSize.nSlices;
+  const auto sliceSize =
+    (std::size_t)mVolSize.nPixelsY * nPixelsX;
+  const auto halfSize = mKernelZ.halfSize;
+
+#pragma omp parallel
+  {
+    // Row filtered before the voxels kept are restored
+    std::vector<types::VoxelValue> row(nPixelsX);
+
+#pragma omp for
+    LOOP(k, 0, nSlices - 1)
+    LOOP(j, 0, mVolSize.nPixelsY - 1)
+    {
+      const auto rowOffset = (std::size_t)j * nPixelsX;
+
+      std::fill(row.begin(), row.end(), 0.0);
+
+      // Same rows of the slices within the kernel
+      const auto firstOffset = MAX(-halfSize, -k);
+      const auto lastOffset = MIN(halfSize, nSlices - 1 - k);
+      LOOP(offset, firstOffset, lastOffset)
+      {
+        const auto weight = mKernelZ.weights[halfSize + offset];
+        const auto* inputRow =
+          input + (k + offset) * sliceSize + rowOffset;
+
+#pragma omp simd
+        LOOP(i, 0, nPixelsX - 1)
+        {
+          row[i] += weight * inputRow[i];
+        }
+      }
+
+      const auto norm = mKernelZ.norms[k];
+      const auto [firstX, endX] = mFilteredRows[j];
+      auto* outputRow = output + k * sliceSize + rowOffset;
+
+#pragma omp simd
+      LOOP(i, firstX, endX - 1)
+      {
+        outputRow[i] = row[i] / norm;
+      }
+    }
+  }
+}
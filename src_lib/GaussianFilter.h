@@ -0,0 +1,176 @@
+#pragma once
+
+#include <FFTConvolver.h>
+#include <VolData.h>
+#include <types.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Separable gaussian filter of the volumes of a given size (see
+// operations::convolve)
+//
+// The kernels, their normalization at the edges of the volume
+// and the voxels restored after filtering are computed once,
+// and the intermediate volumes are kept between calls. Each
+// pass sums shifted rows of contiguous voxels weighted by the
+// kernel, in Y and Z as well as in X.
+//
+// Large kernels are applied by a backend whose cost doesn't
+// depend on their size: a recursive approximation of the
+// gaussian (Young - van Vliet), or a convolution in the
+// frequency domain (see FFTConvolver), which also applies
+// measured kernels that are not separable.
+
+class GaussianFilter
+{
+public:
+
+  // AUTO: DIRECT, or RECURSIVE if a kernel has more than
+  // RECURSIVE_MIN_HALF_SIZE voxels on each side
+  enum class Backend
+  {
+    AUTO,
+    DIRECT,
+    RECURSIVE,
+    FFT
+  };
+
+  static constexpr int RECURSIVE_MIN_HALF_SIZE{10};
+
+  // fwhmXYZ: FWHM of the kernel in X, Y and Z in mm (no
+  // filtering if one of them is not positive)
+  // cutRadius: Voxels at cutRadius - 5 FWHM from the center in
+  // XY or farther keep their values (0: No voxel kept)
+  // backend: Filtering method of the gaussian kernels
+  GaussianFilter(
+    const VolData& vol,
+    const std::vector<float>& fwhmXYZ,
+    float cutRadius = 0.0,
+    Backend backend = Backend::AUTO);
+
+  // Convolution by a measured kernel with the FFT backend
+  // kernel: Volume of the voxel size of vol with an odd number
+  // of voxels in X, Y and Z, centered on its middle voxel
+  // fwhmXYZ: Approximate FWHM of the kernel, only used with
+  // cutRadius
+  // mirrored: Convolve by the kernel mirrored about its center
+  // instead, the adjoint of the convolution by the kernel
+  GaussianFilter(
+    const VolData& vol,
+    const VolData& kernel,
+    const std::vector<float>& fwhmXYZ,
+    float cutRadius = 0.0,
+    bool mirrored = false);
+
+  // Filter all frames of a volume of the size of the volume
+  // given at construction
+  void apply(VolData& vol);
+
+  // Backend used (not AUTO)
+  Backend getBackend() const;
+
+  static Backend getBackend(const std::string& name);
+  static std::string getBackendName(Backend backend);
+
+private:
+
+  struct Kernel
+  {
+    int halfSize;
+
+    // [halfSize + offset] Weight of each offset
+    std::vector<float> weights;
+
+    // [coord] Sum of the weights of the offsets within the
+    // volume from each coordinate
+    std::vector<float> norms;
+  };
+
+  // Young - van Vliet recursive filter along a dimension
+  struct RecursiveKernel
+  {
+    // Coefficients of the causal and anti-causal passes
+    double gain;
+    double b1, b2, b3;
+
+    // Zeros appended to the lines before the anti-causal pass
+    int nPaddingVoxels;
+
+    // [coord] Response to a line of ones within the volume
+    std::vector<float> norms;
+  };
+
+  // twoSigmaSquared: 2 sigma^2 in mm^2
+  static Kernel getKernel(
+    double sigma,
+    double twoSigmaSquared,
+    types::SpatialExtent voxelExtent,
+    int nVoxels);
+
+  static RecursiveKernel getRecursiveKernel(
+    double sigma,
+    types::SpatialExtent voxelExtent,
+    int nVoxels);
+
+  // Voxels filtered in XY from cutRadius
+  void setFilteredRows(
+    const VolData& vol,
+    const std::vector<float>& fwhmXYZ,
+    float cutRadius);
+
+  // Passes from input to output
+  void filterX(
+    const types::VoxelValue* input,
+    types::VoxelValue* output) const;
+  void filterY(
+    const types::VoxelValue* input,
+    types::VoxelValue* output) const;
+
+  // Voxels outside mFilteredRows are left unchanged
+  void filterZ(
+    const types::VoxelValue* input,
+    types::VoxelValue* output) const;
+
+  // Recursive pass along lines of n elements at stride apart,
+  // each element being a range of width contiguous voxels.
+  // Only the voxels [first, end) of each element are written.
+  static void filterRecursive(
+    const RecursiveKernel& kernel,
+    const types::VoxelValue* input,
+    types::VoxelValue* output,
+    int n,
+    std::size_t stride,
+    int width,
+    int first,
+    int end,
+    std::vector<double>& buffer);
+
+  void applyRecursive(types::VoxelValue* dataArray);
+
+  types::VolSize mVolSize;
+  types::VoxelExtent mVoxelExtent;
+  bool mEnabled;
+  Backend mBackend;
+
+  Kernel mKernelX;
+  Kernel mKernelY;
+  Kernel mKernelZ;
+
+  RecursiveKernel mRecursiveKernelX;
+  RecursiveKernel mRecursiveKernelY;
+  RecursiveKernel mRecursiveKernelZ;
+
+  std::unique_ptr<FFTConvolver> mFFTConvolver;
+
+  // [j] First and end X indices of the voxels of row j of each
+  // slice that are filtered
+  std::vector<std::pair<int, int>> mFilteredRows;
+
+  // Volumes filtered in X, then in X and Y
+  std::vector<types::VoxelValue> mImage1;
+  std::vector<types::VoxelValue> mImage2;
+};
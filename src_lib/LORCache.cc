@@ -115,6 +115,27 @@ int LORCache::setSubsetAndSegment(int subset, int seg)
 std::tuple<bool, int, int, int, int, int> LORCache::getLOR(
   int index) const
 {
+  return getLOR(mCurrentSubset, mCurrentSegment, index);
+}
+
+void LORCache::disableLOR(int index)
+{
+  mCrystalArrayForCurrentSubsetAndSegment[index].crystal1 =
+    INVALID;
+}
+
+int LORCache::getNBinsPerView(int seg) const
+{
+  return mNBinsPerViewForEachSegment[seg + mSegOffset];
+}
+
+std::tuple<bool, int, int, int, int, int> LORCache::getLOR(
+  int subset,
+  int seg,
+  int index) const
+{
+  const auto nBinsPerView = getNBinsPerView(seg);
+
   int binIndex;
   if (mNSubsets == 1)
   {
@@ -122,18 +143,15 @@ std::tuple<bool, int, int, int, int, int> LORCache::getLOR(
   }
   else
   {
-    const auto divIndex =
-      std::div(index, mNBinsPerViewForCurrentSegment);
+    const auto divIndex = std::div(index, nBinsPerView);
 
-    const auto view =
-      divIndex.quot * mNSubsets + mCurrentSubset;
+    const auto view = divIndex.quot * mNSubsets + subset;
 
-    binIndex =
-      view * mNBinsPerViewForCurrentSegment + divIndex.rem;
+    binIndex = view * nBinsPerView + divIndex.rem;
   }
 
   const auto lor =
-    mCrystalArrayForCurrentSubsetAndSegment[index];
+    mCrystalArray[subset][seg + mSegOffset][index];
 
   const auto valid = lor.crystal1 != INVALID;
 
@@ -160,9 +178,3 @@ std::tuple<bool, int, int, int, int, int> LORCache::getLOR(
     crystalAxialCoord2,
     crystalAngCoord2};
 }
-
-void LORCache::disableLOR(int index)
-{
-  mCrystalArrayForCurrentSubsetAndSegment[index].crystal1 =
-    INVALID;
-}
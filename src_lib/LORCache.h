@@ -1,3 +1,5 @@
+#pragma once
+
 #include <ProjData.h>
 
 #include <tuple>
@@ -30,6 +32,16 @@ public:
 
   void disableLOR(int index);
 
+  // Number of bins per view for a given segment
+  int getNBinsPerView(int segment) const;
+
+  // Same as above for a given subset and segment, independently
+  // of the current subset and segment
+  std::tuple<bool, int, int, int, int, int> getLOR(
+    int subset,
+    int segment,
+    int index) const;
+
 private:
 
   int mNSubsets, mNViewsPerSubset;
@@ -0,0 +1,373 @@
+#include <LORList.h>
+
+#include <LORCache.h>
+#include <Siddon.h>
+#include <console.h>
+#include <macros.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+
+// Interleave the 16 lower bits of each coordinate, the last
+// coordinate being the most significant
+static std::uint64_t getMortonCode(
+  const std::array<std::uint64_t, 4>& coords)
+{
+  std::uint64_t code{0};
+
+  LOOP(bit, 0, 15)
+  LOOP(dim, 0, 3)
+  {
+    code |= ((coords[dim] >> bit) & 1) << (4 * bit + dim);
+  }
+
+  return code;
+}
+
+LORList::LORList(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets,
+  double cutRadius,
+  Ordering ordering):
+  mProjHeader{proj.getHeader()},
+  mVolHeader{vol.getHeader()},
+  mNSubsets{nSubsets},
+  mSegOffset{proj.getGeometry().segOffset},
+  mNSegments{proj.getHeader().nSegments},
+  mCutRadius{cutRadius},
+  mOrdering{ordering},
+  mNonZeroBinsOnly{false}
+{
+  // Check proj data dimensions and number of subsets
+  scanner.checkProjData(proj);
+  proj.checkNSubsets(nSubsets);
+
+  if (cutRadius < 0.0)
+  {
+    error("Cut radius must not be negative");
+  }
+
+  echo("Computing LOR lists");
+
+  Siddon siddon(vol);
+  LORCache cache(proj, nSubsets);
+
+  mNBinsPerViewForEachSegment.resize(mNSegments);
+  LOOP_SEG(seg, proj)
+  {
+    mNBinsPerViewForEachSegment[seg + mSegOffset] =
+      cache.getNBinsPerView(seg);
+  }
+
+  // Center of the volume in XY
+  const auto& voxelExtent = mVolHeader.voxelExtent;
+  const auto& volExtent = vol.getVolExtent();
+  const auto centerX = mVolHeader.volOffset.x -
+    voxelExtent.pixelWidth / 2.0 + volExtent.sliceWidth / 2.0;
+  const auto centerY = mVolHeader.volOffset.y -
+    voxelExtent.pixelHeight / 2.0 + volExtent.sliceHeight / 2.0;
+
+  // Voxels are cut from their center: LORs passing within half
+  // a voxel diagonal of the cylinder can still cross a voxel
+  // that is kept
+  const auto maxDistance = cutRadius +
+    std::sqrt(
+      voxelExtent.pixelWidth * voxelExtent.pixelWidth +
+      voxelExtent.pixelHeight * voxelExtent.pixelHeight) /
+      2.0;
+
+  // Voxel grid of the Morton codes
+  const auto& volSize = mVolHeader.volSize;
+  const std::array<double, 3> volOrigin{
+    mVolHeader.volOffset.x - voxelExtent.pixelWidth / 2.0,
+    mVolHeader.volOffset.y - voxelExtent.pixelHeight / 2.0,
+    mVolHeader.volOffset.z - volExtent.volDepth / 2.0};
+  const std::array<double, 3> voxelSize{
+    voxelExtent.pixelWidth,
+    voxelExtent.pixelHeight,
+    voxelExtent.sliceThickness};
+  const std::array<int, 3> volSizeXYZ{
+    volSize.nPixelsX,
+    volSize.nPixelsY,
+    volSize.nSlices};
+
+  const auto packetSize = siddon.getPacketSize();
+  const auto nViewsPerSubset =
+    proj.getGeometry().nViews / nSubsets;
+
+  mBlocks.resize(mNSubsets * mNSegments);
+
+  LOOP(subset, 0, mNSubsets - 1)
+  LOOP_SEG(seg, proj)
+  {
+    auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+    const auto nBinsPerView = cache.getNBinsPerView(seg);
+    const auto nLORs = nViewsPerSubset * nBinsPerView;
+    const auto nPackets = (nLORs + packetSize - 1) / packetSize;
+
+    // [index] 1 if LOR is kept
+    std::vector<char> kept(nLORs);
+
+    // [index] Morton code of LOR if ordered
+    std::vector<std::uint64_t> codes(
+      ordering == Ordering::MORTON ? nLORs : 0);
+
+#pragma omp parallel for schedule(static)
+    LOOP(packetIndex, 0, nPackets - 1)
+    {
+      const auto firstIndex = packetIndex * packetSize;
+      const auto nLORsInPacket =
+        MIN(packetSize, nLORs - firstIndex);
+
+      Siddon::Packet packet;
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        const auto
+          [valid,
+           binIndex,
+           crystalAxialCoord1,
+           crystalAngCoord1,
+           crystalAxialCoord2,
+           crystalAngCoord2] =
+            cache.getLOR(subset, seg, firstIndex + lane);
+
+        siddon.addToPacket(
+          packet,
+          scanner,
+          crystalAxialCoord1,
+          crystalAngCoord1,
+          crystalAxialCoord2,
+          crystalAngCoord2);
+      }
+
+      Siddon::RayPacket rays;
+      siddon.computeRayPacket(packet, rays);
+
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        auto keep = rays.crosses[lane];
+
+        // Distance from the center to the LOR in XY
+        if (keep && cutRadius > 0.0)
+        {
+          const auto crys1X = packet.crys1X[lane];
+          const auto crys1Y = packet.crys1Y[lane];
+          const auto diffX = packet.crys2X[lane] - crys1X;
+          const auto diffY = packet.crys2Y[lane] - crys1Y;
+
+          const auto distance =
+            std::abs(
+              diffX * (centerY - crys1Y) -
+              diffY * (centerX - crys1X)) /
+            std::sqrt(diffX * diffX + diffY * diffY);
+
+          keep = distance <= maxDistance;
+        }
+
+        kept[firstIndex + lane] = keep ? 1 : 0;
+
+        if (keep && ordering == Ordering::MORTON)
+        {
+          // Voxel containing the middle of the LOR
+          const std::array<double, 3> middle{
+            (packet.crys1X[lane] + packet.crys2X[lane]) / 2.0,
+            (packet.crys1Y[lane] + packet.crys2Y[lane]) / 2.0,
+            (packet.crys1Z[lane] + packet.crys2Z[lane]) / 2.0};
+
+          std::array<std::uint64_t, 4> coords{};
+          LOOP(dim, 0, 2)
+          {
+            const auto voxelCoord = std::floor(
+              (middle[dim] - volOrigin[dim]) / voxelSize[dim]);
+
+            coords[dim] = (std::uint64_t)MAX(
+              0.0,
+              MIN(voxelCoord, volSizeXYZ[dim] - 1.0));
+          }
+
+          // View is the most significant coordinate
+          coords[3] = (firstIndex + lane) / nBinsPerView;
+
+          codes[firstIndex + lane] = getMortonCode(coords);
+        }
+      }
+    }
+
+    // Compaction
+    block.viewOffsets.resize(nViewsPerSubset + 1);
+    LOOP(subview, 0, nViewsPerSubset - 1)
+    {
+      block.viewOffsets[subview] = block.indices.size();
+
+      LOOP(
+        index,
+        subview * nBinsPerView,
+        (subview + 1) * nBinsPerView - 1)
+      {
+        if (kept[index] != 0)
+        {
+          block.indices.push_back(index);
+        }
+      }
+    }
+    block.viewOffsets[nViewsPerSubset] = block.indices.size();
+
+    block.indices.shrink_to_fit();
+
+    // Locality order, ties in LORCache order
+    if (ordering == Ordering::MORTON)
+    {
+      block.orderedIndices = block.indices;
+      std::stable_sort(
+        block.orderedIndices.begin(),
+        block.orderedIndices.end(),
+        [&](int index1, int index2)
+        {
+          return codes[index1] < codes[index2];
+        });
+    }
+  }
+}
+
+LORList::LORList(const LORList& lorList, const ProjData& proj):
+  mProjHeader{lorList.mProjHeader},
+  mVolHeader{lorList.mVolHeader},
+  mNSubsets{lorList.mNSubsets},
+  mSegOffset{lorList.mSegOffset},
+  mNSegments{lorList.mNSegments},
+  mCutRadius{lorList.mCutRadius},
+  mOrdering{lorList.mOrdering},
+  mNonZeroBinsOnly{true},
+  mNBinsPerViewForEachSegment{
+    lorList.mNBinsPerViewForEachSegment},
+  mBlocks(lorList.mBlocks.size())
+{
+  if (!(proj.getHeader() == mProjHeader))
+  {
+    error("LOR lists were computed for a different "
+          "configuration");
+  }
+
+  echo("Computing LOR lists of non-zero bins");
+
+  LORCache cache(proj, mNSubsets);
+
+  LOOP(subset, 0, mNSubsets - 1)
+  LOOP_SEG(seg, proj)
+  {
+    const auto& inputBlock =
+      lorList.mBlocks[getBlockIndex(subset, seg)];
+    auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+    const auto isNonZero = [&](int index)
+    {
+      const auto binIndex =
+        std::get<1>(cache.getLOR(subset, seg, index));
+
+      return BIN(proj, seg, binIndex) != 0.0;
+    };
+
+    const auto nViewsPerSubset =
+      (int)inputBlock.viewOffsets.size() - 1;
+    block.viewOffsets.resize(nViewsPerSubset + 1);
+    LOOP(subview, 0, nViewsPerSubset - 1)
+    {
+      block.viewOffsets[subview] = block.indices.size();
+
+      LOOP(
+        position,
+        inputBlock.viewOffsets[subview],
+        inputBlock.viewOffsets[subview + 1] - 1)
+      {
+        const auto index = inputBlock.indices[position];
+        if (isNonZero(index))
+        {
+          block.indices.push_back(index);
+        }
+      }
+    }
+    block.viewOffsets[nViewsPerSubset] = block.indices.size();
+
+    for (const auto index : inputBlock.orderedIndices)
+    {
+      if (isNonZero(index))
+      {
+        block.orderedIndices.push_back(index);
+      }
+    }
+  }
+}
+
+void LORList::checkConfiguration(
+  const ProjData& proj,
+  const VolData& vol,
+  int nSubsets,
+  double cutRadius,
+  bool nonZeroBinsOnly) const
+{
+  if (
+    !(proj.getHeader() == mProjHeader) ||
+    vol.getHeader() != mVolHeader || nSubsets != mNSubsets)
+  {
+    error("LOR lists were computed for a different "
+          "configuration");
+  }
+
+  if (cutRadius != mCutRadius)
+  {
+    error(
+      "LOR lists were computed for a cut radius of ",
+      mCutRadius,
+      " mm instead of ",
+      cutRadius,
+      " mm");
+  }
+
+  if (mNonZeroBinsOnly && !nonZeroBinsOnly)
+  {
+    error("LOR lists of non-zero bins only can't be used "
+          "here");
+  }
+}
+
+void LORList::printContent() const
+{
+  std::int64_t nLORs{0};
+  std::int64_t nBins{0};
+  LOOP(subset, 0, mNSubsets - 1)
+  LOOP(seg, -mSegOffset, mSegOffset)
+  {
+    const auto& block = mBlocks[getBlockIndex(subset, seg)];
+    nLORs += block.indices.size();
+    nBins += (std::int64_t)(block.viewOffsets.size() - 1) *
+      mNBinsPerViewForEachSegment[seg + mSegOffset];
+  }
+
+  printValue("LOR lists cut radius in mm", mCutRadius);
+  printValue(
+    "LOR lists ordering",
+    mOrdering == Ordering::MORTON ? "Morton" : "cache");
+  printValue("LOR lists non-zero bins only", mNonZeroBinsOnly);
+  printValue("LOR lists number of LORs", nLORs);
+  printValue("LOR lists number of bins", nBins);
+  printEmptyLine();
+}
+
+bool LORList::contains(int subset, int seg, int index) const
+{
+  const auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+  const auto subview =
+    index / mNBinsPerViewForEachSegment[seg + mSegOffset];
+
+  return std::binary_search(
+    block.indices.cbegin() + block.viewOffsets[subview],
+    block.indices.cbegin() + block.viewOffsets[subview + 1],
+    index);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <VolData.h>
+
+#include <utility>
+#include <vector>
+
+// Compact lists of the LORs crossing the volume
+//
+// The LORs of each subset and segment are set up once with the
+// packet tracer and only those crossing the volume are kept, by
+// their index in LORCache order, in increasing order. The
+// projectors iterate the lists instead of all LORs, so that the
+// LORs missing the volume are neither decoded nor traced.
+//
+// The packet projector can take the LORs of each subset and
+// segment in a locality order instead, so that consecutive LORs
+// cross neighbouring voxels. LORs are still decoded from their
+// index in LORCache order, which maps them to their bin.
+//
+// A list can be computed once and shared by the projections and
+// reconstructions of the same configuration.
+
+class LORList
+{
+public:
+
+  // Order of the LORs taken by the packet projector
+  enum class Ordering
+  {
+    // LORCache order (view, axial and tangential coordinates)
+    CACHE,
+
+    // Morton code of the view and of the voxel containing the
+    // middle of the LOR
+    MORTON
+  };
+
+  // cutRadius: Radius in mm of the cylinder centered on the
+  // volume (as in operations::cutCircle) that the LORs must
+  // also cross (0: No cylinder)
+  LORList(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    int nSubsets,
+    double cutRadius = 0.0,
+    Ordering ordering = Ordering::CACHE);
+
+  // LORs of lorList whose bin of proj is not zero, in the same
+  // order
+  LORList(const LORList& lorList, const ProjData& proj);
+
+  // Issue error if the lists were not computed for the same
+  // projection and volume dimensions, number of subsets and cut
+  // radius, or if they keep the LORs of non-zero bins only and
+  // nonZeroBinsOnly is false (such lists only fit projections
+  // whose zero bins add nothing)
+  void checkConfiguration(
+    const ProjData& proj,
+    const VolData& vol,
+    int nSubsets,
+    double cutRadius = 0.0,
+    bool nonZeroBinsOnly = false) const;
+
+  void printContent() const;
+
+  inline int getNSubsets() const;
+
+  // Number of LORs in the list of a subset and segment
+  inline int getNLORs(int subset, int seg) const;
+
+  // Index in LORCache order of the LOR at a position of the
+  // list of a subset and segment
+  inline int getIndex(int subset, int seg, int position) const;
+
+  // Same as getIndex with the list in the order of the packet
+  // projector
+  inline int getOrderedIndex(
+    int subset,
+    int seg,
+    int position) const;
+
+  // First and end positions in the list of the LORs of a view
+  // of the subset (subview: view / nSubsets)
+  inline std::pair<int, int> getViewRange(
+    int subset,
+    int seg,
+    int subview) const;
+
+  // True if the LOR at index in LORCache order is in the list
+  bool contains(int subset, int seg, int index) const;
+
+private:
+
+  struct Block
+  {
+    // [position] Index of each LOR in LORCache order
+    std::vector<int> indices;
+
+    // [subview] Position of the first LOR of each view of the
+    // subset, followed by the number of LORs
+    std::vector<int> viewOffsets;
+
+    // [position] Index of each LOR in LORCache order, in the
+    // order of the packet projector (empty: Same as indices)
+    std::vector<int> orderedIndices;
+  };
+
+  inline int getBlockIndex(int subset, int seg) const;
+
+  ProjHeader mProjHeader;
+  VolHeader mVolHeader;
+
+  int mNSubsets;
+  int mSegOffset;
+  int mNSegments;
+  double mCutRadius;
+  Ordering mOrdering;
+  bool mNonZeroBinsOnly;
+
+  // [seg + segOffset]
+  std::vector<int> mNBinsPerViewForEachSegment;
+
+  // [subset * nSegments + seg + segOffset]
+  std::vector<Block> mBlocks;
+};
+
+#include <LORList.inl>
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <LORList.h>
+
+int LORList::getNSubsets() const
+{
+  return mNSubsets;
+}
+
+int LORList::getNLORs(int subset, int seg) const
+{
+  return mBlocks[getBlockIndex(subset, seg)].indices.size();
+}
+
+int LORList::getIndex(int subset, int seg, int position) const
+{
+  return mBlocks[getBlockIndex(subset, seg)].indices[position];
+}
+
+int LORList::getOrderedIndex(
+  int subset,
+  int seg,
+  int position) const
+{
+  const auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+  return block.orderedIndices.empty() ?
+    block.indices[position] :
+    block.orderedIndices[position];
+}
+
+std::pair<int, int> LORList::getViewRange(
+  int subset,
+  int seg,
+  int subview) const
+{
+  const auto& viewOffsets =
+    mBlocks[getBlockIndex(subset, seg)].viewOffsets;
+
+  return {viewOffsets[subview], viewOffsets[subview + 1]};
+}
+
+int LORList::getBlockIndex(int subset, int seg) const
+{
+  return subset * mNSegments + seg + mSegOffset;
+}
@@ -0,0 +1,83 @@
+#include <MappedFile.h>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FIR_HAS_MMAP
+#endif
+
+MappedFile::MappedFile(
+  const std::string& fileName,
+  std::size_t offset,
+  std::size_t size)
+{
+#ifdef FIR_HAS_MMAP
+  if (size == 0)
+  {
+    return;
+  }
+
+  const auto fileDescriptor = open(fileName.c_str(), O_RDONLY);
+  if (fileDescriptor < 0)
+  {
+    return;
+  }
+
+  struct stat fileStatus;
+  std::size_t fileSize{0};
+  if (fstat(fileDescriptor, &fileStatus) == 0)
+  {
+    fileSize = fileStatus.st_size;
+  }
+
+  // Offset of the mapping must be a multiple of the page size
+  const auto pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+  const auto pageOffset = offset - offset % pageSize;
+
+  if (fileSize >= offset + size)
+  {
+    mMappingSize = offset - pageOffset + size;
+    mMapping = mmap(
+      nullptr,
+      mMappingSize,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE,
+      fileDescriptor,
+      (off_t)pageOffset);
+
+    if (mMapping == MAP_FAILED)
+    {
+      mMapping = nullptr;
+    }
+    else
+    {
+      mData = (char*)mMapping + (offset - pageOffset);
+    }
+  }
+
+  // Mapping kept after closing the file
+  close(fileDescriptor);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef FIR_HAS_MMAP
+  if (mMapping != nullptr)
+  {
+    munmap(mMapping, mMappingSize);
+  }
+#endif
+}
+
+bool MappedFile::isMapped() const
+{
+  return mData != nullptr;
+}
+
+char* MappedFile::getData() const
+{
+  return mData;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Part of a file mapped in memory: Its pages are read from the
+// file when first accessed, and a page written to is copied,
+// leaving the file unchanged (private mapping). Data stored in
+// a file as it is in memory is then used in place, without
+// being read into a buffer and copied.
+//
+// Note: A mapped file must not be truncated or rewritten, so
+// the writers of data files remove the previous file first.
+
+class MappedFile
+{
+public:
+
+  // Map size bytes of a file, from offset
+  // Not mapped if the file is too short or can't be mapped
+  // (e.g. system without mmap), to be read instead
+  MappedFile(
+    const std::string& fileName,
+    std::size_t offset,
+    std::size_t size);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isMapped() const;
+
+  // First of the size bytes mapped (nullptr if not mapped)
+  char* getData() const;
+
+private:
+
+  // Mapping from the page containing offset
+  void* mMapping{nullptr};
+  std::size_t mMappingSize{0};
+
+  char* mData{nullptr};
+};
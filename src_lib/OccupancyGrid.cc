@@ -0,0 +1,265 @@
+#include <OccupancyGrid.h>
+
+#include <console.h>
+#include <macros.h>
+
+#include <cmath>
+#include <cstddef>
+
+OccupancyGrid::OccupancyGrid(const VolData& vol, int brickSize)
+{
+  if (brickSize < 1)
+  {
+    error("Brick size must be positive");
+  }
+
+  const auto& header = vol.getHeader();
+  const auto& volSize = header.volSize;
+  const auto& voxelExtent = header.voxelExtent;
+  const auto& volExtent = vol.getVolExtent();
+
+  const int nVoxels[]{
+    volSize.nPixelsX,
+    volSize.nPixelsY,
+    volSize.nSlices};
+
+  mVoxelExtent[0] = voxelExtent.pixelWidth;
+  mVoxelExtent[1] = voxelExtent.pixelHeight;
+  mVoxelExtent[2] = voxelExtent.sliceThickness;
+
+  mLowPlanes[0] =
+    header.volOffset.x - voxelExtent.pixelWidth / 2;
+  mLowPlanes[1] =
+    header.volOffset.y - voxelExtent.pixelHeight / 2;
+  mLowPlanes[2] = header.volOffset.z - volExtent.volDepth / 2;
+
+  mHighPlanes[0] = mLowPlanes[0] + volExtent.sliceWidth;
+  mHighPlanes[1] = mLowPlanes[1] + volExtent.sliceHeight;
+  mHighPlanes[2] = mLowPlanes[2] + volExtent.volDepth;
+
+  LOOP(dim, 0, 2)
+  {
+    mBrickSize[dim] = MIN(brickSize, nVoxels[dim]);
+    mNBricks[dim] =
+      (nVoxels[dim] + mBrickSize[dim] - 1) / mBrickSize[dim];
+    mBrickExtent[dim] = mBrickSize[dim] * mVoxelExtent[dim];
+  }
+
+  mOccupied.assign(
+    (std::size_t)mNBricks[0] * mNBricks[1] * mNBricks[2],
+    0);
+
+  const auto* dataArray = vol.getDataArray();
+
+  // Each layer of bricks in Z set by a thread
+#pragma omp parallel for
+  LOOP(brickZ, 0, mNBricks[2] - 1)
+  {
+    const auto lastSlice = MIN(
+      (brickZ + 1) * mBrickSize[2],
+      volSize.nSlices) - 1;
+
+    LOOP(k, brickZ * mBrickSize[2], lastSlice)
+    LOOP(j, 0, volSize.nPixelsY - 1)
+    {
+      const auto* row = dataArray +
+        ((std::size_t)k * volSize.nPixelsY + j) *
+          volSize.nPixelsX;
+      auto* occupiedRow = &mOccupied
+        [((std::size_t)brickZ * mNBricks[1] +
+          j / mBrickSize[1]) *
+         mNBricks[0]];
+
+      LOOP(i, 0, volSize.nPixelsX - 1)
+      {
+        if (row[i] != 0.0)
+        {
+          occupiedRow[i / mBrickSize[0]] = 1;
+        }
+      }
+    }
+  }
+
+  mNOccupied = 0;
+  for (const auto occupied : mOccupied)
+  {
+    mNOccupied += occupied != 0;
+  }
+}
+
+void OccupancyGrid::printContent() const
+{
+  printValue("Occupancy grid brick size (x)", mBrickSize[0]);
+  printValue("Occupancy grid brick size (y)", mBrickSize[1]);
+  printValue("Occupancy grid brick size (z)", mBrickSize[2]);
+  printValue(
+    "Occupancy grid number of bricks",
+    mOccupied.size());
+  printValue("Occupancy grid occupied bricks", mNOccupied);
+  printEmptyLine();
+}
+
+bool OccupancyGrid::crossesOccupied(
+  types::SpatialCoord crys1X,
+  types::SpatialCoord crys1Y,
+  types::SpatialCoord crys1Z,
+  types::SpatialCoord crys2X,
+  types::SpatialCoord crys2Y,
+  types::SpatialCoord crys2Z) const
+{
+  if (mNOccupied == 0)
+  {
+    return false;
+  }
+
+  const double crys1[]{crys1X, crys1Y, crys1Z};
+  const double diff[]{
+    crys2X - crys1[0],
+    crys2Y - crys1[1],
+    crys2Z - crys1[2]};
+
+  // Brick index of a coordinate, within the grid
+  const auto getBrick = [this](int dim, double coord)
+  {
+    const auto brick = (int)std::floor(
+      (coord - mLowPlanes[dim]) / mBrickExtent[dim]);
+
+    return MAX(0, MIN(mNBricks[dim] - 1, brick));
+  };
+
+  // Part of the LOR within the volume widened by a voxel
+  double alphaMin{0.0};
+  double alphaMax{1.0};
+  LOOP(dim, 0, 2)
+  {
+    const auto lowPlane = mLowPlanes[dim] - mVoxelExtent[dim];
+    const auto highPlane = mHighPlanes[dim] + mVoxelExtent[dim];
+
+    if (ABS(diff[dim]) > EPSILON)
+    {
+      const auto alpha1 = (lowPlane - crys1[dim]) / diff[dim];
+      const auto alpha2 = (highPlane - crys1[dim]) / diff[dim];
+
+      alphaMin = MAX(alphaMin, MIN(alpha1, alpha2));
+      alphaMax = MIN(alphaMax, MAX(alpha1, alpha2));
+    }
+    else if (crys1[dim] < lowPlane || crys1[dim] > highPlane)
+    {
+      return false;
+    }
+  }
+
+  if (alphaMin > alphaMax)
+  {
+    return false;
+  }
+
+  // Layers of bricks crossed along the dimension in which the
+  // LOR crosses the most bricks
+  auto mainDim = 0;
+  LOOP(dim, 1, 2)
+  {
+    if (
+      ABS(diff[dim]) / mBrickExtent[dim] >
+      ABS(diff[mainDim]) / mBrickExtent[mainDim])
+    {
+      mainDim = dim;
+    }
+  }
+
+  if (ABS(diff[mainDim]) <= EPSILON)
+  {
+    return true;
+  }
+
+  const auto dim1 = (mainDim + 1) % 3;
+  const auto dim2 = (mainDim + 2) % 3;
+
+  const auto coord1 = crys1[mainDim] + alphaMin * diff[mainDim];
+  const auto coord2 = crys1[mainDim] + alphaMax * diff[mainDim];
+  const auto margin = mVoxelExtent[mainDim];
+
+  const auto firstLayer =
+    getBrick(mainDim, MIN(coord1, coord2) - margin);
+  const auto lastLayer =
+    getBrick(mainDim, MAX(coord1, coord2) + margin);
+
+  LOOP(layer, firstLayer, lastLayer)
+  {
+    // Part of the LOR within a voxel of the layer
+    const auto layerLow =
+      mLowPlanes[mainDim] + layer * mBrickExtent[mainDim] -
+      margin;
+    const auto layerHigh =
+      layerLow + mBrickExtent[mainDim] + 2 * margin;
+
+    const auto alpha1 =
+      (layerLow - crys1[mainDim]) / diff[mainDim];
+    const auto alpha2 =
+      (layerHigh - crys1[mainDim]) / diff[mainDim];
+    const auto layerAlphaMin =
+      MAX(alphaMin, MIN(alpha1, alpha2));
+    const auto layerAlphaMax =
+      MIN(alphaMax, MAX(alpha1, alpha2));
+
+    if (layerAlphaMin > layerAlphaMax)
+    {
+      continue;
+    }
+
+    // Bricks of the layer within a voxel of that part
+    int firstBrick[3], lastBrick[3];
+    for (const auto dim : {dim1, dim2})
+    {
+      const auto layerCoord1 =
+        crys1[dim] + layerAlphaMin * diff[dim];
+      const auto layerCoord2 =
+        crys1[dim] + layerAlphaMax * diff[dim];
+
+      firstBrick[dim] = getBrick(
+        dim,
+        MIN(layerCoord1, layerCoord2) - mVoxelExtent[dim]);
+      lastBrick[dim] = getBrick(
+        dim,
+        MAX(layerCoord1, layerCoord2) + mVoxelExtent[dim]);
+    }
+    firstBrick[mainDim] = layer;
+    lastBrick[mainDim] = layer;
+
+    LOOP(brickZ, firstBrick[2], lastBrick[2])
+    LOOP(brickY, firstBrick[1], lastBrick[1])
+    LOOP(brickX, firstBrick[0], lastBrick[0])
+    {
+      if (mOccupied
+            [((std::size_t)brickZ * mNBricks[1] + brickY) *
+               mNBricks[0] +
+             brickX])
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool OccupancyGrid::crossesOccupiedBetweenCrystals(
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAngCoord1,
+  int crysAxialCoord2,
+  int crysAngCoord2) const
+{
+  const auto* crystalXYPositionVector =
+    scanner.getCrystalXYPositionVector();
+  const auto* sliceZPositionVector =
+    scanner.getSliceZPositionVector();
+
+  return crossesOccupied(
+    crystalXYPositionVector[crysAngCoord1].x,
+    crystalXYPositionVector[crysAngCoord1].y,
+    sliceZPositionVector[crysAxialCoord1],
+    crystalXYPositionVector[crysAngCoord2].x,
+    crystalXYPositionVector[crysAngCoord2].y,
+    sliceZPositionVector[crysAxialCoord2]);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ScannerData.h>
+#include <VolData.h>
+#include <types.h>
+
+#include <vector>
+
+// Coarse occupancy of the active frame of a volume by bricks of
+// voxels, to skip the LORs crossing empty space only
+//
+// A brick is occupied if one of its voxels is not zero. The
+// test of a LOR is conservative: The bricks within a voxel of
+// the LOR are checked, so that a LOR reported as crossing
+// empty bricks only is traced through zero voxels only by
+// Siddon, and its projection is zero. Projections skipping
+// those LORs are the same as without skipping.
+
+class OccupancyGrid
+{
+public:
+
+  static constexpr int DEFAULT_BRICK_SIZE{8};
+
+  // brickSize: Number of voxels of the bricks in X, Y and Z
+  // (fewer in Z for volumes with fewer slices)
+  explicit OccupancyGrid(
+    const VolData& vol,
+    int brickSize = DEFAULT_BRICK_SIZE);
+
+  void printContent() const;
+
+  // True if a brick crossed by the LOR is occupied (or may be,
+  // within a voxel)
+  bool crossesOccupied(
+    types::SpatialCoord crys1X,
+    types::SpatialCoord crys1Y,
+    types::SpatialCoord crys1Z,
+    types::SpatialCoord crys2X,
+    types::SpatialCoord crys2Y,
+    types::SpatialCoord crys2Z) const;
+
+  bool crossesOccupiedBetweenCrystals(
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAngCoord1,
+    int crysAxialCoord2,
+    int crysAngCoord2) const;
+
+private:
+
+  // Bricks in each dimension
+  int mNBricks[3];
+  int mBrickSize[3];
+
+  // Same planes as Siddon
+  double mLowPlanes[3];
+  double mHighPlanes[3];
+
+  double mVoxelExtent[3];
+
+  // [dim] Extent of a brick in mm
+  double mBrickExtent[3];
+
+  // [(brickZ * nBricksY + brickY) * nBricksX + brickX] Non-zero
+  // if one of the voxels of the brick is not zero
+  std::vector<char> mOccupied;
+  int mNOccupied;
+};
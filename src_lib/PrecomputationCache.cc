@@ -0,0 +1,285 @@
+#include <PrecomputationCache.h>
+
+#include <console.h>
+#include <tools.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define FIR_HAS_GETPID
+#endif
+
+// Changed whenever the entries or their keys are computed
+// differently, so that older entries are not reused
+constexpr std::uint64_t CACHE_VERSION{1};
+
+template<typename T>
+static std::uint64_t hashValue(
+  const T& value,
+  std::uint64_t seed)
+{
+  return hashBytes(&value, sizeof(T), seed);
+}
+
+// Hash of the kind of entry, as seed of its key
+static std::uint64_t hashName(const std::string& name)
+{
+  const auto hash = hashBytes(name.data(), name.size());
+
+  return hashValue(CACHE_VERSION, hash);
+}
+
+// Note: Fields are hashed one by one to avoid padding bytes
+static std::uint64_t hashProjHeader(
+  const ProjHeader& header,
+  std::uint64_t seed)
+{
+  auto hash = hashValue(header.nRings, seed);
+  hash = hashValue(header.nCrystalsPerRing, hash);
+  hash = hashValue(header.segmentSpan, hash);
+  hash = hashValue(header.nSegments, hash);
+  hash = hashValue(header.nTangCoords, hash);
+
+  return hash;
+}
+
+static std::uint64_t hashVolHeader(
+  const VolHeader& header,
+  std::uint64_t seed)
+{
+  auto hash = hashValue(header.volSize.nPixelsX, seed);
+  hash = hashValue(header.volSize.nPixelsY, hash);
+  hash = hashValue(header.volSize.nSlices, hash);
+  hash = hashValue(header.voxelExtent.pixelWidth, hash);
+  hash = hashValue(header.voxelExtent.pixelHeight, hash);
+  hash = hashValue(header.voxelExtent.sliceThickness, hash);
+  hash = hashValue(header.volOffset.x, hash);
+  hash = hashValue(header.volOffset.y, hash);
+  hash = hashValue(header.volOffset.z, hash);
+  hash = hashValue(header.nFrames, hash);
+
+  return hash;
+}
+
+// Positions of the crystals, derived from the scanner header
+static std::uint64_t hashScanner(
+  const ScannerData& scanner,
+  std::uint64_t seed)
+{
+  const auto& geometry = scanner.getGeometry();
+
+  auto hash = hashBytes(
+    scanner.getCrystalXYPositionVector(),
+    geometry.nCrystalsPerRing * sizeof(types::SpatialCoords2D),
+    seed);
+  hash = hashBytes(
+    scanner.getSliceZPositionVector(),
+    geometry.nSlices * sizeof(types::SpatialCoord),
+    hash);
+
+  return hash;
+}
+
+// Identifier of the writing process (random without getpid)
+static unsigned long getWriterId()
+{
+#ifdef FIR_HAS_GETPID
+  return getpid();
+#else
+  static const auto writerId = std::random_device()();
+
+  return writerId;
+#endif
+}
+
+PrecomputationCache::PrecomputationCache(
+  const std::string& directory):
+  mDirectory{directory}
+{
+  if (directory.empty())
+  {
+    error("No cache directory provided");
+  }
+
+  std::error_code errorCode;
+  std::filesystem::create_directories(directory, errorCode);
+  if (errorCode || !std::filesystem::is_directory(directory))
+  {
+    error("Couldn't create cache directory ", directory);
+  }
+}
+
+void PrecomputationCache::printContent() const
+{
+  printValue("Precomputation cache directory", mDirectory);
+  printEmptyLine();
+}
+
+std::uint64_t PrecomputationCache::getSensitivityKey(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets)
+{
+  auto hash = hashProjHeader(
+    proj.getHeader(),
+    hashName("sensitivity"));
+  hash = hashScanner(scanner, hash);
+
+  // Frames of the map, one per subset
+  auto header = vol.getHeader();
+  header.nFrames = nSubsets;
+  hash = hashVolHeader(header, hash);
+
+  return hash;
+}
+
+std::uint64_t PrecomputationCache::getAttenuationKey(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& muMap)
+{
+  auto hash = hashProjHeader(
+    proj.getHeader(),
+    hashName("attenuation"));
+  hash = hashScanner(scanner, hash);
+  hash = hashVolHeader(muMap.getHeader(), hash);
+
+  // Frames are contiguous from the first one
+  const auto activeFrame = muMap.getActiveFrame();
+  muMap.setActiveFrame(0);
+  hash = hashBytes(
+    muMap.getDataArray(),
+    (std::size_t)muMap.getNVoxelsPerFrame() *
+      muMap.getNFrames() * sizeof(types::VoxelValue),
+    hash);
+  muMap.setActiveFrame(activeFrame);
+
+  return hash;
+}
+
+bool PrecomputationCache::contains(
+  const std::string& name,
+  std::uint64_t key) const
+{
+  return std::filesystem::exists(getPath(name, key) + ".done");
+}
+
+void PrecomputationCache::read(
+  const std::string& name,
+  std::uint64_t key,
+  VolData& vol) const
+{
+  checkEntry(name, key);
+
+  vol.read(
+    getPath(name, key) + ".h33",
+    VolData::ConstructionMode::READ_DATA);
+}
+
+void PrecomputationCache::read(
+  const std::string& name,
+  std::uint64_t key,
+  ProjData& proj) const
+{
+  checkEntry(name, key);
+
+  proj.read(
+    getPath(name, key) + ".hs",
+    ProjData::ConstructionMode::READ_DATA);
+}
+
+template<typename Data>
+void PrecomputationCache::writeEntry(
+  const std::string& name,
+  std::uint64_t key,
+  const Data& data) const
+{
+  const std::filesystem::path path = getPath(name, key);
+  const std::filesystem::path tempDirectory =
+    path.string() + "." + std::to_string(getWriterId()) +
+    ".tmp";
+
+  std::error_code errorCode;
+  std::filesystem::create_directory(tempDirectory, errorCode);
+  if (errorCode)
+  {
+    error("Couldn't write cache entry ", path.string());
+  }
+
+  data.write((tempDirectory / path.filename()).string());
+
+  // Files renamed into place, replacing those of the previous
+  // entry without being written over
+  for (const auto& file :
+       std::filesystem::directory_iterator(tempDirectory))
+  {
+    std::filesystem::rename(
+      file.path(),
+      path.parent_path() / file.path().filename(),
+      errorCode);
+    if (errorCode)
+    {
+      error("Couldn't write cache entry ", path.string());
+    }
+  }
+  std::filesystem::remove(tempDirectory, errorCode);
+
+  markEntry(name, key);
+}
+
+void PrecomputationCache::write(
+  const std::string& name,
+  std::uint64_t key,
+  const VolData& vol) const
+{
+  writeEntry(name, key, vol);
+}
+
+void PrecomputationCache::write(
+  const std::string& name,
+  std::uint64_t key,
+  const ProjData& proj) const
+{
+  writeEntry(name, key, proj);
+}
+
+std::string PrecomputationCache::getPath(
+  const std::string& name,
+  std::uint64_t key) const
+{
+  std::ostringstream path;
+  path << name << "_" << std::hex << std::setw(16)
+       << std::setfill('0') << key;
+
+  return (std::filesystem::path(mDirectory) / path.str())
+    .string();
+}
+
+void PrecomputationCache::checkEntry(
+  const std::string& name,
+  std::uint64_t key) const
+{
+  if (!contains(name, key))
+  {
+    error("No complete cache entry ", getPath(name, key));
+  }
+}
+
+void PrecomputationCache::markEntry(
+  const std::string& name,
+  std::uint64_t key) const
+{
+  std::ofstream os(getPath(name, key) + ".done");
+  if (!os.is_open())
+  {
+    error("Couldn't write cache entry ", getPath(name, key));
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <VolData.h>
+
+#include <cstdint>
+#include <string>
+
+// Directory of precomputed volumes and projections (sensitivity
+// maps, attenuation correction factors), each named after a
+// hash of everything it depends on. An entry is reused by the
+// reconstructions of the same configuration, and a different
+// configuration gets a different entry instead of a stale one.
+//
+// Entries are Interfile files followed by a marker file written
+// last, so that an entry whose writing was interrupted is
+// computed again. The files are written in a directory of the
+// writing process and renamed into place, so that processes
+// sharing the cache never read or write over partial files.
+
+class PrecomputationCache
+{
+public:
+
+  // directory: Created if absent
+  explicit PrecomputationCache(const std::string& directory);
+
+  void printContent() const;
+
+  // Key of the sensitivity map of OSEM
+  static std::uint64_t getSensitivityKey(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    int nSubsets);
+
+  // Key of the attenuation correction factors of a mu map (all
+  // voxel values included)
+  static std::uint64_t getAttenuationKey(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& muMap);
+
+  // name: Kind of entry, prefix of its files
+  bool contains(
+    const std::string& name,
+    std::uint64_t key) const;
+
+  // Read an entry (error if absent)
+  void read(
+    const std::string& name,
+    std::uint64_t key,
+    VolData& vol) const;
+  void read(
+    const std::string& name,
+    std::uint64_t key,
+    ProjData& proj) const;
+
+  // Write an entry, replacing the previous one if any
+  void write(
+    const std::string& name,
+    std::uint64_t key,
+    const VolData& vol) const;
+  void write(
+    const std::string& name,
+    std::uint64_t key,
+    const ProjData& proj) const;
+
+private:
+
+  // Write the files of an entry (VolData or ProjData) and
+  // mark it as complete
+  template<typename Data>
+  void writeEntry(
+    const std::string& name,
+    std::uint64_t key,
+    const Data& data) const;
+
+  // Path of the files of an entry, without extension
+  std::string getPath(
+    const std::string& name,
+    std::uint64_t key) const;
+
+  // Check that an entry is complete before reading it, and
+  // mark it as complete after writing it
+  void checkEntry(
+    const std::string& name,
+    std::uint64_t key) const;
+  void markEntry(
+    const std::string& name,
+    std::uint64_t key) const;
+
+  std::string mDirectory;
+};
@@ -3,6 +3,7 @@
 #include <ProjInterfileReader.h>
 #include <console.h>
 #include <macros.h>
+#include <tools.h>
 
 #include <cassert>
 #include <cmath>
@@ -62,8 +63,26 @@ void ProjData::read(
 
   case ConstructionMode::READ_DATA:
 
-    allocate(false);
-    reader.readData(mDataArray);
+    // Segments used in place in the data file if it can be
+    // mapped (see MappedFile), read otherwise
+    mMappedFile = reader.mapData();
+    if (mMappedFile == nullptr)
+    {
+      allocate(false);
+      reader.readData(mDataArray);
+      break;
+    }
+
+    mDataArray = (types::BinValue**)std::malloc(
+      mHeader.nSegments * sizeof(types::BinValue*));
+
+    auto* bins = (types::BinValue*)mMappedFile->getData();
+    LOOP(seg, -mGeometry.segOffset, mGeometry.segOffset)
+    {
+      mDataArray[seg + mGeometry.segOffset] = bins;
+      bins += mGeometry.nViews *
+        mGeometry.getNAxialCoords(seg) * mHeader.nTangCoords;
+    }
     break;
   }
 }
@@ -339,6 +358,29 @@ std::tuple<int, int> ProjData::getCrystalAngCoord(
   return {crystalAngCoord1, crystalAngCoord2};
 }
 
+int ProjData::getReferenceAxialCoord(int seg) const
+{
+  const auto [centralAxialCoord1, centralAxialCoord2] =
+    getCrystalAxialCoord(
+      seg,
+      mGeometry.getNAxialCoords(seg) / 2);
+
+  LOOP_AXIAL(axialCoord, *this, seg)
+  {
+    const auto [crystalAxialCoord1, crystalAxialCoord2] =
+      getCrystalAxialCoord(seg, axialCoord);
+
+    if (
+      crystalAxialCoord1 - crystalAxialCoord2 ==
+      centralAxialCoord1 - centralAxialCoord2)
+    {
+      return axialCoord;
+    }
+  }
+
+  return mGeometry.getNAxialCoords(seg) / 2;
+}
+
 bool ProjData::getBinCoordinates(
   int crystalAxialCoord1,
   int crystalAngCoord1,
@@ -614,6 +656,141 @@ void ProjData::rebinWeight()
   }
 }
 
+void ProjData::multiplyBinWeights(const ProjData& weights)
+{
+  if (!(weights.mHeader == mHeader))
+  {
+    error("Bin weights not the same size as the projection");
+  }
+
+  // Compressed weights expanded before being multiplied
+  if (mBinWeights.empty())
+  {
+    mBinWeights.resize(mHeader.nSegments);
+  }
+
+  LOOP(seg, -mGeometry.segOffset, mGeometry.segOffset)
+  {
+    const auto nBinsInSegment = mGeometry.nViews *
+      mGeometry.getNAxialCoords(seg) * mHeader.nTangCoords;
+
+    const auto segWithOffset = seg + mGeometry.segOffset;
+    auto& segWeights = mBinWeights[segWithOffset];
+    const auto* halfSegWeights = mHalfBinWeights.empty() ?
+      nullptr :
+      mHalfBinWeights[segWithOffset].data();
+    const auto initialized = !segWeights.empty();
+    segWeights.resize(nBinsInSegment);
+
+#pragma omp parallel for
+    LOOP(binIndex, 0, nBinsInSegment - 1)
+    {
+      const auto weight =
+        weights.mDataArray[segWithOffset][binIndex];
+
+      if (initialized)
+      {
+        segWeights[binIndex] *= weight;
+      }
+      else if (halfSegWeights != nullptr)
+      {
+        segWeights[binIndex] =
+          halfToFloat(halfSegWeights[binIndex]) *
+          mHalfBinScale * weight;
+      }
+      else
+      {
+        segWeights[binIndex] = weight;
+      }
+    }
+  }
+
+  mHalfBinWeights.clear();
+  mHasBinWeights = true;
+}
+
+void ProjData::multiplyCrystalWeights(
+  const std::vector<types::BinValue>& crystalWeights)
+{
+  if ((int)crystalWeights.size() != mHeader.nCrystalsPerRing)
+  {
+    error(
+      "Number of crystal weights must be the number of "
+      "crystals per ring (",
+      mHeader.nCrystalsPerRing,
+      ")");
+  }
+
+  const auto nTangCoords = mHeader.nTangCoords;
+  if (mTransaxialWeights.empty())
+  {
+    mTransaxialWeights.assign(
+      mGeometry.nViews * nTangCoords,
+      1.0);
+  }
+
+  LOOP(view, 0, mGeometry.nViews - 1)
+  LOOP(tangIndex, 0, nTangCoords - 1)
+  {
+    const auto [crystalAngCoord1, crystalAngCoord2] =
+      getCrystalAngCoord(
+        view,
+        tangIndex - mGeometry.tangCoordOffset);
+
+    mTransaxialWeights[view * nTangCoords + tangIndex] *=
+      crystalWeights[crystalAngCoord1] *
+      crystalWeights[crystalAngCoord2];
+  }
+
+  mHasBinWeights = true;
+}
+
+void ProjData::compressBinWeights()
+{
+  if (mBinWeights.empty())
+  {
+    return;
+  }
+
+  types::BinValue maxWeight{0.0};
+  for (const auto& segWeights : mBinWeights)
+  {
+    for (const auto weight : segWeights)
+    {
+      maxWeight = MAX(maxWeight, ABS(weight));
+    }
+  }
+
+  mHalfBinScale = maxWeight > 0.0 ? maxWeight : 1.0;
+  const auto invScale = 1.0f / mHalfBinScale;
+
+  mHalfBinWeights.resize(mHeader.nSegments);
+  LOOP(segWithOffset, 0, mHeader.nSegments - 1)
+  {
+    const auto& segWeights = mBinWeights[segWithOffset];
+    auto& halfSegWeights = mHalfBinWeights[segWithOffset];
+    halfSegWeights.resize(segWeights.size());
+
+#pragma omp parallel for
+    LOOP(binIndex, 0, (int)segWeights.size() - 1)
+    {
+      halfSegWeights[binIndex] =
+        floatToHalf(segWeights[binIndex] * invScale);
+    }
+  }
+
+  mBinWeights.clear();
+}
+
+void ProjData::clearBinWeights()
+{
+  mBinWeights.clear();
+  mHalfBinWeights.clear();
+  mHalfBinScale = 1.0;
+  mTransaxialWeights.clear();
+  mHasBinWeights = false;
+}
+
 void ProjData::copyParameters(const ProjData& proj)
 {
   mHeader = proj.mHeader;
@@ -652,7 +829,12 @@ void ProjData::allocate(
 
 void ProjData::deallocate()
 {
-  if (mDataArray != nullptr)
+  if (mMappedFile != nullptr)
+  {
+    std::free(mDataArray);
+    mMappedFile.reset();
+  }
+  else if (mDataArray != nullptr)
   {
 #pragma omp parallel for
     LOOP(seg, -mGeometry.segOffset, mGeometry.segOffset)
@@ -662,4 +844,6 @@ void ProjData::deallocate()
   }
 
   mDataArray = nullptr;
+
+  clearBinWeights();
 }
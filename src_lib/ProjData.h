@@ -1,10 +1,14 @@
 #pragma once
 
+#include <MappedFile.h>
 #include <ProjHeader.h>
 #include <types.h>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
 
 // Bin indices and their range:
 // seg        : [-segOffset, segOffset]
@@ -90,6 +94,13 @@ public:
     int view,
     int tangCoord) const;
 
+  // First axial coordinate of a segment whose crystals have
+  // the same difference of axial coordinates as the crystals of
+  // its central axial coordinate
+  // The LORs of all axial coordinates with this difference are
+  // the same up to an axial shift
+  int getReferenceAxialCoord(int seg) const;
+
   // Get projection bin coordinates from crystal coordinates
   // Returns false if the LOR falls outside the current
   // projection
@@ -111,6 +122,44 @@ public:
   // Divide each bin by the number of ring pairs associated
   void rebinWeight();
 
+  // Bin weights: Multiplicative corrections (attenuation,
+  // normalization, dead time) applied to each bin when it is
+  // read by the back projections and OSEM or written by the
+  // forward projections, instead of in a pass over the bins
+  // Weights are cleared when the projection is read or copied
+
+  // Multiply the weights by the bins of a projection of the
+  // same size
+  void multiplyBinWeights(const ProjData& weights);
+
+  // Multiply the weights of each bin by the product of the
+  // weights of its two crystals, evaluated with the bin
+  // crystalWeights: [crystalAngCoord] Weight of each crystal
+  // of a ring (efficiency, dead time)
+  void multiplyCrystalWeights(
+    const std::vector<types::BinValue>& crystalWeights);
+
+  // Keep the weights multiplied by multiplyBinWeights in half
+  // precision relative to their maximum (relative error below
+  // 2^-11), in half the memory
+  void compressBinWeights();
+
+  void clearBinWeights();
+
+  inline bool hasBinWeights() const;
+  inline types::BinValue getBinWeight(
+    int seg,
+    int binIndex) const;
+
+  // Bin multiplied by its weight
+  inline types::BinValue getWeightedBin(
+    int seg,
+    int binIndex) const;
+  inline void setWeightedBin(
+    int seg,
+    int binIndex,
+    types::BinValue value);
+
   inline const ProjHeader& getHeader() const;
   inline const ProjGeometry& getGeometry() const;
   inline types::BinValue** getDataArray() const;
@@ -165,8 +214,22 @@ private:
 
   types::BinValue** mDataArray;
 
-  // Bin weights (multiplies each bin during projection)
-  types::BinValue** mBinWeights;
+  // Data file whose pages hold the segments, when they are
+  // used in place instead of being allocated
+  std::shared_ptr<MappedFile> mMappedFile;
+
+  // Bin weights (multiply each bin during projection)
+  bool mHasBinWeights{false};
+
+  // [seg + segOffset][binIndex] Weights of each bin, in single
+  // precision or in half precision relative to mHalfBinScale
+  std::vector<std::vector<types::BinValue>> mBinWeights;
+  std::vector<std::vector<std::uint16_t>> mHalfBinWeights;
+  types::BinValue mHalfBinScale{1.0};
+
+  // [view * nTangCoords + tangCoord + tangCoordOffset] Product
+  // of the weights of the crystals of each transaxial LOR
+  std::vector<types::BinValue> mTransaxialWeights;
 };
 
 #include <ProjData.inl>
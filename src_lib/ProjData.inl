@@ -2,6 +2,8 @@
 
 #include <ProjData.h>
 
+#include <tools.h>
+
 const ProjHeader& ProjData::getHeader() const
 {
   return mHeader;
@@ -67,6 +69,64 @@ void ProjData::weightBin(
   mDataArray[seg_adj][ind] *= weight;
 }
 
+bool ProjData::hasBinWeights() const
+{
+  return mHasBinWeights;
+}
+
+types::BinValue ProjData::getBinWeight(
+  int seg,
+  int binIndex) const
+{
+  const auto segWithOffset = seg + mGeometry.segOffset;
+
+  types::BinValue weight{1.0};
+
+  if (!mBinWeights.empty())
+  {
+    weight = mBinWeights[segWithOffset][binIndex];
+  }
+  else if (!mHalfBinWeights.empty())
+  {
+    weight =
+      halfToFloat(mHalfBinWeights[segWithOffset][binIndex]) *
+      mHalfBinScale;
+  }
+
+  if (!mTransaxialWeights.empty())
+  {
+    const auto nTangCoords = mHeader.nTangCoords;
+    const auto view = binIndex /
+      (mGeometry.getNAxialCoords(seg) * nTangCoords);
+
+    weight *= mTransaxialWeights
+      [view * nTangCoords + binIndex % nTangCoords];
+  }
+
+  return weight;
+}
+
+types::BinValue ProjData::getWeightedBin(
+  int seg,
+  int binIndex) const
+{
+  const auto value =
+    mDataArray[seg + mGeometry.segOffset][binIndex];
+
+  return mHasBinWeights ? value * getBinWeight(seg, binIndex) :
+                          value;
+}
+
+void ProjData::setWeightedBin(
+  int seg,
+  int binIndex,
+  types::BinValue value)
+{
+  mDataArray[seg + mGeometry.segOffset][binIndex] =
+    mHasBinWeights ? value * getBinWeight(seg, binIndex) :
+                     value;
+}
+
 std::tuple<int, int> ProjData::getInd(
   int seg,
   int view,
@@ -26,6 +26,10 @@ struct ProjHeader
   int nSegments;   // Defaults to 1
   int nTangCoords; // Set to 0 (default) to get maximum value
 
+  // Constructors (copy declared along with operator=)
+  ProjHeader() = default;
+  ProjHeader(const ProjHeader& rhs) = default;
+
   // Operators
   inline bool operator==(const ProjHeader& rhs) const;
   inline ProjHeader& operator=(const ProjHeader& rhs);
@@ -68,6 +72,10 @@ struct ProjGeometry
   // ones
   int maxRingDiff;
 
+  // Constructors (copy declared along with operator=)
+  ProjGeometry() = default;
+  ProjGeometry(const ProjGeometry& other) = default;
+
   // Operator
   inline void operator=(const ProjGeometry& other);
 
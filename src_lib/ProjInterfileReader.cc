@@ -93,12 +93,31 @@ void ProjInterfileReader::readData(types::BinValue** dataArray)
   }
 }
 
+std::shared_ptr<MappedFile> ProjInterfileReader::mapData()
+{
+  auto mappedFile = std::make_shared<MappedFile>(
+    mDataFileName,
+    0,
+    (std::size_t)mGeometry.nBins * sizeof(types::BinValue));
+
+  if (!mappedFile->isMapped())
+  {
+    return nullptr;
+  }
+
+  return mappedFile;
+}
+
 static void writeData(
   const std::string& outputProjDataFile,
   const ProjHeader& header,
   const ProjGeometry& geometry,
   types::BinValue** dataArray)
 {
+  // Previous file removed rather than rewritten, in case it is
+  // mapped (see MappedFile)
+  std::filesystem::remove(outputProjDataFile);
+
   // Open data file
   std::ofstream os;
   os.open(outputProjDataFile);
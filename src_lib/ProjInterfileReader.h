@@ -1,8 +1,10 @@
 #pragma once
 
+#include <MappedFile.h>
 #include <ProjHeader.h>
 #include <types.h>
 
+#include <memory>
 #include <string>
 
 class ProjInterfileReader
@@ -20,6 +22,11 @@ public:
   // Read the data file pointed to by the header file
   void readData(types::BinValue** dataArray);
 
+  // Map the data file, whose bins are stored as in memory with
+  // the segments one after the other (nullptr if it can't be
+  // mapped, to be read with readData)
+  std::shared_ptr<MappedFile> mapData();
+
   // Static method to write a volume to file
   static void writeProjInterfile(
     const std::string& outputProjFile,
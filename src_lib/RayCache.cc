@@ -0,0 +1,184 @@
+#include <RayCache.h>
+
+#include <LORCache.h>
+#include <Siddon.h>
+#include <console.h>
+#include <macros.h>
+
+#include <limits>
+
+constexpr double BYTES_PER_MB{1024.0 * 1024.0};
+
+RayCache::RayCache(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  const LORList& lorList,
+  double maxMemoryMB,
+  double clipRadius):
+  mNSegments{proj.getHeader().nSegments},
+  mSegOffset{proj.getGeometry().segOffset},
+  mMemoryMB{0.0}
+{
+  const auto nSubsets = lorList.getNSubsets();
+
+  // Check proj data dimensions and LOR lists configuration
+  scanner.checkProjData(proj);
+  // Setups are used by the OSEM iterations, with the lists of
+  // non-zero bins
+  lorList.checkConfiguration(
+    proj,
+    vol,
+    nSubsets,
+    clipRadius,
+    true);
+
+  if (maxMemoryMB < 0.0)
+  {
+    error("Ray cache memory budget must not be negative");
+  }
+
+  // Entry voxels are stored as 16-bit indices
+  const auto& volSize = vol.getHeader().volSize;
+  const auto maxVolSize = (std::size_t)MAX(
+    volSize.nPixelsX,
+    MAX(volSize.nPixelsY, volSize.nSlices));
+  if (maxVolSize > std::numeric_limits<std::uint16_t>::max())
+  {
+    error("Volume is too large for the ray cache");
+  }
+
+  echo("Computing ray cache");
+
+  Siddon siddon(vol, clipRadius);
+  LORCache cache(proj, nSubsets);
+
+  mBlocks.resize(nSubsets * mNSegments);
+
+  const auto packetSize = siddon.getPacketSize();
+
+  LOOP(subset, 0, nSubsets - 1)
+  LOOP_SEG(seg, proj)
+  {
+    auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+    const auto nLORs = lorList.getNLORs(subset, seg);
+
+    // Stop storing blocks as soon as one exceeds the budget
+    const auto blockMemoryMB =
+      (double)nLORs * getRayBytes() / BYTES_PER_MB;
+    if (
+      maxMemoryMB > 0.0 &&
+      mMemoryMB + blockMemoryMB > maxMemoryMB)
+    {
+      warning(
+        "Ray cache memory budget reached: ",
+        "remaining LORs will be traced from their crystals");
+      printEmptyLine();
+      return;
+    }
+
+    block.alphaMin.resize(nLORs);
+    block.alphaMax.resize(nLORs);
+    block.d12.resize(nLORs);
+    LOOP(dim, 0, 2)
+    {
+      block.alphaDim[dim].resize(nLORs);
+      block.dAlpha[dim].resize(nLORs);
+      block.position[dim].resize(nLORs);
+    }
+    block.directions.resize(nLORs);
+
+    const auto nPackets = (nLORs + packetSize - 1) / packetSize;
+
+#pragma omp parallel for schedule(static)
+    LOOP(packetIndex, 0, nPackets - 1)
+    {
+      const auto firstPosition = packetIndex * packetSize;
+      const auto nLORsInPacket =
+        MIN(packetSize, nLORs - firstPosition);
+
+      Siddon::Packet packet;
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        const auto index = lorList.getOrderedIndex(
+          subset,
+          seg,
+          firstPosition + lane);
+
+        const auto
+          [valid,
+           binIndex,
+           crystalAxialCoord1,
+           crystalAngCoord1,
+           crystalAxialCoord2,
+           crystalAngCoord2] =
+            cache.getLOR(subset, seg, index);
+
+        siddon.addToPacket(
+          packet,
+          scanner,
+          crystalAxialCoord1,
+          crystalAngCoord1,
+          crystalAxialCoord2,
+          crystalAngCoord2);
+      }
+
+      Siddon::RayPacket rays;
+      siddon.computeRayPacket(packet, rays);
+
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        const auto position = firstPosition + lane;
+
+        std::uint8_t directions{0};
+
+        block.alphaMin[position] = rays.alphaMin[lane];
+        block.alphaMax[position] = rays.alphaMax[lane];
+        block.d12[position] = rays.d12[lane];
+
+        LOOP(dim, 0, 2)
+        {
+          block.alphaDim[dim][position] =
+            rays.alphaDim[dim][lane];
+          block.dAlpha[dim][position] = rays.dAlpha[dim][lane];
+
+          // Entry voxel is clamped to the volume
+          block.position[dim][position] =
+            (std::uint16_t)rays.position[dim][lane];
+
+          if (rays.dir[dim][lane] == Siddon::DIR_POS)
+          {
+            directions |= DIR_POSITIVE[dim];
+          }
+        }
+
+        block.directions[position] = directions;
+      }
+    }
+
+    block.stored = true;
+    mMemoryMB += blockMemoryMB;
+  }
+}
+
+void RayCache::printContent() const
+{
+  auto nStoredBlocks = 0;
+  for (const auto& block : mBlocks)
+  {
+    nStoredBlocks += block.stored ? 1 : 0;
+  }
+
+  printValue("Ray cache bytes per LOR", getRayBytes());
+  printValue("Ray cache blocks stored", nStoredBlocks);
+  printValue("Ray cache blocks total", mBlocks.size());
+  printValue("Ray cache memory in MB", mMemoryMB);
+  printEmptyLine();
+}
+
+std::size_t RayCache::getRayBytes()
+{
+  return 9 * sizeof(types::PathExtent) +
+    3 * sizeof(std::uint16_t) + sizeof(std::uint8_t);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <LORList.h>
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <Siddon.h>
+#include <VolData.h>
+#include <types.h>
+
+#include <cstdint>
+#include <vector>
+
+// Precomputed setup of the LORs for the voxel walk of the
+// packet tracer (see Siddon::RayPacket)
+//
+// The values of alpha where each LOR enters and exits the
+// volume, its length, its entry voxel, its first plane
+// crossings, the variations of alpha between planes and its
+// directions of travel are stored in blocks, one block per
+// subset and segment, in the order of the LORs of LORList
+// taken by the packet projector, as a structure of arrays.
+// Tracing a LOR then starts straight at the voxel walk,
+// without decoding its crystals nor computing its setup.
+//
+// Blocks are stored in order until the memory budget is
+// reached, as for SystemMatrix. The LORs of the remaining
+// blocks are traced from their crystals.
+// Values of alpha and lengths are stored as types::PathExtent,
+// so that single precision path elements also halve the memory
+// per LOR.
+
+class RayCache
+{
+public:
+
+  // maxMemoryMB: Memory budget in MB (0: No limit)
+  // clipRadius: Rays are clipped to that cylinder (see Siddon),
+  // which must be the cut radius of lorList
+  RayCache(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    const LORList& lorList,
+    double maxMemoryMB = 0.0,
+    double clipRadius = 0.0);
+
+  void printContent() const;
+
+  // True if the setups of the LORs of the subset and segment
+  // are stored
+  inline bool isStored(int subset, int seg) const;
+
+  // Add setup of LOR at a position of the list of LORList, in
+  // the order of the packet projector, to packet
+  // At most getPacketSize() LORs can be added
+  inline void addToPacket(
+    Siddon::RayPacket& rays,
+    int subset,
+    int seg,
+    int position) const;
+
+  inline double getMemoryMB() const;
+
+  // Memory used per LOR in bytes
+  static std::size_t getRayBytes();
+
+private:
+
+  // Bits of the directions of each LOR
+  static constexpr std::uint8_t DIR_POSITIVE[3]{1, 2, 4};
+
+  struct Block
+  {
+    // False if block was left out because of memory budget
+    bool stored{false};
+
+    // [position] Setup of each LOR (see Siddon::RayPacket)
+    std::vector<types::PathExtent> alphaMin;
+    std::vector<types::PathExtent> alphaMax;
+    std::vector<types::PathExtent> d12;
+    std::vector<types::PathExtent> alphaDim[3];
+    std::vector<types::PathExtent> dAlpha[3];
+    std::vector<std::uint16_t> position[3];
+
+    // [position] DIR_POSITIVE bits
+    std::vector<std::uint8_t> directions;
+  };
+
+  inline int getBlockIndex(int subset, int seg) const;
+
+  int mNSegments;
+  int mSegOffset;
+
+  double mMemoryMB;
+
+  // [subset * nSegments + seg + segOffset]
+  std::vector<Block> mBlocks;
+};
+
+#include <RayCache.inl>
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <RayCache.h>
+
+bool RayCache::isStored(int subset, int seg) const
+{
+  return mBlocks[getBlockIndex(subset, seg)].stored;
+}
+
+void RayCache::addToPacket(
+  Siddon::RayPacket& rays,
+  int subset,
+  int seg,
+  int position) const
+{
+  const auto& block = mBlocks[getBlockIndex(subset, seg)];
+  const auto lane = rays.nLORs++;
+  const auto directions = block.directions[position];
+
+  // LORs of the lists cross the volume, but can miss the
+  // clipping cylinder
+  rays.crosses[lane] =
+    block.alphaMin[position] < block.alphaMax[position];
+  rays.alphaMin[lane] = block.alphaMin[position];
+  rays.alphaMax[lane] = block.alphaMax[position];
+  rays.d12[lane] = block.d12[position];
+
+  LOOP(dim, 0, 2)
+  {
+    rays.alphaDim[dim][lane] = block.alphaDim[dim][position];
+    rays.dAlpha[dim][lane] = block.dAlpha[dim][position];
+    rays.position[dim][lane] = block.position[dim][position];
+    rays.dir[dim][lane] = directions & DIR_POSITIVE[dim] ?
+      Siddon::DIR_POS :
+      Siddon::DIR_NEG;
+  }
+}
+
+double RayCache::getMemoryMB() const
+{
+  return mMemoryMB;
+}
+
+int RayCache::getBlockIndex(int subset, int seg) const
+{
+  return subset * mNSegments + seg + mSegOffset;
+}
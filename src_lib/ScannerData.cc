@@ -114,7 +114,7 @@ void ScannerData::printBinInfo(
   int seg, int view, int axialCoord, int tangCoord,
   int crystal1, int slice1, int crystal2, int slice2,
   const VolData& vol,
-  types::PathElement* pathElementsArray,
+  const types::PathElement* pathElementsArray,
   types::VoxelValue line) const
 {
   // Bin coordinates
@@ -17,6 +17,8 @@ public:
   // Check if projection data is compatible with scanner
   void checkProjData(const ProjData& proj) const;
 
+  inline const ScannerGeometry& getGeometry() const;
+
   inline const types::SpatialCoords2D*
   getCrystalXYPositionVector() const;
 
@@ -30,7 +32,7 @@ public:
     int seg, int view, int axialCoord, int tangCoord,
     int crystal1, int slice1, int crystal2, int slice2,
     const VolData& vol,
-    types::PathElement* pathElementsArray = 0,
+    const types::PathElement* pathElementsArray = 0,
     types::VoxelValue line = 0) const;
 
   // Used in debugging
@@ -2,6 +2,11 @@
 
 #include <ScannerData.h>
 
+const ScannerGeometry& ScannerData::getGeometry() const
+{
+  return mGeometry;
+}
+
 const types::SpatialCoords2D*
 ScannerData::getCrystalXYPositionVector() const
 {
@@ -0,0 +1,309 @@
+#include <SensitivityStore.h>
+
+#include <console.h>
+#include <macros.h>
+#include <tools.h>
+
+#include <cmath>
+#include <cstddef>
+
+SensitivityStore::SensitivityStore(
+  const VolData& sensVol,
+  Storage storage,
+  int nCachedFrames):
+  mStorage{storage},
+  mNSubsets{sensVol.getNFrames()}
+{
+  if (storage == Storage::LAZY)
+  {
+    error("Lazy sensitivity storage needs the projection "
+          "parameters");
+  }
+
+  if (storage == Storage::FULL)
+  {
+    mSensVol = &sensVol;
+    return;
+  }
+
+  setCache(sensVol, nCachedFrames);
+
+  const auto activeFrame = sensVol.getActiveFrame();
+  LOOP(subset, 0, mNSubsets - 1)
+  {
+    sensVol.setActiveFrame(subset);
+    encode(sensVol, subset);
+  }
+  sensVol.setActiveFrame(activeFrame);
+}
+
+SensitivityStore::SensitivityStore(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets,
+  Storage storage,
+  int nCachedFrames,
+  const SystemMatrix* systemMatrix,
+  projections::Projector projector,
+  projections::Accumulation accumulation,
+  double maxAccumulationMemoryMB,
+  int tileSize,
+  const LORList* lorList):
+  mStorage{storage},
+  mNSubsets{nSubsets}
+{
+  mLazyArgs = {
+    &proj,
+    &scanner,
+    systemMatrix,
+    projector,
+    accumulation,
+    maxAccumulationMemoryMB,
+    tileSize,
+    lorList};
+
+  if (storage == Storage::FULL)
+  {
+    mComputedSensVol = std::make_unique<VolData>();
+    mComputedSensVol->allocateAsMultiVol(vol, nSubsets);
+    projections::computeSensitivityVol(
+      proj,
+      scanner,
+      *mComputedSensVol,
+      nSubsets,
+      systemMatrix,
+      projector,
+      accumulation,
+      maxAccumulationMemoryMB,
+      tileSize,
+      lorList);
+
+    mSensVol = mComputedSensVol.get();
+    return;
+  }
+
+  setCache(vol, nCachedFrames);
+
+  if (storage == Storage::LAZY)
+  {
+    return;
+  }
+
+  // Each subset computed into a cached frame, then encoded
+  auto& frame = *mCache[0].vol;
+  LOOP(subset, 0, nSubsets - 1)
+  {
+    compute(subset, frame);
+    encode(frame, subset);
+  }
+}
+
+void SensitivityStore::printContent() const
+{
+  auto nBytes = (double)mCodes.size() * sizeof(std::uint16_t);
+  for (const auto& cachedFrame : mCache)
+  {
+    nBytes += (double)cachedFrame.vol->getNVoxelsPerFrame() *
+      sizeof(types::VoxelValue);
+  }
+  if (mStorage == Storage::FULL)
+  {
+    nBytes += (double)mSensVol->getNVoxelsPerFrame() *
+      mSensVol->getNFrames() * sizeof(types::VoxelValue);
+  }
+
+  printValue("Sensitivity storage", getStorageName(mStorage));
+  printValue("Sensitivity cached frames", mCache.size());
+  printValue("Sensitivity memory in MB", nBytes / 1e6);
+  printEmptyLine();
+}
+
+const VolData& SensitivityStore::getFrame(int subset)
+{
+  if (subset < 0 || subset >= mNSubsets)
+  {
+    error("Subset ", subset, " out of range");
+  }
+
+  if (mStorage == Storage::FULL)
+  {
+    mSensVol->setActiveFrame(subset);
+    return *mSensVol;
+  }
+
+  mNUses++;
+
+  // Frame cached, or least recently used frame
+  auto* replaced = &mCache[0];
+  for (auto& cachedFrame : mCache)
+  {
+    if (cachedFrame.subset == subset)
+    {
+      cachedFrame.lastUse = mNUses;
+      return *cachedFrame.vol;
+    }
+
+    if (cachedFrame.lastUse < replaced->lastUse)
+    {
+      replaced = &cachedFrame;
+    }
+  }
+
+  if (mStorage == Storage::LAZY)
+  {
+    compute(subset, *replaced->vol);
+  }
+  else
+  {
+    decode(subset, *replaced->vol);
+  }
+  replaced->subset = subset;
+  replaced->lastUse = mNUses;
+
+  return *replaced->vol;
+}
+
+int SensitivityStore::getNSubsets() const
+{
+  return mNSubsets;
+}
+
+SensitivityStore::Storage SensitivityStore::getStorage(
+  const std::string& name)
+{
+  if (name == "full")
+  {
+    return Storage::FULL;
+  }
+  if (name == "half")
+  {
+    return Storage::HALF;
+  }
+  if (name == "scaled")
+  {
+    return Storage::SCALED;
+  }
+  if (name == "lazy")
+  {
+    return Storage::LAZY;
+  }
+
+  error("Unknown sensitivity storage: ", name);
+  return Storage::FULL;
+}
+
+std::string SensitivityStore::getStorageName(Storage storage)
+{
+  switch (storage)
+  {
+  case Storage::HALF:
+    return "half";
+  case Storage::SCALED:
+    return "scaled";
+  case Storage::LAZY:
+    return "lazy";
+  default:
+    return "full";
+  }
+}
+
+void SensitivityStore::setCache(
+  const VolData& vol,
+  int nCachedFrames)
+{
+  if (nCachedFrames < 1)
+  {
+    error("Number of cached frames must be positive");
+  }
+
+  mNVoxelsPerFrame = vol.getNVoxelsPerFrame();
+
+  if (mStorage != Storage::LAZY)
+  {
+    mCodes.resize((std::size_t)mNSubsets * mNVoxelsPerFrame);
+    mScales.resize(mNSubsets);
+  }
+
+  mCache.resize(MIN(nCachedFrames, mNSubsets));
+  for (auto& cachedFrame : mCache)
+  {
+    cachedFrame.vol = std::make_unique<VolData>();
+    cachedFrame.vol->allocateAsMultiVol(vol, 1);
+  }
+}
+
+void SensitivityStore::encode(const VolData& vol, int subset)
+{
+  const auto* dataArray = vol.getDataArray();
+  auto* codes =
+    mCodes.data() + (std::size_t)subset * mNVoxelsPerFrame;
+
+  types::VoxelValue maxValue{0.0};
+  LOOP(voxel, 0, mNVoxelsPerFrame - 1)
+  {
+    maxValue = MAX(maxValue, dataArray[voxel]);
+  }
+
+  // Values relative to the maximum, or integers of a step of
+  // the maximum over 65535 (negative values set to zero)
+  const auto scale = mStorage == Storage::HALF ?
+    (float)maxValue :
+    (float)maxValue / 65535.0f;
+  mScales[subset] = scale;
+  const auto invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+
+#pragma omp parallel for
+  LOOP(voxel, 0, mNVoxelsPerFrame - 1)
+  {
+    const auto value = dataArray[voxel] * invScale;
+
+    if (mStorage == Storage::HALF)
+    {
+      codes[voxel] = floatToHalf(value);
+    }
+    else
+    {
+      codes[voxel] = (std::uint16_t)std::lround(
+        MIN(65535.0f, MAX(0.0f, value)));
+    }
+  }
+}
+
+void SensitivityStore::decode(int subset, VolData& vol) const
+{
+  auto* dataArray = vol.getDataArray();
+  const auto* codes =
+    mCodes.data() + (std::size_t)subset * mNVoxelsPerFrame;
+  const auto scale = mScales[subset];
+
+#pragma omp parallel for
+  LOOP(voxel, 0, mNVoxelsPerFrame - 1)
+  {
+    const auto value = mStorage == Storage::HALF ?
+      halfToFloat(codes[voxel]) :
+      (float)codes[voxel];
+
+    dataArray[voxel] = value * scale;
+  }
+}
+
+void SensitivityStore::compute(int subset, VolData& vol) const
+{
+  vol.setAllVoxels(0.0);
+
+  projections::computeSensitivityVol(
+    *mLazyArgs.proj,
+    *mLazyArgs.scanner,
+    vol,
+    mNSubsets,
+    mLazyArgs.systemMatrix,
+    mLazyArgs.projector,
+    mLazyArgs.accumulation,
+    mLazyArgs.maxAccumulationMemoryMB,
+    mLazyArgs.tileSize,
+    mLazyArgs.lorList,
+    nullptr,
+    nullptr,
+    subset);
+}
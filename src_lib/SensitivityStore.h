@@ -0,0 +1,126 @@
+#pragma once
+
+#include <LORList.h>
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <SystemMatrix.h>
+#include <VolData.h>
+#include <projections.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Sensitivity map of each subset used by OSEM, kept in full
+// or in less memory than nSubsets full frames
+//
+// HALF and SCALED keep each frame in 16 bits per voxel (half
+// floats relative to the maximum of the frame, or integers
+// scaled to it) and decode the frames used into a small cache.
+// LAZY keeps no frame and computes the frames used into the
+// cache. With HALF and SCALED, the frames are computed one
+// subset at a time, so that the full map is never allocated.
+
+class SensitivityStore
+{
+public:
+
+  enum class Storage
+  {
+    FULL,
+    HALF,
+    SCALED,
+    LAZY
+  };
+
+  // Frames of a sensitivity map already computed (not LAZY)
+  // FULL: sensVol is used as is and must outlive the store
+  // nCachedFrames: Number of frames decoded at once
+  SensitivityStore(
+    const VolData& sensVol,
+    Storage storage = Storage::FULL,
+    int nCachedFrames = 1);
+
+  // Frames computed by projections::computeSensitivityVol with
+  // the same parameters (vol: Template of the frames)
+  // LAZY: The arguments are used at each miss of the cache and
+  // must outlive the store
+  SensitivityStore(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    int nSubsets,
+    Storage storage,
+    int nCachedFrames = 1,
+    const SystemMatrix* systemMatrix = nullptr,
+    projections::Projector projector =
+      projections::Projector::PACKET,
+    projections::Accumulation accumulation =
+      projections::Accumulation::ATOMIC,
+    double maxAccumulationMemoryMB = 0.0,
+    int tileSize = 0,
+    const LORList* lorList = nullptr);
+
+  void printContent() const;
+
+  // Sensitivity map of a subset, in the active frame of the
+  // volume returned, valid until the next call
+  const VolData& getFrame(int subset);
+
+  int getNSubsets() const;
+
+  static Storage getStorage(const std::string& name);
+  static std::string getStorageName(Storage storage);
+
+private:
+
+  struct CachedFrame
+  {
+    std::unique_ptr<VolData> vol;
+    int subset{-1};
+    long lastUse{0};
+  };
+
+  struct LazyArgs
+  {
+    const ProjData* proj;
+    const ScannerData* scanner;
+    const SystemMatrix* systemMatrix;
+    projections::Projector projector;
+    projections::Accumulation accumulation;
+    double maxAccumulationMemoryMB;
+    int tileSize;
+    const LORList* lorList;
+  };
+
+  void setCache(const VolData& vol, int nCachedFrames);
+
+  // Encode the active frame of vol as frame of subset
+  void encode(const VolData& vol, int subset);
+  void decode(int subset, VolData& vol) const;
+  void compute(int subset, VolData& vol) const;
+
+  Storage mStorage;
+  int mNSubsets;
+
+  // FULL
+  const VolData* mSensVol{nullptr};
+  std::unique_ptr<VolData> mComputedSensVol;
+
+  // HALF and SCALED
+  int mNVoxelsPerFrame{0};
+
+  // [subset * nVoxelsPerFrame + voxel] Encoded voxel values
+  std::vector<std::uint16_t> mCodes;
+
+  // [subset] Maximum (HALF) or scale (SCALED) of each frame
+  std::vector<float> mScales;
+
+  // LAZY
+  LazyArgs mLazyArgs{};
+
+  // Least recently used frame replaced at each miss
+  std::vector<CachedFrame> mCache;
+  long mNUses{0};
+};
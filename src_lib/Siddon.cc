@@ -4,20 +4,1054 @@
 #include <macros.h>
 #include <tools.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
-constexpr types::SpatialCoord ALPHA_MIN{0.0};
-constexpr types::SpatialCoord ALPHA_MAX{1.0};
+// Packets of LORs are traced with SIMD instructions selected at
+// runtime (GCC and Clang on x86), one LOR per lane of a pair of
+// registers of doubles: 4 LORs with SSE2, 8 with AVX2 and 16
+// with AVX-512.
+#if defined(__GNUC__) && defined(__SSE2__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define SIMD_RUNTIME_DISPATCH
+#endif
 
-constexpr int DIR_NEG{-1};
-constexpr int DIR_POS{1};
+#ifdef SIMD_RUNTIME_DISPATCH
 
-constexpr int X_DIM{0};
-constexpr int Y_DIM{1};
-constexpr int Z_DIM{2};
+#include <immintrin.h>
 
-Siddon::Siddon(const VolData& vol)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+// Inline the whole kernel in the function compiled for the
+// instruction set
+#define FLATTEN __attribute__((flatten))
+
+#endif
+
+// Visitor storing the elements of a path traced by
+// Siddon::trace or Siddon::traceFromTransaxial
+struct PathWriter
+{
+  types::PathElement* pathElementsArray;
+  int pathInd{0};
+
+  void operator()(
+    types::Index coord,
+    types::PathExtent length)
+  {
+    pathElementsArray[pathInd].coord = coord;
+    pathElementsArray[pathInd].length = length;
+    ++pathInd;
+  }
+
+  // Write terminator (empty path if nothing was visited)
+  void terminate()
+  {
+    pathElementsArray[pathInd].coord = -1;
+  }
+};
+
+// Volume geometry used by the packet tracer
+struct PacketGeometry
+{
+  types::SpatialCoord lowPlanes[3];
+  types::SpatialCoord highPlanes[3];
+  types::SpatialCoord voxelExtent[3];
+  types::SpatialCoord volSizeM1[3];
+  types::SpatialCoord strides[3];
+
+  // Clipping cylinder in XY (radius 0: No clipping)
+  types::SpatialCoord clipRadius;
+  types::SpatialCoord clipCenter[2];
+};
+
+static PacketGeometry makePacketGeometry(
+  const Siddon::CoordTriplet& lowPlanes,
+  const Siddon::CoordTriplet& highPlanes,
+  const Siddon::CoordTriplet& voxelExtent,
+  const Siddon::SizeTriplet& volSizeM1,
+  types::Size rowSize,
+  types::Size sliceSize,
+  types::SpatialCoord clipRadius,
+  types::SpatialCoord clipCenterX,
+  types::SpatialCoord clipCenterY)
+{
+  return {
+    {std::get<Siddon::X_DIM>(lowPlanes),
+     std::get<Siddon::Y_DIM>(lowPlanes),
+     std::get<Siddon::Z_DIM>(lowPlanes)},
+    {std::get<Siddon::X_DIM>(highPlanes),
+     std::get<Siddon::Y_DIM>(highPlanes),
+     std::get<Siddon::Z_DIM>(highPlanes)},
+    {static_cast<types::SpatialCoord>(
+       std::get<Siddon::X_DIM>(voxelExtent)),
+     static_cast<types::SpatialCoord>(
+       std::get<Siddon::Y_DIM>(voxelExtent)),
+     static_cast<types::SpatialCoord>(
+       std::get<Siddon::Z_DIM>(voxelExtent))},
+    {static_cast<types::SpatialCoord>(
+       std::get<Siddon::X_DIM>(volSizeM1)),
+     static_cast<types::SpatialCoord>(
+       std::get<Siddon::Y_DIM>(volSizeM1)),
+     static_cast<types::SpatialCoord>(
+       std::get<Siddon::Z_DIM>(volSizeM1))},
+    {1.0,
+     static_cast<types::SpatialCoord>(rowSize),
+     static_cast<types::SpatialCoord>(sliceSize)},
+    clipRadius,
+    {clipCenterX, clipCenterY}};
+}
+
+// Vector operations used by the packet tracer for each
+// instruction set
+// Masks have all bits set for true lanes
+
+struct ScalarOps
+{
+  static constexpr int SIZE{1};
+
+  using Coord = double;
+  using Mask = bool;
+
+  static Coord set(double a) { return a; }
+  static Coord load(const double* p) { return *p; }
+  static void store(double* p, Coord a) { *p = a; }
+
+  static Coord add(Coord a, Coord b) { return a + b; }
+  static Coord sub(Coord a, Coord b) { return a - b; }
+  static Coord mul(Coord a, Coord b) { return a * b; }
+  static Coord div(Coord a, Coord b) { return a / b; }
+  static Coord min(Coord a, Coord b) { return MIN(a, b); }
+  static Coord max(Coord a, Coord b) { return MAX(a, b); }
+  static Coord abs(Coord a) { return ABS(a); }
+  static Coord sqrt(Coord a) { return std::sqrt(a); }
+
+  static Mask lt(Coord a, Coord b) { return a < b; }
+  static Mask le(Coord a, Coord b) { return a <= b; }
+  static Mask gt(Coord a, Coord b) { return a > b; }
+  static Mask ge(Coord a, Coord b) { return a >= b; }
+  static Mask andMask(Mask a, Mask b) { return a && b; }
+  static Mask orMask(Mask a, Mask b) { return a || b; }
+  static int bits(Mask m) { return m ? 1 : 0; }
+
+  static Coord select(Mask m, Coord a, Coord b)
+  {
+    return m ? a : b;
+  }
+};
+
+#ifdef SIMD_RUNTIME_DISPATCH
+
+// Vectors passed by value between the kernel templates, only
+// instantiated inside functions compiled for their instruction
+// set (see FLATTEN), don't change the ABI of any call
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+struct SSE2Ops
+{
+  static constexpr int SIZE{2};
+
+  using Coord = __m128d;
+  using Mask = __m128d;
+
+  static Coord set(double a)
+  {
+    return _mm_set1_pd(a);
+  }
+
+  static Coord load(const double* p)
+  {
+    return _mm_loadu_pd(p);
+  }
+
+  static void store(double* p, Coord a)
+  {
+    _mm_storeu_pd(p, a);
+  }
+
+  static Coord add(Coord a, Coord b)
+  {
+    return _mm_add_pd(a, b);
+  }
+
+  static Coord sub(Coord a, Coord b)
+  {
+    return _mm_sub_pd(a, b);
+  }
+
+  static Coord mul(Coord a, Coord b)
+  {
+    return _mm_mul_pd(a, b);
+  }
+
+  static Coord div(Coord a, Coord b)
+  {
+    return _mm_div_pd(a, b);
+  }
+
+  static Coord min(Coord a, Coord b)
+  {
+    return _mm_min_pd(a, b);
+  }
+
+  static Coord max(Coord a, Coord b)
+  {
+    return _mm_max_pd(a, b);
+  }
+
+  static Coord sqrt(Coord a)
+  {
+    return _mm_sqrt_pd(a);
+  }
+
+  static Coord abs(Coord a)
+  {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+  }
+
+  static Mask lt(Coord a, Coord b)
+  {
+    return _mm_cmplt_pd(a, b);
+  }
+
+  static Mask le(Coord a, Coord b)
+  {
+    return _mm_cmple_pd(a, b);
+  }
+
+  static Mask gt(Coord a, Coord b)
+  {
+    return _mm_cmpgt_pd(a, b);
+  }
+
+  static Mask ge(Coord a, Coord b)
+  {
+    return _mm_cmpge_pd(a, b);
+  }
+
+  static Mask andMask(Mask a, Mask b)
+  {
+    return _mm_and_pd(a, b);
+  }
+
+  static Mask orMask(Mask a, Mask b)
+  {
+    return _mm_or_pd(a, b);
+  }
+
+  static int bits(Mask m)
+  {
+    return _mm_movemask_pd(m);
+  }
+
+  static Coord select(Mask m, Coord a, Coord b)
+  {
+    return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+  }
+};
+
+struct AVX2Ops
+{
+  static constexpr int SIZE{4};
+
+  using Coord = __m256d;
+  using Mask = __m256d;
+
+  TARGET_AVX2 static Coord set(double a)
+  {
+    return _mm256_set1_pd(a);
+  }
+
+  TARGET_AVX2 static Coord load(const double* p)
+  {
+    return _mm256_loadu_pd(p);
+  }
+
+  TARGET_AVX2 static void store(double* p, Coord a)
+  {
+    _mm256_storeu_pd(p, a);
+  }
+
+  TARGET_AVX2 static Coord add(Coord a, Coord b)
+  {
+    return _mm256_add_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord sub(Coord a, Coord b)
+  {
+    return _mm256_sub_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord mul(Coord a, Coord b)
+  {
+    return _mm256_mul_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord div(Coord a, Coord b)
+  {
+    return _mm256_div_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord min(Coord a, Coord b)
+  {
+    return _mm256_min_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord max(Coord a, Coord b)
+  {
+    return _mm256_max_pd(a, b);
+  }
+
+  TARGET_AVX2 static Coord sqrt(Coord a)
+  {
+    return _mm256_sqrt_pd(a);
+  }
+
+  TARGET_AVX2 static Coord abs(Coord a)
+  {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+  }
+
+  TARGET_AVX2 static Mask lt(Coord a, Coord b)
+  {
+    return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+  }
+
+  TARGET_AVX2 static Mask le(Coord a, Coord b)
+  {
+    return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+  }
+
+  TARGET_AVX2 static Mask gt(Coord a, Coord b)
+  {
+    return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+  }
+
+  TARGET_AVX2 static Mask ge(Coord a, Coord b)
+  {
+    return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+  }
+
+  TARGET_AVX2 static Mask andMask(Mask a, Mask b)
+  {
+    return _mm256_and_pd(a, b);
+  }
+
+  TARGET_AVX2 static Mask orMask(Mask a, Mask b)
+  {
+    return _mm256_or_pd(a, b);
+  }
+
+  TARGET_AVX2 static int bits(Mask m)
+  {
+    return _mm256_movemask_pd(m);
+  }
+
+  TARGET_AVX2 static Coord select(Mask m, Coord a, Coord b)
+  {
+    return _mm256_blendv_pd(b, a, m);
+  }
+};
+
+struct AVX512Ops
+{
+  static constexpr int SIZE{8};
+
+  using Coord = __m512d;
+  using Mask = __mmask8;
+
+  static constexpr Mask ALL_LANES{0xff};
+
+  TARGET_AVX512 static Coord set(double a)
+  {
+    return _mm512_set1_pd(a);
+  }
+
+  TARGET_AVX512 static Coord load(const double* p)
+  {
+    return _mm512_loadu_pd(p);
+  }
+
+  TARGET_AVX512 static void store(double* p, Coord a)
+  {
+    _mm512_storeu_pd(p, a);
+  }
+
+  TARGET_AVX512 static Coord add(Coord a, Coord b)
+  {
+    return _mm512_add_pd(a, b);
+  }
+
+  TARGET_AVX512 static Coord sub(Coord a, Coord b)
+  {
+    return _mm512_sub_pd(a, b);
+  }
+
+  TARGET_AVX512 static Coord mul(Coord a, Coord b)
+  {
+    return _mm512_mul_pd(a, b);
+  }
+
+  TARGET_AVX512 static Coord div(Coord a, Coord b)
+  {
+    return _mm512_div_pd(a, b);
+  }
+
+  // Note: Masked forms with all lanes set, whose unmasked
+  // forms pass an undefined vector that GCC reports as used
+  // uninitialized
+  TARGET_AVX512 static Coord min(Coord a, Coord b)
+  {
+    return _mm512_mask_min_pd(a, ALL_LANES, a, b);
+  }
+
+  TARGET_AVX512 static Coord max(Coord a, Coord b)
+  {
+    return _mm512_mask_max_pd(a, ALL_LANES, a, b);
+  }
+
+  TARGET_AVX512 static Coord sqrt(Coord a)
+  {
+    return _mm512_mask_sqrt_pd(a, ALL_LANES, a);
+  }
+
+  TARGET_AVX512 static Coord abs(Coord a)
+  {
+    return _mm512_abs_pd(a);
+  }
+
+  TARGET_AVX512 static Mask lt(Coord a, Coord b)
+  {
+    return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+  }
+
+  TARGET_AVX512 static Mask le(Coord a, Coord b)
+  {
+    return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);
+  }
+
+  TARGET_AVX512 static Mask gt(Coord a, Coord b)
+  {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+  }
+
+  TARGET_AVX512 static Mask ge(Coord a, Coord b)
+  {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+  }
+
+  TARGET_AVX512 static Mask andMask(Mask a, Mask b)
+  {
+    return a & b;
+  }
+
+  TARGET_AVX512 static Mask orMask(Mask a, Mask b)
+  {
+    return a | b;
+  }
+
+  TARGET_AVX512 static int bits(Mask m)
+  {
+    return m;
+  }
+
+  TARGET_AVX512 static Coord select(Mask m, Coord a, Coord b)
+  {
+    return _mm512_mask_blend_pd(m, b, a);
+  }
+};
+
+#endif
+
+// Two registers per vector so that two independent groups of
+// LORs are stepped at once
+template<typename Ops>
+struct PairOps
+{
+  static constexpr int SIZE{2 * Ops::SIZE};
+
+  struct Coord
+  {
+    typename Ops::Coord lo, hi;
+  };
+
+  struct Mask
+  {
+    typename Ops::Mask lo, hi;
+  };
+
+  static Coord set(double a)
+  {
+    const auto v = Ops::set(a);
+    return {v, v};
+  }
+
+  static Coord load(const double* p)
+  {
+    return {Ops::load(p), Ops::load(p + Ops::SIZE)};
+  }
+
+  static void store(double* p, Coord a)
+  {
+    Ops::store(p, a.lo);
+    Ops::store(p + Ops::SIZE, a.hi);
+  }
+
+  static Coord add(Coord a, Coord b)
+  {
+    return {Ops::add(a.lo, b.lo), Ops::add(a.hi, b.hi)};
+  }
+
+  static Coord sub(Coord a, Coord b)
+  {
+    return {Ops::sub(a.lo, b.lo), Ops::sub(a.hi, b.hi)};
+  }
+
+  static Coord mul(Coord a, Coord b)
+  {
+    return {Ops::mul(a.lo, b.lo), Ops::mul(a.hi, b.hi)};
+  }
+
+  static Coord div(Coord a, Coord b)
+  {
+    return {Ops::div(a.lo, b.lo), Ops::div(a.hi, b.hi)};
+  }
+
+  static Coord min(Coord a, Coord b)
+  {
+    return {Ops::min(a.lo, b.lo), Ops::min(a.hi, b.hi)};
+  }
+
+  static Coord max(Coord a, Coord b)
+  {
+    return {Ops::max(a.lo, b.lo), Ops::max(a.hi, b.hi)};
+  }
+
+  static Coord abs(Coord a)
+  {
+    return {Ops::abs(a.lo), Ops::abs(a.hi)};
+  }
+
+  static Coord sqrt(Coord a)
+  {
+    return {Ops::sqrt(a.lo), Ops::sqrt(a.hi)};
+  }
+
+  static Mask lt(Coord a, Coord b)
+  {
+    return {Ops::lt(a.lo, b.lo), Ops::lt(a.hi, b.hi)};
+  }
+
+  static Mask le(Coord a, Coord b)
+  {
+    return {Ops::le(a.lo, b.lo), Ops::le(a.hi, b.hi)};
+  }
+
+  static Mask gt(Coord a, Coord b)
+  {
+    return {Ops::gt(a.lo, b.lo), Ops::gt(a.hi, b.hi)};
+  }
+
+  static Mask ge(Coord a, Coord b)
+  {
+    return {Ops::ge(a.lo, b.lo), Ops::ge(a.hi, b.hi)};
+  }
+
+  static Mask andMask(Mask a, Mask b)
+  {
+    return {Ops::andMask(a.lo, b.lo), Ops::andMask(a.hi, b.hi)};
+  }
+
+  static Mask orMask(Mask a, Mask b)
+  {
+    return {Ops::orMask(a.lo, b.lo), Ops::orMask(a.hi, b.hi)};
+  }
+
+  static int bits(Mask m)
+  {
+    return Ops::bits(m.lo) | (Ops::bits(m.hi) << Ops::SIZE);
+  }
+
+  static Coord select(Mask m, Coord a, Coord b)
+  {
+    return {
+      Ops::select(m.lo, a.lo, b.lo),
+      Ops::select(m.hi, a.hi, b.hi)};
+  }
+};
+
+// Same steps as Siddon::computePath up to the voxel walk,
+// applied to the group of LORs of the packet starting at
+// firstLane, one LOR per lane. Voxel positions are kept as
+// doubles so that only vectors of doubles are needed.
+// rays: Setup of each LOR of the group
+template<typename Ops>
+static inline void setupLanes(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  int firstLane,
+  Siddon::RayPacket& rays)
+{
+  using Coord = typename Ops::Coord;
+  using Mask = typename Ops::Mask;
+
+  constexpr auto N = Ops::SIZE;
+
+  const auto nLanes = MIN(N, packet.nLORs - firstLane);
+
+  // [dim][lane] Crystal positions
+  // Unused lanes are copies of the first LOR of the group
+  double crys1Lanes[3][N], crys2Lanes[3][N];
+
+  // [lane] Lane index
+  double laneIndices[N];
+
+  LOOP(lane, 0, N - 1)
+  {
+    const auto source = firstLane + (lane < nLanes ? lane : 0);
+
+    crys1Lanes[Siddon::X_DIM][lane] = packet.crys1X[source];
+    crys1Lanes[Siddon::Y_DIM][lane] = packet.crys1Y[source];
+    crys1Lanes[Siddon::Z_DIM][lane] = packet.crys1Z[source];
+    crys2Lanes[Siddon::X_DIM][lane] = packet.crys2X[source];
+    crys2Lanes[Siddon::Y_DIM][lane] = packet.crys2Y[source];
+    crys2Lanes[Siddon::Z_DIM][lane] = packet.crys2Z[source];
+
+    laneIndices[lane] = lane;
+  }
+
+  const auto zero = Ops::set(0.0);
+  const auto epsilon = Ops::set(EPSILON);
+
+  // True if LOR is traced
+  auto active =
+    Ops::lt(Ops::load(laneIndices), Ops::set(nLanes));
+
+  Coord crys1[3], diff[3];
+  Mask dirPositive[3];
+  Coord alphaDim[3];
+
+  // Setup (dimSetup and getEntryExit)
+  auto alphaMin = Ops::set(Siddon::ALPHA_MIN);
+  auto alphaMax = Ops::set(Siddon::ALPHA_MAX);
+  LOOP(dim, 0, 2)
+  {
+    const auto lowPlane = Ops::set(geometry.lowPlanes[dim]);
+    const auto highPlane = Ops::set(geometry.highPlanes[dim]);
+
+    crys1[dim] = Ops::load(crys1Lanes[dim]);
+    const auto crys2 = Ops::load(crys2Lanes[dim]);
+    const auto diffDim = Ops::sub(crys2, crys1[dim]);
+
+    // False if the LOR has no component along the current
+    // dimension
+    const auto notCancelled =
+      Ops::gt(Ops::abs(diffDim), epsilon);
+    const auto positive = Ops::gt(diffDim, zero);
+
+    // Skip LOR if it doesn't intersect the volume
+    active = Ops::andMask(
+      active,
+      Ops::orMask(
+        notCancelled,
+        Ops::andMask(
+          Ops::ge(crys1[dim], lowPlane),
+          Ops::le(crys1[dim], highPlane))));
+
+    diff[dim] = Ops::select(notCancelled, diffDim, epsilon);
+
+    const auto entryPlane =
+      Ops::select(positive, lowPlane, highPlane);
+    const auto exitPlane =
+      Ops::select(positive, highPlane, lowPlane);
+
+    const auto dimAlphaMin = Ops::select(
+      notCancelled,
+      Ops::div(Ops::sub(entryPlane, crys1[dim]), diff[dim]),
+      Ops::set(Siddon::ALPHA_MIN));
+    const auto dimAlphaMax = Ops::select(
+      notCancelled,
+      Ops::div(Ops::sub(exitPlane, crys1[dim]), diff[dim]),
+      Ops::set(Siddon::ALPHA_MAX));
+
+    dirPositive[dim] = Ops::andMask(notCancelled, positive);
+    alphaDim[dim] = Ops::select(
+      notCancelled,
+      Ops::set(Siddon::ALPHA_MIN),
+      Ops::set(Siddon::ALPHA_MAX));
+
+    alphaMin = Ops::max(alphaMin, dimAlphaMin);
+    alphaMax = Ops::min(alphaMax, dimAlphaMax);
+  }
+
+  // Clipping (getClipEntryExit) in each lane
+  if (geometry.clipRadius > 0.0)
+  {
+    double clipMinLanes[N], clipMaxLanes[N];
+    LOOP(lane, 0, N - 1)
+    {
+      const auto [clipMin, clipMax] =
+        Siddon::getCylinderEntryExit(
+          crys1Lanes[Siddon::X_DIM][lane],
+          crys1Lanes[Siddon::Y_DIM][lane],
+          crys2Lanes[Siddon::X_DIM][lane],
+          crys2Lanes[Siddon::Y_DIM][lane],
+          geometry.clipCenter[Siddon::X_DIM],
+          geometry.clipCenter[Siddon::Y_DIM],
+          geometry.clipRadius);
+
+      clipMinLanes[lane] = clipMin;
+      clipMaxLanes[lane] = clipMax;
+    }
+
+    alphaMin = Ops::max(alphaMin, Ops::load(clipMinLanes));
+    alphaMax = Ops::min(alphaMax, Ops::load(clipMaxLanes));
+  }
+
+  active = Ops::andMask(active, Ops::lt(alphaMin, alphaMax));
+  const auto crossesBits = Ops::bits(active);
+
+  const auto d12 = Ops::sqrt(Ops::add(
+    Ops::add(
+      Ops::mul(diff[Siddon::X_DIM], diff[Siddon::X_DIM]),
+      Ops::mul(diff[Siddon::Y_DIM], diff[Siddon::Y_DIM])),
+    Ops::mul(diff[Siddon::Z_DIM], diff[Siddon::Z_DIM])));
+
+  Ops::store(&rays.alphaMin[firstLane], alphaMin);
+  Ops::store(&rays.alphaMax[firstLane], alphaMax);
+  Ops::store(&rays.d12[firstLane], d12);
+
+  // Entry voxel and first plane crossings (getStartInd and
+  // prepareDim)
+  LOOP(dim, 0, 2)
+  {
+    const auto lowPlane = Ops::set(geometry.lowPlanes[dim]);
+    const auto voxelExtent =
+      Ops::set(geometry.voxelExtent[dim]);
+
+    const auto dAlpha =
+      Ops::div(voxelExtent, Ops::abs(diff[dim]));
+
+    // Conversion to int in each lane
+    double indLanes[N];
+    Ops::store(
+      indLanes,
+      Ops::div(
+        Ops::sub(
+          Ops::add(crys1[dim], Ops::mul(diff[dim], alphaMin)),
+          lowPlane),
+        voxelExtent));
+    LOOP(lane, 0, N - 1)
+    {
+      const auto ind = static_cast<int>(indLanes[lane]);
+      indLanes[lane] = MAX(
+        0,
+        MIN(ind, static_cast<int>(geometry.volSizeM1[dim])));
+    }
+    const auto position = Ops::load(indLanes);
+
+    const auto alpha = Ops::select(
+      Ops::lt(alphaDim[dim], Ops::set(Siddon::ALPHA_MAX)),
+      Ops::div(
+        Ops::sub(
+          Ops::add(lowPlane, Ops::mul(voxelExtent, position)),
+          crys1[dim]),
+        diff[dim]),
+      alphaDim[dim]);
+
+    Ops::store(&rays.dAlpha[dim][firstLane], dAlpha);
+    Ops::store(&rays.position[dim][firstLane], position);
+    Ops::store(
+      &rays.alphaDim[dim][firstLane],
+      Ops::select(
+        dirPositive[dim],
+        Ops::add(alpha, dAlpha),
+        alpha));
+    Ops::store(
+      &rays.dir[dim][firstLane],
+      Ops::select(
+        dirPositive[dim],
+        Ops::set(Siddon::DIR_POS),
+        Ops::set(Siddon::DIR_NEG)));
+  }
+
+  LOOP(lane, 0, nLanes - 1)
+  {
+    rays.crosses[firstLane + lane] = (crossesBits >> lane) & 1;
+  }
+}
+
+// Voxel walk of Siddon::computePath applied to the group of
+// LORs starting at firstLane, from their setup. Lanes are
+// stepped together until all LORs have left the volume; lanes
+// done early are masked.
+template<typename Ops>
+static inline void walkLanes(
+  const PacketGeometry& geometry,
+  const Siddon::RayPacket& rays,
+  int firstLane,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  using Coord = typename Ops::Coord;
+
+  constexpr auto N = Ops::SIZE;
+
+  const auto nLanes = MIN(N, rays.nLORs - firstLane);
+
+  // [lane] 1 if LOR crosses the volume, 0 otherwise
+  double crossesLanes[N];
+  LOOP(lane, 0, N - 1)
+  {
+    const auto crosses =
+      lane < nLanes && rays.crosses[firstLane + lane];
+    crossesLanes[lane] = crosses ? 1.0 : 0.0;
+  }
+
+  const auto zero = Ops::set(0.0);
+  const auto epsilon = Ops::set(EPSILON);
+
+  // True while LOR is being traced
+  auto active = Ops::gt(Ops::load(crossesLanes), zero);
+
+  const auto alphaMin = Ops::load(&rays.alphaMin[firstLane]);
+  const auto alphaMax = Ops::load(&rays.alphaMax[firstLane]);
+  const auto d12 = Ops::load(&rays.d12[firstLane]);
+
+  Coord alphaDim[3], dAlpha[3], position[3], dir[3];
+  Coord coordStep[3];
+  auto coord = zero;
+
+  LOOP(dim, 0, 2)
+  {
+    alphaDim[dim] = Ops::load(&rays.alphaDim[dim][firstLane]);
+    dAlpha[dim] = Ops::load(&rays.dAlpha[dim][firstLane]);
+    position[dim] = Ops::load(&rays.position[dim][firstLane]);
+    dir[dim] = Ops::load(&rays.dir[dim][firstLane]);
+
+    // Variation of the linear coordinate when moving to the
+    // next voxel along the current dimension
+    const auto stride = Ops::set(geometry.strides[dim]);
+    coordStep[dim] = Ops::mul(dir[dim], stride);
+    coord = Ops::add(coord, Ops::mul(position[dim], stride));
+  }
+
+  int pathInd[N];
+  LOOP(lane, 0, N - 1)
+  {
+    pathInd[lane] = 0;
+  }
+
+  auto previousAlpha = alphaMin;
+  while (Ops::bits(active) != 0)
+  {
+    const auto nextAlpha = Ops::min(
+      alphaMax,
+      Ops::min(
+        alphaDim[Siddon::X_DIM],
+        Ops::min(
+          alphaDim[Siddon::Y_DIM],
+          alphaDim[Siddon::Z_DIM])));
+
+    auto inside = active;
+    LOOP(dim, 0, 2)
+    {
+      inside = Ops::andMask(
+        inside,
+        Ops::andMask(
+          Ops::ge(position[dim], zero),
+          Ops::le(
+            position[dim],
+            Ops::set(geometry.volSizeM1[dim]))));
+    }
+
+    double coordLanes[N], lengthLanes[N];
+    Ops::store(coordLanes, coord);
+    Ops::store(
+      lengthLanes,
+      Ops::mul(Ops::sub(nextAlpha, previousAlpha), d12));
+
+    // Write path elements without branches, only keeping those
+    // inside the volume
+    const auto insideBits = Ops::bits(inside);
+    LOOP(lane, 0, nLanes - 1)
+    {
+      auto& pathElement =
+        pathElementsArrays[firstLane + lane][pathInd[lane]];
+
+      pathElement.coord =
+        static_cast<types::Index>(coordLanes[lane]);
+      pathElement.length = lengthLanes[lane];
+
+      pathInd[lane] += (insideBits >> lane) & 1;
+    }
+
+    // Move to next voxel (updateDim)
+    LOOP(dim, 0, 2)
+    {
+      const auto step = Ops::lt(
+        Ops::abs(Ops::sub(alphaDim[dim], nextAlpha)),
+        epsilon);
+
+      alphaDim[dim] = Ops::select(
+        step,
+        Ops::add(alphaDim[dim], dAlpha[dim]),
+        alphaDim[dim]);
+      position[dim] = Ops::select(
+        step,
+        Ops::add(position[dim], dir[dim]),
+        position[dim]);
+      coord = Ops::select(
+        step,
+        Ops::add(coord, coordStep[dim]),
+        coord);
+    }
+
+    previousAlpha = nextAlpha;
+    active =
+      Ops::andMask(active, Ops::lt(previousAlpha, alphaMax));
+  }
+
+  // Terminators
+  LOOP(lane, 0, nLanes - 1)
+  {
+    auto* pathElements = pathElementsArrays[firstLane + lane];
+    pathElements[pathInd[lane]].coord = -1;
+    crosses[firstLane + lane] = rays.crosses[firstLane + lane];
+  }
+}
+
+template<typename Ops>
+static inline void setupPacket(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  Siddon::RayPacket& rays)
+{
+  rays.nLORs = packet.nLORs;
+
+  for (auto firstLane = 0; firstLane < packet.nLORs;
+       firstLane += Ops::SIZE)
+  {
+    setupLanes<Ops>(geometry, packet, firstLane, rays);
+  }
+}
+
+template<typename Ops>
+static inline void walkPacket(
+  const PacketGeometry& geometry,
+  const Siddon::RayPacket& rays,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  for (auto firstLane = 0; firstLane < rays.nLORs;
+       firstLane += Ops::SIZE)
+  {
+    walkLanes<Ops>(
+      geometry,
+      rays,
+      firstLane,
+      pathElementsArrays,
+      crosses);
+  }
+}
+
+template<typename Ops>
+static inline void tracePacket(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  Siddon::RayPacket rays;
+  setupPacket<Ops>(geometry, packet, rays);
+  walkPacket<Ops>(geometry, rays, pathElementsArrays, crosses);
+}
+
+#ifdef SIMD_RUNTIME_DISPATCH
+
+TARGET_AVX512 FLATTEN static void tracePacketAVX512(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  tracePacket<PairOps<AVX512Ops>>(
+    geometry,
+    packet,
+    pathElementsArrays,
+    crosses);
+}
+
+TARGET_AVX2 FLATTEN static void tracePacketAVX2(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  tracePacket<PairOps<AVX2Ops>>(
+    geometry,
+    packet,
+    pathElementsArrays,
+    crosses);
+}
+
+TARGET_AVX512 FLATTEN static void setupPacketAVX512(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  Siddon::RayPacket& rays)
+{
+  setupPacket<PairOps<AVX512Ops>>(geometry, packet, rays);
+}
+
+TARGET_AVX2 FLATTEN static void setupPacketAVX2(
+  const PacketGeometry& geometry,
+  const Siddon::Packet& packet,
+  Siddon::RayPacket& rays)
+{
+  setupPacket<PairOps<AVX2Ops>>(geometry, packet, rays);
+}
+
+TARGET_AVX512 FLATTEN static void walkPacketAVX512(
+  const PacketGeometry& geometry,
+  const Siddon::RayPacket& rays,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  walkPacket<PairOps<AVX512Ops>>(
+    geometry,
+    rays,
+    pathElementsArrays,
+    crosses);
+}
+
+TARGET_AVX2 FLATTEN static void walkPacketAVX2(
+  const PacketGeometry& geometry,
+  const Siddon::RayPacket& rays,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses)
+{
+  walkPacket<PairOps<AVX2Ops>>(
+    geometry,
+    rays,
+    pathElementsArrays,
+    crosses);
+}
+
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+Siddon::Siddon(
+  const VolData& vol,
+  double clipRadius,
+  int packetSize)
 {
   const auto& header = vol.getHeader();
 
@@ -32,7 +1066,7 @@ Siddon::Siddon(const VolData& vol)
     volSize.nPixelsY - 1,
     volSize.nSlices - 1);
 
-  mVoxelExtent = SizeTriplet(
+  mVoxelExtent = CoordTriplet(
     voxelExtent.pixelWidth,
     voxelExtent.pixelHeight,
     voxelExtent.sliceThickness);
@@ -51,11 +1085,43 @@ Siddon::Siddon(const VolData& vol)
     std::get<Y_DIM>(mLowPlanes) + volExtent.sliceHeight,
     std::get<Z_DIM>(mLowPlanes) + volExtent.volDepth);
 
+  // Clipping cylinder around the center of the volume in XY
+  if (clipRadius < 0.0)
+  {
+    error("Clipping radius must not be negative");
+  }
+  mClipRadius = clipRadius > 0.0 ?
+    clipRadius +
+      std::sqrt(
+        voxelExtent.pixelWidth * voxelExtent.pixelWidth +
+        voxelExtent.pixelHeight * voxelExtent.pixelHeight) /
+        2.0 :
+    0.0;
+  mClipCenterX =
+    std::get<X_DIM>(mLowPlanes) + volExtent.sliceWidth / 2.0;
+  mClipCenterY =
+    std::get<Y_DIM>(mLowPlanes) + volExtent.sliceHeight / 2.0;
+
   // Get maximum length of path element array
   mMaxPathLength =
     volSize.nPixelsX + volSize.nPixelsY + volSize.nSlices;
 
-  const auto nPathElements = getNThreads() * mMaxPathLength;
+  // Packet size of the widest instruction set by default
+  const auto supportedPacketSizes = getSupportedPacketSizes();
+  mPacketSize =
+    packetSize > 0 ? packetSize : supportedPacketSizes.back();
+  if (
+    std::find(
+      supportedPacketSizes.begin(),
+      supportedPacketSizes.end(),
+      mPacketSize) == supportedPacketSizes.end())
+  {
+    error("Packet size ", mPacketSize, " not supported");
+  }
+
+  // One path element array per packet lane for each thread
+  const auto nPathElements =
+    getNThreads() * mPacketSize * mMaxPathLength;
 
   // Allocate path element array
   mPathElementArray = (types::PathElement*)std::malloc(
@@ -77,12 +1143,47 @@ void Siddon::printContent() const
   printValue("High plane (x)", std::get<X_DIM>(mHighPlanes));
   printValue("High plane (y)", std::get<Y_DIM>(mHighPlanes));
   printValue("High plane (z)", std::get<Z_DIM>(mHighPlanes));
+  printValue("Clipping radius", mClipRadius);
+
+  printValue("Packet size", mPacketSize);
+}
+
+int Siddon::getPacketSize() const
+{
+  return mPacketSize;
+}
+
+std::vector<int> Siddon::getSupportedPacketSizes()
+{
+#ifdef SIMD_RUNTIME_DISPATCH
+  std::vector<int> packetSizes{PairOps<SSE2Ops>::SIZE};
+
+  if (__builtin_cpu_supports("avx2"))
+  {
+    packetSizes.push_back(PairOps<AVX2Ops>::SIZE);
+  }
+
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    packetSizes.push_back(PairOps<AVX512Ops>::SIZE);
+  }
+
+  return packetSizes;
+#else
+  return {2 * PairOps<ScalarOps>::SIZE};
+#endif
+}
+
+int Siddon::getMaxPathLength() const
+{
+  return mMaxPathLength;
 }
 
-types::PathElement* Siddon::getThreadLocalPathElements() const
+types::PathElement* Siddon::getThreadLocalPathElements(
+  int lane) const
 {
   return mPathElementArray +
-    getCurrentThread() * mMaxPathLength;
+    (getCurrentThread() * mPacketSize + lane) * mMaxPathLength;
 }
 
 bool Siddon::computePathBetweenCrystals(
@@ -118,28 +1219,191 @@ bool Siddon::computePath(
   types::SpatialCoord crys2Z,
   types::PathElement* pathElementsArray) const
 {
-  // Default empty path if the LOR doesn't intersect the volume
-  pathElementsArray[0].coord = -1;
-
-  // The line of response (LOR) going from crys1 (x1, y1, z1)
-  // to crys2 (x2, y2, z2) is parameterized as:
-  //   x(alpha) = x1 + (x2 - x1) * alpha = x1 + diffX * alpha
-  //   Similarly for Y and Z
-  // => alpha goes from 0 to 1 when moving from crys1 to crys2
-  //
-  // The value of alpha for a given value of x, y or z is thus:
-  //   alpha = (x - x1) / diffX
-  //   Similarly for Y and Z
-  //
-  // dir for a dimension D:
-  //   +1 or -1 depending on whether crys2 is reached from
-  //   crys1 by increasing D (+1) or decreasing D (-1)
-  //
-  // alphaMin and alphaMax for a dimension D:
-  //   Values of alpha for which the LOR intersects the planes
-  //   of constant D at the edge of the volume:
-  //   alphaMin for the one closest to crys1 and
-  //   alphaMax for the one farthest from crys1
+  PathWriter writer{pathElementsArray};
+
+  const auto crosses = trace(
+    crys1X,
+    crys1Y,
+    crys1Z,
+    crys2X,
+    crys2Y,
+    crys2Z,
+    writer);
+
+  writer.terminate();
+
+  return crosses;
+}
+
+void Siddon::addToPacket(
+  Packet& packet,
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAngCoord1,
+  int crysAxialCoord2,
+  int crysAngCoord2) const
+{
+  // Get access to crystal positions
+  const auto* crystalXYPositionVector =
+    scanner.getCrystalXYPositionVector();
+  const auto* sliceZPositionVector =
+    scanner.getSliceZPositionVector();
+
+  const auto lane = packet.nLORs++;
+
+  const auto& crys1XY = crystalXYPositionVector[crysAngCoord1];
+  const auto& crys2XY = crystalXYPositionVector[crysAngCoord2];
+
+  packet.crys1X[lane] = crys1XY.x;
+  packet.crys1Y[lane] = crys1XY.y;
+  packet.crys1Z[lane] = sliceZPositionVector[crysAxialCoord1];
+  packet.crys2X[lane] = crys2XY.x;
+  packet.crys2Y[lane] = crys2XY.y;
+  packet.crys2Z[lane] = sliceZPositionVector[crysAxialCoord2];
+}
+
+void Siddon::computePathPacket(
+  const Packet& packet,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses) const
+{
+  const auto geometry = makePacketGeometry(
+    mLowPlanes,
+    mHighPlanes,
+    mVoxelExtent,
+    mVolSizeM1,
+    mRowSize,
+    mSliceSize,
+    mClipRadius,
+    mClipCenterX,
+    mClipCenterY);
+
+#ifdef SIMD_RUNTIME_DISPATCH
+  if (mPacketSize == PairOps<AVX512Ops>::SIZE)
+  {
+    tracePacketAVX512(
+      geometry,
+      packet,
+      pathElementsArrays,
+      crosses);
+  }
+  else if (mPacketSize == PairOps<AVX2Ops>::SIZE)
+  {
+    tracePacketAVX2(
+      geometry,
+      packet,
+      pathElementsArrays,
+      crosses);
+  }
+  else
+  {
+    tracePacket<PairOps<SSE2Ops>>(
+      geometry,
+      packet,
+      pathElementsArrays,
+      crosses);
+  }
+#else
+  tracePacket<PairOps<ScalarOps>>(
+    geometry,
+    packet,
+    pathElementsArrays,
+    crosses);
+#endif
+}
+
+void Siddon::computeRayPacket(
+  const Packet& packet,
+  RayPacket& rays) const
+{
+  const auto geometry = makePacketGeometry(
+    mLowPlanes,
+    mHighPlanes,
+    mVoxelExtent,
+    mVolSizeM1,
+    mRowSize,
+    mSliceSize,
+    mClipRadius,
+    mClipCenterX,
+    mClipCenterY);
+
+#ifdef SIMD_RUNTIME_DISPATCH
+  if (mPacketSize == PairOps<AVX512Ops>::SIZE)
+  {
+    setupPacketAVX512(geometry, packet, rays);
+  }
+  else if (mPacketSize == PairOps<AVX2Ops>::SIZE)
+  {
+    setupPacketAVX2(geometry, packet, rays);
+  }
+  else
+  {
+    setupPacket<PairOps<SSE2Ops>>(geometry, packet, rays);
+  }
+#else
+  setupPacket<PairOps<ScalarOps>>(geometry, packet, rays);
+#endif
+}
+
+void Siddon::computePathPacket(
+  const RayPacket& rays,
+  types::PathElement* const* pathElementsArrays,
+  bool* crosses) const
+{
+  const auto geometry = makePacketGeometry(
+    mLowPlanes,
+    mHighPlanes,
+    mVoxelExtent,
+    mVolSizeM1,
+    mRowSize,
+    mSliceSize,
+    mClipRadius,
+    mClipCenterX,
+    mClipCenterY);
+
+#ifdef SIMD_RUNTIME_DISPATCH
+  if (mPacketSize == PairOps<AVX512Ops>::SIZE)
+  {
+    walkPacketAVX512(
+      geometry,
+      rays,
+      pathElementsArrays,
+      crosses);
+  }
+  else if (mPacketSize == PairOps<AVX2Ops>::SIZE)
+  {
+    walkPacketAVX2(geometry, rays, pathElementsArrays, crosses);
+  }
+  else
+  {
+    walkPacket<PairOps<SSE2Ops>>(
+      geometry,
+      rays,
+      pathElementsArrays,
+      crosses);
+  }
+#else
+  walkPacket<PairOps<ScalarOps>>(
+    geometry,
+    rays,
+    pathElementsArrays,
+    crosses);
+#endif
+}
+
+bool Siddon::computeTransaxialPath(
+  types::SpatialCoord crys1X,
+  types::SpatialCoord crys1Y,
+  types::SpatialCoord crys2X,
+  types::SpatialCoord crys2Y,
+  TransaxialPath& transaxialPath) const
+{
+  // Same as computePath without the Z dimension, keeping the
+  // value of alpha where the LOR exits each pixel
+
+  transaxialPath.crosses = false;
+  transaxialPath.coords.clear();
+  transaxialPath.alphaExits.clear();
 
   // Setup in X
   const auto setupXout = dimSetup<X_DIM>(crys1X, crys2X);
@@ -150,84 +1414,63 @@ bool Siddon::computePath(
   const auto setupX = setupXout.value();
 
   // Setup in Y
-  auto setupYout = dimSetup<Y_DIM>(crys1Y, crys2Y);
+  const auto setupYout = dimSetup<Y_DIM>(crys1Y, crys2Y);
   if (!setupYout.has_value())
   {
     return false;
   }
   const auto setupY = setupYout.value();
 
-  // Setup in Z
-  const auto setupZout = dimSetup<Z_DIM>(crys1Z, crys2Z);
-  if (!setupZout.has_value())
-  {
-    return false;
-  }
-  const auto setupZ = setupZout.value();
-
   // Values of alpha producing the points where the LOR enters
-  // and exits the volume
-  const auto [alphaMin, alphaMax] =
-    getEntryExit(setupX, setupY, setupZ);
+  // and exits the volume in XY, within the clipping cylinder
+  const auto [clipAlphaMin, clipAlphaMax] =
+    getClipEntryExit(crys1X, crys1Y, crys2X, crys2Y);
+  const auto alphaMin = MAX(
+    setupX.alphaMin,
+    MAX(setupY.alphaMin, MAX(clipAlphaMin, ALPHA_MIN)));
+  const auto alphaMax = MIN(
+    setupX.alphaMax,
+    MIN(setupY.alphaMax, MIN(clipAlphaMax, ALPHA_MAX)));
   if (alphaMin >= alphaMax)
   {
     return false;
   }
 
-  // Find the variations of alpha necessary to travel between
-  // neighboring inter-voxel planes for a given dimension
+  transaxialPath.crosses = true;
+  transaxialPath.diffX = setupX.diff;
+  transaxialPath.diffY = setupY.diff;
+  transaxialPath.alphaMin = alphaMin;
+  transaxialPath.alphaMax = alphaMax;
+
+  // Z is left out of the triplets below
   const CoordTriplet dAlpha{
     std::get<X_DIM>(mVoxelExtent) / ABS(setupX.diff),
     std::get<Y_DIM>(mVoxelExtent) / ABS(setupY.diff),
-    std::get<Z_DIM>(mVoxelExtent) / ABS(setupZ.diff)};
-
-  // Find the constant d12 such that alpha * d12 gives distance
-  // from crys1 to the point described by the value of alpha
-  const auto d12 = std::sqrt(
-    setupX.diff * setupX.diff + setupY.diff * setupY.diff +
-    setupZ.diff * setupZ.diff);
+    ALPHA_MAX};
 
-  // Initialize position:
-  // Find the voxel where the LOR enters the volume
   IndexTriplet position{
     getStartInd<X_DIM>(crys1X, setupX.diff, alphaMin),
     getStartInd<Y_DIM>(crys1Y, setupY.diff, alphaMin),
-    getStartInd<Z_DIM>(crys1Z, setupZ.diff, alphaMin)};
+    0};
 
-  // For each non-cancelled dimension, get the value of alpha
-  // for which the LOR touches the second plane along that
-  // dimension after entering the volume
   CoordTriplet alphaDim{
     prepareDim<X_DIM>(crys1X, setupX, position, dAlpha),
     prepareDim<Y_DIM>(crys1Y, setupY, position, dAlpha),
-    prepareDim<Z_DIM>(crys1Z, setupZ, position, dAlpha)};
+    ALPHA_MAX};
 
-  int pathInd{0};
-  types::SpatialCoord previousAlpha{alphaMin};
+  types::PathExtent previousAlpha{alphaMin};
   while (previousAlpha < alphaMax)
   {
-    // Update nextAlpha to the next value for which the LOR
-    // touches a plane between neighboring voxels
     const auto nextAlpha = MIN(
       alphaMax,
       MIN(
         std::get<X_DIM>(alphaDim),
-        MIN(
-          std::get<Y_DIM>(alphaDim),
-          std::get<Z_DIM>(alphaDim))));
-
-    // Write new path element after making sure it is within
-    // the boundaries of the volume
-    if (checkIndices(position))
-    {
-      pathElementsArray[pathInd].coord =
-        getLinearCoord(position);
-
-      pathElementsArray[pathInd].length =
-        (nextAlpha - previousAlpha) * d12;
+        std::get<Y_DIM>(alphaDim)));
 
-      ++pathInd;
-    }
+    // Pixel index if within the boundaries of the volume
+    transaxialPath.coords.push_back(
+      checkIndices(position) ? getLinearCoord(position) : -1);
+    transaxialPath.alphaExits.push_back(nextAlpha);
 
     updateDim<X_DIM>(
       alphaDim,
@@ -241,172 +1484,137 @@ bool Siddon::computePath(
       nextAlpha,
       dAlpha,
       setupY.dir);
-    updateDim<Z_DIM>(
-      alphaDim,
-      position,
-      nextAlpha,
-      dAlpha,
-      setupZ.dir);
 
     previousAlpha = nextAlpha;
   }
 
-  // Terminator
-  pathElementsArray[pathInd].coord = -1;
-
   return true;
 }
 
-template<int Dim>
-std::optional<Siddon::Setup> Siddon::dimSetup(
-  types::SpatialCoord crys1,
-  types::SpatialCoord crys2) const
+void Siddon::computeViewTransaxialPaths(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  int view,
+  std::vector<TransaxialPath>& transaxialPaths) const
 {
-  const auto lowPlane = std::get<Dim>(mLowPlanes);
-  const auto highPlane = std::get<Dim>(mHighPlanes);
-
-  auto diff = crys2 - crys1;
+  const auto* crystalXYPositionVector =
+    scanner.getCrystalXYPositionVector();
 
-  int dir;
-  types::SpatialCoord alphaMin, alphaMax, nextAlpha;
-  if (ABS(diff) > EPSILON)
-  {
-    if (diff > 0)
-    {
-      // LOR entering volume from low plane
-      dir = DIR_POS;
-      alphaMin = (lowPlane - crys1) / diff;
-      alphaMax = (highPlane - crys1) / diff;
-    }
-    else
-    {
-      // LOR entering volume from high plane
-      dir = DIR_NEG;
-      alphaMin = (highPlane - crys1) / diff;
-      alphaMax = (lowPlane - crys1) / diff;
-    }
+  transaxialPaths.resize(proj.getHeader().nTangCoords);
 
-    // Indicates that the dimension is not "cancelled"
-    nextAlpha = ALPHA_MIN;
-  }
-  else
+  LOOP_TANG(tangCoord, proj)
   {
-    // The LOR has no component along the current dimension
-
-    if (crys1 < lowPlane || crys1 > highPlane)
-    {
-      // The LOR doesn't intersect the volume: skip it
-      return std::nullopt;
-    }
-
-    // The LOR intersects the volume: Set special values
-
-    diff = EPSILON;
-    dir = DIR_NEG;
-
-    // Widest allowed range of alpha so that those values do not
-    // interfere in the computation of the point of entry
-    alphaMin = ALPHA_MIN;
-    alphaMax = ALPHA_MAX;
-
-    // Indicates that the dimension is "cancelled"
-    nextAlpha = ALPHA_MAX;
+    const auto [crystalAngCoord1, crystalAngCoord2] =
+      proj.getCrystalAngCoord(view, tangCoord);
+
+    const auto& crys1XY =
+      crystalXYPositionVector[crystalAngCoord1];
+    const auto& crys2XY =
+      crystalXYPositionVector[crystalAngCoord2];
+
+    computeTransaxialPath(
+      crys1XY.x,
+      crys1XY.y,
+      crys2XY.x,
+      crys2XY.y,
+      transaxialPaths
+        [tangCoord + proj.getGeometry().tangCoordOffset]);
   }
-
-  return Setup{diff, dir, alphaMin, alphaMax, nextAlpha};
 }
 
-std::tuple<types::SpatialCoord, types::SpatialCoord> Siddon::
-  getEntryExit(
-    const Setup& setupX,
-    const Setup& setupY,
-    const Setup& setupZ) const
+bool Siddon::computePathFromTransaxial(
+  const TransaxialPath& transaxialPath,
+  types::SpatialCoord crys1Z,
+  types::SpatialCoord crys2Z,
+  types::PathElement* pathElementsArray) const
 {
-  const auto alphaMin = MAX(
-    setupX.alphaMin,
-    MAX(setupY.alphaMin, MAX(setupZ.alphaMin, ALPHA_MIN)));
+  PathWriter writer{pathElementsArray};
 
-  const auto alphaMax = MIN(
-    setupX.alphaMax,
-    MIN(setupY.alphaMax, MIN(setupZ.alphaMax, ALPHA_MAX)));
+  const auto crosses =
+    traceFromTransaxial(transaxialPath, crys1Z, crys2Z, writer);
 
-  return {alphaMin, alphaMax};
+  writer.terminate();
+
+  return crosses;
 }
 
-template<int Dim>
-int Siddon::getStartInd(
-  types::SpatialCoord crys1,
-  types::SpatialCoord diff,
-  types::SpatialCoord alphaMin) const
+bool Siddon::computePathFromTransaxialBetweenCrystals(
+  const TransaxialPath& transaxialPath,
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAxialCoord2,
+  types::PathElement* pathElementsArray) const
 {
-  auto ind = static_cast<int>(
-    (crys1 + diff * alphaMin - std::get<Dim>(mLowPlanes)) /
-    std::get<Dim>(mVoxelExtent));
-
-  // Make sure the initial coordinates are within the volume
-  ind = MAX(0, MIN(ind, std::get<Dim>(mVolSizeM1)));
+  const auto* sliceZPositionVector =
+    scanner.getSliceZPositionVector();
 
-  return ind;
+  return computePathFromTransaxial(
+    transaxialPath,
+    sliceZPositionVector[crysAxialCoord1],
+    sliceZPositionVector[crysAxialCoord2],
+    pathElementsArray);
 }
 
-template<int Dim>
-types::SpatialCoord Siddon::prepareDim(
-  types::SpatialCoord crys1,
-  const Siddon::Setup& setup,
-  IndexTriplet& position,
-  const Siddon::CoordTriplet& dAlpha) const
+bool Siddon::isAxiallyAligned(const ScannerData& scanner) const
 {
-  auto alpha = setup.nextAlpha;
-
-  if (alpha < ALPHA_MAX)
-  {
-    const auto len = // RENAME
-      std::get<Dim>(mLowPlanes) +
-      std::get<Dim>(mVoxelExtent) * std::get<Dim>(position) -
-      crys1;
+  const auto nSlices = scanner.getGeometry().nSlices;
+  const auto* sliceZPositions =
+    scanner.getSliceZPositionVector();
 
-    alpha = len / setup.diff;
-  }
+  const auto sliceThickness = std::get<Z_DIM>(mVoxelExtent);
 
-  if (setup.dir > 0)
+  LOOP(slice, 0, nSlices - 1)
   {
-    alpha += std::get<Dim>(dAlpha);
+    if (
+      sliceZPositions[slice] < std::get<Z_DIM>(mLowPlanes) ||
+      sliceZPositions[slice] > std::get<Z_DIM>(mHighPlanes))
+    {
+      return false;
+    }
+
+    if (
+      slice > 0 &&
+      ABS(
+        sliceZPositions[slice] - sliceZPositions[slice - 1] -
+        sliceThickness) > EPSILON)
+    {
+      return false;
+    }
   }
 
-  return alpha;
+  return true;
 }
 
-template<int Dim>
-void Siddon::updateDim(
-  CoordTriplet& alphaDim,
-  IndexTriplet& position,
-  types::SpatialCoord nextAlpha,
-  const Siddon::CoordTriplet& dAlpha,
-  int dir) const
+types::Index Siddon::getAxialShift(
+  int crysAxialCoord,
+  int refCrysAxialCoord) const
 {
-  if (ABS(std::get<Dim>(alphaDim) - nextAlpha) < EPSILON)
-  {
-    std::get<Dim>(alphaDim) += std::get<Dim>(dAlpha);
-    std::get<Dim>(position) += dir;
-  }
+  return (crysAxialCoord - refCrysAxialCoord) * mSliceSize;
 }
 
-bool Siddon::checkIndices(const IndexTriplet& position) const
+std::tuple<int, int> Siddon::getSliceRange(
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAxialCoord2) const
 {
-  return std::get<X_DIM>(position) >= 0 &&
-    std::get<X_DIM>(position) <= std::get<X_DIM>(mVolSizeM1) &&
+  // Margin in slices for crossings of the planes between
+  // slices within Siddon's tolerance
+  constexpr double SLICE_MARGIN{1e-3};
+
+  const auto* sliceZPositions =
+    scanner.getSliceZPositionVector();
 
-    std::get<Y_DIM>(position) >= 0 &&
-    std::get<Y_DIM>(position) <= std::get<Y_DIM>(mVolSizeM1) &&
+  const auto z1 = sliceZPositions[crysAxialCoord1];
+  const auto z2 = sliceZPositions[crysAxialCoord2];
 
-    std::get<Z_DIM>(position) >= 0 &&
-    std::get<Z_DIM>(position) <= std::get<Z_DIM>(mVolSizeM1);
-}
+  const auto lowPlane = std::get<Z_DIM>(mLowPlanes);
+  const auto sliceThickness = std::get<Z_DIM>(mVoxelExtent);
+  const auto lastSlice = (int)std::get<Z_DIM>(mVolSizeM1);
 
-types::Index Siddon::getLinearCoord(
-  const IndexTriplet& position) const
-{
-  return std::get<X_DIM>(position) +
-    std::get<Y_DIM>(position) * mRowSize +
-    std::get<Z_DIM>(position) * mSliceSize;
+  const auto firstSlice = (int)std::floor(
+    (MIN(z1, z2) - lowPlane) / sliceThickness - SLICE_MARGIN);
+  const auto endSlice = (int)std::floor(
+    (MAX(z1, z2) - lowPlane) / sliceThickness + SLICE_MARGIN);
+
+  return {MAX(firstSlice, 0), MIN(endSlice, lastSlice)};
 }
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <ProjData.h>
 #include <ScannerData.h>
 #include <VolData.h>
 #include <types.h>
 
 #include <optional>
 #include <tuple>
+#include <vector>
 
 class Siddon
 {
@@ -18,18 +20,123 @@ public:
     std::tuple<types::Index, types::Index, types::Index>;
   using CoordTriplet = //
     std::tuple<
-      types::SpatialCoord,
-      types::SpatialCoord,
-      types::SpatialCoord>;
+      types::PathExtent,
+      types::PathExtent,
+      types::PathExtent>;
 
-  Siddon(const VolData& vol);
+  // Indices of the dimensions in the triplets
+  static constexpr int X_DIM{0};
+  static constexpr int Y_DIM{1};
+  static constexpr int Z_DIM{2};
+
+  // Values of alpha at the first and second crystal of a LOR
+  static constexpr types::PathExtent ALPHA_MIN{0.0};
+  static constexpr types::PathExtent ALPHA_MAX{1.0};
+
+  // Directions of travel along a dimension
+  static constexpr int DIR_NEG{-1};
+  static constexpr int DIR_POS{1};
+
+  // Maximum number of LORs in a packet
+  static constexpr int MAX_PACKET_SIZE{16};
+
+  // Crystal positions of a packet of LORs traced together
+  // (structure of arrays, one element per LOR)
+  struct Packet
+  {
+    int nLORs{0};
+
+    types::SpatialCoord crys1X[MAX_PACKET_SIZE];
+    types::SpatialCoord crys1Y[MAX_PACKET_SIZE];
+    types::SpatialCoord crys1Z[MAX_PACKET_SIZE];
+    types::SpatialCoord crys2X[MAX_PACKET_SIZE];
+    types::SpatialCoord crys2Y[MAX_PACKET_SIZE];
+    types::SpatialCoord crys2Z[MAX_PACKET_SIZE];
+  };
+
+  // Setup of a packet of LORs for the voxel walk of the packet
+  // tracer (structure of arrays, one element per LOR)
+  struct RayPacket
+  {
+    int nLORs{0};
+
+    // False if the LOR doesn't cross the volume
+    bool crosses[MAX_PACKET_SIZE];
+
+    // Values of alpha where the LOR enters and exits the volume
+    double alphaMin[MAX_PACKET_SIZE];
+    double alphaMax[MAX_PACKET_SIZE];
+
+    // Length of the LOR
+    double d12[MAX_PACKET_SIZE];
+
+    // [dim] Value of alpha of the first plane crossed after
+    // entering the volume, variation of alpha between planes,
+    // entry voxel and direction of travel (DIR_NEG, DIR_POS)
+    double alphaDim[3][MAX_PACKET_SIZE];
+    double dAlpha[3][MAX_PACKET_SIZE];
+    double position[3][MAX_PACKET_SIZE];
+    double dir[3][MAX_PACKET_SIZE];
+  };
+
+  // Crossings of the transaxial projection of a LOR with the
+  // planes between pixels
+  // Shared by all LORs between the same two angular crystal
+  // coordinates, whatever their axial crystal coordinates
+  struct TransaxialPath
+  {
+    // False if the LOR doesn't cross the volume in XY
+    bool crosses{false};
+
+    // Components of the LOR in X and Y (as used by Siddon)
+    types::PathExtent diffX;
+    types::PathExtent diffY;
+
+    // Values of alpha where the LOR enters and exits the
+    // volume in XY
+    types::PathExtent alphaMin;
+    types::PathExtent alphaMax;
+
+    // [element] Index of the pixel within a slice (-1 if
+    // outside the volume)
+    std::vector<types::Index> coords;
+
+    // [element] Value of alpha where the LOR exits the pixel
+    std::vector<types::PathExtent> alphaExits;
+  };
+
+  // clipRadius: Rays are clipped to the cylinder of that
+  // radius around the center of the volume in XY (see
+  // operations::getCircleRows), widened by half a pixel
+  // diagonal so that the pixels whose center is inside are
+  // crossed whole (0: No clipping)
+  // packetSize: Packet size of computePathPacket, among those
+  // of getSupportedPacketSizes (0: The largest)
+  Siddon(
+    const VolData& vol,
+    double clipRadius = 0.0,
+    int packetSize = 0);
 
   ~Siddon();
 
   void printContent() const;
 
+  // Number of LORs traced at once by computePathPacket
+  // Selected at runtime from the instruction set of the CPU
+  // (4: SSE2, 8: AVX2, 16: AVX-512)
+  int getPacketSize() const;
+
+  // Packet sizes of the instruction sets supported by the CPU,
+  // in increasing order
+  static std::vector<int> getSupportedPacketSizes();
+
+  // Maximum number of elements of a path, terminator included
+  int getMaxPathLength() const;
+
   // Call to get path element vector for current thread
-  types::PathElement* getThreadLocalPathElements() const;
+  // lane: LOR of a packet (one vector per LOR)
+  types::PathElement* getThreadLocalPathElements(
+    int lane = 0) const;
 
   // Compute LOR path from scanner coordinates of crystal pair
   // Provide path element vector for current thread
@@ -54,37 +161,196 @@ public:
     types::SpatialCoord crys2_Z,
     types::PathElement* pathElementsArray) const;
 
+  // Trace LOR from spatial coordinates of crystal pair,
+  // calling visitor(coord, length) for each element of the
+  // path given by computePath, in the same order
+  // Nothing is stored, so that the visitor can accumulate a
+  // line integral or update a volume during traversal
+  // Returns true if LOR crosses volume, false otherwise
+  template<typename Visitor>
+  bool trace(
+    types::SpatialCoord crys1_X,
+    types::SpatialCoord crys1_Y,
+    types::SpatialCoord crys1_Z,
+    types::SpatialCoord crys2_X,
+    types::SpatialCoord crys2_Y,
+    types::SpatialCoord crys2_Z,
+    Visitor&& visitor) const;
+
+  // Same as trace from scanner coordinates of crystal pair
+  template<typename Visitor>
+  bool traceBetweenCrystals(
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAngCoord1,
+    int crysAxialCoord2,
+    int crysAngCoord2,
+    Visitor&& visitor) const;
+
+  // Add LOR between crystal pair to packet
+  // At most getPacketSize() LORs can be added
+  void addToPacket(
+    Packet& packet,
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAngCoord1,
+    int crysAxialCoord2,
+    int crysAngCoord2) const;
+
+  // Compute paths of all LORs of a packet with SIMD
+  // instructions, giving the same paths as computePath
+  // Provide path element vector of each LOR for current thread
+  // crosses: For each LOR, true if LOR crosses volume
+  void computePathPacket(
+    const Packet& packet,
+    types::PathElement* const* pathElementsArrays,
+    bool* crosses) const;
+
+  // Compute setup of all LORs of a packet for the voxel walk
+  void computeRayPacket(
+    const Packet& packet,
+    RayPacket& rays) const;
+
+  // Same as computePathPacket from the setup of the LORs,
+  // starting straight at the voxel walk
+  void computePathPacket(
+    const RayPacket& rays,
+    types::PathElement* const* pathElementsArrays,
+    bool* crosses) const;
+
+  // Compute transaxial path from spatial coordinates of
+  // crystal pair in XY
+  // Returns true if LOR crosses volume in XY, false otherwise
+  bool computeTransaxialPath(
+    types::SpatialCoord crys1_X,
+    types::SpatialCoord crys1_Y,
+    types::SpatialCoord crys2_X,
+    types::SpatialCoord crys2_Y,
+    TransaxialPath& transaxialPath) const;
+
+  // Compute transaxial paths of all LORs of a view
+  // transaxialPaths: One path per tangential coordinate
+  // (index tangCoord + tangCoordOffset)
+  void computeViewTransaxialPaths(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    int view,
+    std::vector<TransaxialPath>& transaxialPaths) const;
+
+  // Compute LOR path by merging the crossings of the planes
+  // between slices with the transaxial path of the LOR, giving
+  // the same path as computePath
+  // Provide path element vector for current thread
+  // Returns true if LOR crosses volume, false otherwise
+  bool computePathFromTransaxial(
+    const TransaxialPath& transaxialPath,
+    types::SpatialCoord crys1_Z,
+    types::SpatialCoord crys2_Z,
+    types::PathElement* pathElementsArray) const;
+
+  // Same as computePathFromTransaxial from axial crystal
+  // coordinates
+  bool computePathFromTransaxialBetweenCrystals(
+    const TransaxialPath& transaxialPath,
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAxialCoord2,
+    types::PathElement* pathElementsArray) const;
+
+  // Same as trace for the path given by
+  // computePathFromTransaxial
+  template<typename Visitor>
+  bool traceFromTransaxial(
+    const TransaxialPath& transaxialPath,
+    types::SpatialCoord crys1_Z,
+    types::SpatialCoord crys2_Z,
+    Visitor&& visitor) const;
+
+  // Same as traceFromTransaxial from axial crystal coordinates
+  template<typename Visitor>
+  bool traceFromTransaxialBetweenCrystals(
+    const TransaxialPath& transaxialPath,
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAxialCoord2,
+    Visitor&& visitor) const;
+
+  // True if the slices of the scanner are evenly spaced by the
+  // slice thickness of the volume and all inside the volume
+  // The paths of two LORs whose crystals are shifted by the
+  // same number of slices are then the same up to a shift of
+  // the voxel indices (see getAxialShift)
+  bool isAxiallyAligned(const ScannerData& scanner) const;
+
+  // Shift of the voxel indices between the paths of two LORs
+  // whose crystals are shifted by the same number of slices,
+  // for an axially aligned scanner
+  // crysAxialCoord, refCrysAxialCoord: Axial coordinate of the
+  // first crystal of each LOR
+  types::Index getAxialShift(
+    int crysAxialCoord,
+    int refCrysAxialCoord) const;
+
+  // First and last slices of the volume that a LOR between two
+  // axial crystal coordinates can cross, whatever its angular
+  // crystal coordinates (first > last if none)
+  std::tuple<int, int> getSliceRange(
+    const ScannerData& scanner,
+    int crysAxialCoord1,
+    int crysAxialCoord2) const;
+
+  // Values of alpha where a LOR enters and exits a cylinder in
+  // XY (entry not lower than exit if it misses it)
+  static inline std::tuple<types::PathExtent, types::PathExtent>
+  getCylinderEntryExit(
+    types::SpatialCoord crys1X,
+    types::SpatialCoord crys1Y,
+    types::SpatialCoord crys2X,
+    types::SpatialCoord crys2Y,
+    types::SpatialCoord centerX,
+    types::SpatialCoord centerY,
+    types::SpatialCoord radius);
+
 private:
 
   struct Setup
   {
-    types::SpatialCoord diff;
+    types::PathExtent diff;
     int dir;
-    types::SpatialCoord alphaMin;
-    types::SpatialCoord alphaMax;
-    types::SpatialCoord nextAlpha; // TODO: Rename
+    types::PathExtent alphaMin;
+    types::PathExtent alphaMax;
+    types::PathExtent nextAlpha; // TODO: Rename
   };
 
   template<int Dim>
   inline std::optional<Siddon::Setup> dimSetup(
-    types::SpatialCoord crys1,
-    types::SpatialCoord crys2) const;
+    types::PathExtent crys1,
+    types::PathExtent crys2) const;
 
-  inline std::tuple<types::SpatialCoord, types::SpatialCoord>
+  inline std::tuple<types::PathExtent, types::PathExtent>
   getEntryExit(
     const Setup& setupX,
     const Setup& setupY,
     const Setup& setupZ) const;
 
+  // Range of alpha of a LOR within the clipping cylinder
+  // (ALPHA_MIN to ALPHA_MAX without clipping)
+  inline std::tuple<types::PathExtent, types::PathExtent>
+  getClipEntryExit(
+    types::SpatialCoord crys1X,
+    types::SpatialCoord crys1Y,
+    types::SpatialCoord crys2X,
+    types::SpatialCoord crys2Y) const;
+
   template<int Dim>
   inline int getStartInd(
-    types::SpatialCoord crys1,
-    types::SpatialCoord diff,
-    types::SpatialCoord alphaMin) const;
+    types::PathExtent crys1,
+    types::PathExtent diff,
+    types::PathExtent alphaMin) const;
 
   template<int Dim>
-  inline types::SpatialCoord prepareDim(
-    types::SpatialCoord crys1,
+  inline types::PathExtent prepareDim(
+    types::PathExtent crys1,
     const Siddon::Setup& setup,
     IndexTriplet& position,
     const Siddon::CoordTriplet& dAlpha) const;
@@ -93,7 +359,7 @@ private:
   inline void updateDim(
     CoordTriplet& alphaDim,
     IndexTriplet& position,
-    types::SpatialCoord nextAlpha,
+    types::PathExtent nextAlpha,
     const Siddon::CoordTriplet& dAlpha,
     int dir) const;
 
@@ -110,15 +376,25 @@ private:
   types::Size mRowSize;
   types::Size mSliceSize;
   SizeTriplet mVolSizeM1;
-  SizeTriplet mVoxelExtent;
+  CoordTriplet mVoxelExtent;
 
   // Border plane position
   CoordTriplet mLowPlanes;
   CoordTriplet mHighPlanes;
 
+  // Clipping cylinder (radius 0: No clipping)
+  types::SpatialCoord mClipRadius;
+  types::SpatialCoord mClipCenterX;
+  types::SpatialCoord mClipCenterY;
+
   // Maximum length of a path element array for each thread
   int mMaxPathLength;
 
+  // Number of LORs traced at once by computePathPacket
+  int mPacketSize;
+
   // Array of path elements (Managed internally)
   types::PathElement* mPathElementArray;
 };
+
+#include <Siddon.inl>
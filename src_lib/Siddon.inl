@@ -0,0 +1,533 @@
+#pragma once
+
+#include <Siddon.h>
+#include <macros.h>
+
+#include <algorithm>
+#include <cmath>
+
+template<typename Visitor>
+bool Siddon::trace(
+  types::SpatialCoord crys1X,
+  types::SpatialCoord crys1Y,
+  types::SpatialCoord crys1Z,
+  types::SpatialCoord crys2X,
+  types::SpatialCoord crys2Y,
+  types::SpatialCoord crys2Z,
+  Visitor&& visitor) const
+{
+  // The line of response (LOR) going from crys1 (x1, y1, z1)
+  // to crys2 (x2, y2, z2) is parameterized as:
+  //   x(alpha) = x1 + (x2 - x1) * alpha = x1 + diffX * alpha
+  //   Similarly for Y and Z
+  // => alpha goes from 0 to 1 when moving from crys1 to crys2
+  //
+  // The value of alpha for a given value of x, y or z is thus:
+  //   alpha = (x - x1) / diffX
+  //   Similarly for Y and Z
+  //
+  // dir for a dimension D:
+  //   +1 or -1 depending on whether crys2 is reached from
+  //   crys1 by increasing D (+1) or decreasing D (-1)
+  //
+  // alphaMin and alphaMax for a dimension D:
+  //   Values of alpha for which the LOR intersects the planes
+  //   of constant D at the edge of the volume:
+  //   alphaMin for the one closest to crys1 and
+  //   alphaMax for the one farthest from crys1
+
+  // Setup in X
+  const auto setupXout = dimSetup<X_DIM>(crys1X, crys2X);
+  if (!setupXout.has_value())
+  {
+    return false;
+  }
+  const auto setupX = setupXout.value();
+
+  // Setup in Y
+  auto setupYout = dimSetup<Y_DIM>(crys1Y, crys2Y);
+  if (!setupYout.has_value())
+  {
+    return false;
+  }
+  const auto setupY = setupYout.value();
+
+  // Setup in Z
+  const auto setupZout = dimSetup<Z_DIM>(crys1Z, crys2Z);
+  if (!setupZout.has_value())
+  {
+    return false;
+  }
+  const auto setupZ = setupZout.value();
+
+  // Values of alpha producing the points where the LOR enters
+  // and exits the volume, within the clipping cylinder
+  const auto [volAlphaMin, volAlphaMax] =
+    getEntryExit(setupX, setupY, setupZ);
+  const auto [clipAlphaMin, clipAlphaMax] =
+    getClipEntryExit(crys1X, crys1Y, crys2X, crys2Y);
+  const auto alphaMin = MAX(volAlphaMin, clipAlphaMin);
+  const auto alphaMax = MIN(volAlphaMax, clipAlphaMax);
+  if (alphaMin >= alphaMax)
+  {
+    return false;
+  }
+
+  // Find the variations of alpha necessary to travel between
+  // neighboring inter-voxel planes for a given dimension
+  const CoordTriplet dAlpha{
+    std::get<X_DIM>(mVoxelExtent) / ABS(setupX.diff),
+    std::get<Y_DIM>(mVoxelExtent) / ABS(setupY.diff),
+    std::get<Z_DIM>(mVoxelExtent) / ABS(setupZ.diff)};
+
+  // Find the constant d12 such that alpha * d12 gives distance
+  // from crys1 to the point described by the value of alpha
+  const auto d12 = std::sqrt(
+    setupX.diff * setupX.diff + setupY.diff * setupY.diff +
+    setupZ.diff * setupZ.diff);
+
+  // Initialize position:
+  // Find the voxel where the LOR enters the volume
+  IndexTriplet position{
+    getStartInd<X_DIM>(crys1X, setupX.diff, alphaMin),
+    getStartInd<Y_DIM>(crys1Y, setupY.diff, alphaMin),
+    getStartInd<Z_DIM>(crys1Z, setupZ.diff, alphaMin)};
+
+  // For each non-cancelled dimension, get the value of alpha
+  // for which the LOR touches the second plane along that
+  // dimension after entering the volume
+  CoordTriplet alphaDim{
+    prepareDim<X_DIM>(crys1X, setupX, position, dAlpha),
+    prepareDim<Y_DIM>(crys1Y, setupY, position, dAlpha),
+    prepareDim<Z_DIM>(crys1Z, setupZ, position, dAlpha)};
+
+  types::PathExtent previousAlpha{alphaMin};
+  while (previousAlpha < alphaMax)
+  {
+    // Update nextAlpha to the next value for which the LOR
+    // touches a plane between neighboring voxels
+    const auto nextAlpha = MIN(
+      alphaMax,
+      MIN(
+        std::get<X_DIM>(alphaDim),
+        MIN(
+          std::get<Y_DIM>(alphaDim),
+          std::get<Z_DIM>(alphaDim))));
+
+    // Visit new path element after making sure it is within
+    // the boundaries of the volume
+    if (checkIndices(position))
+    {
+      visitor(
+        getLinearCoord(position),
+        (nextAlpha - previousAlpha) * d12);
+    }
+
+    updateDim<X_DIM>(
+      alphaDim,
+      position,
+      nextAlpha,
+      dAlpha,
+      setupX.dir);
+    updateDim<Y_DIM>(
+      alphaDim,
+      position,
+      nextAlpha,
+      dAlpha,
+      setupY.dir);
+    updateDim<Z_DIM>(
+      alphaDim,
+      position,
+      nextAlpha,
+      dAlpha,
+      setupZ.dir);
+
+    previousAlpha = nextAlpha;
+  }
+
+  return true;
+}
+
+template<typename Visitor>
+bool Siddon::traceBetweenCrystals(
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAngCoord1,
+  int crysAxialCoord2,
+  int crysAngCoord2,
+  Visitor&& visitor) const
+{
+  // Get access to crystal positions
+  const auto* crystalXYPositionVector =
+    scanner.getCrystalXYPositionVector();
+  const auto* sliceZPositionVector =
+    scanner.getSliceZPositionVector();
+
+  return trace(
+    crystalXYPositionVector[crysAngCoord1].x,
+    crystalXYPositionVector[crysAngCoord1].y,
+    sliceZPositionVector[crysAxialCoord1],
+    crystalXYPositionVector[crysAngCoord2].x,
+    crystalXYPositionVector[crysAngCoord2].y,
+    sliceZPositionVector[crysAxialCoord2],
+    visitor);
+}
+
+template<typename Visitor>
+bool Siddon::traceFromTransaxial(
+  const TransaxialPath& transaxialPath,
+  types::SpatialCoord crys1Z,
+  types::SpatialCoord crys2Z,
+  Visitor&& visitor) const
+{
+  if (!transaxialPath.crosses)
+  {
+    return false;
+  }
+
+  // Setup in Z
+  const auto setupZout = dimSetup<Z_DIM>(crys1Z, crys2Z);
+  if (!setupZout.has_value())
+  {
+    return false;
+  }
+  const auto setupZ = setupZout.value();
+
+  // Values of alpha producing the points where the LOR enters
+  // and exits the volume
+  const auto alphaMin =
+    MAX(transaxialPath.alphaMin, setupZ.alphaMin);
+  const auto alphaMax =
+    MIN(transaxialPath.alphaMax, setupZ.alphaMax);
+  if (alphaMin >= alphaMax)
+  {
+    return false;
+  }
+
+  // X and Y are left out of the triplets below
+  const CoordTriplet dAlpha{
+    ALPHA_MAX,
+    ALPHA_MAX,
+    std::get<Z_DIM>(mVoxelExtent) / ABS(setupZ.diff)};
+
+  const auto d12 = std::sqrt(
+    transaxialPath.diffX * transaxialPath.diffX +
+    transaxialPath.diffY * transaxialPath.diffY +
+    setupZ.diff * setupZ.diff);
+
+  IndexTriplet position{
+    0,
+    0,
+    getStartInd<Z_DIM>(crys1Z, setupZ.diff, alphaMin)};
+
+  // Value of alpha where the LOR crosses the next plane between
+  // slices
+  auto alphaZ =
+    prepareDim<Z_DIM>(crys1Z, setupZ, position, dAlpha);
+
+  const auto dAlphaZ = std::get<Z_DIM>(dAlpha);
+  const auto lastSlice = std::get<Z_DIM>(mVolSizeM1);
+  auto slice = std::get<Z_DIM>(position);
+
+  const auto* coords = transaxialPath.coords.data();
+  const auto* alphaExits = transaxialPath.alphaExits.data();
+  const int lastElement = transaxialPath.coords.size() - 1;
+
+  // Pixel where the LOR enters the volume
+  // Note: The last pixel is exited at the end of the
+  // transaxial path (alphaExits[lastElement] >= alphaMax)
+  int element = std::upper_bound(
+                  alphaExits,
+                  alphaExits + lastElement,
+                  alphaMin) -
+    alphaExits;
+
+  types::PathExtent previousAlpha{alphaMin};
+  while (previousAlpha < alphaMax)
+  {
+    const auto sliceInside = slice >= 0 && slice <= lastSlice;
+    const auto sliceOffset = slice * mSliceSize;
+
+    // Pixels exited before the next plane between slices (same
+    // as the general case below when only the pixel changes)
+    const auto alphaRunEnd = MIN(alphaMax, alphaZ - EPSILON);
+    while (alphaExits[element] < alphaRunEnd)
+    {
+      if (coords[element] != -1 && sliceInside)
+      {
+        visitor(
+          coords[element] + sliceOffset,
+          (alphaExits[element] - previousAlpha) * d12);
+      }
+
+      previousAlpha = alphaExits[element];
+      ++element;
+    }
+
+    // Next value for which the LOR touches a plane between
+    // neighboring pixels or slices
+    const auto nextAlpha =
+      MIN(alphaMax, MIN(alphaExits[element], alphaZ));
+
+    if (coords[element] != -1 && sliceInside)
+    {
+      visitor(
+        coords[element] + sliceOffset,
+        (nextAlpha - previousAlpha) * d12);
+    }
+
+    // Move to the next pixel and slice
+    if (
+      element < lastElement &&
+      ABS(alphaExits[element] - nextAlpha) < EPSILON)
+    {
+      ++element;
+    }
+
+    if (ABS(alphaZ - nextAlpha) < EPSILON)
+    {
+      alphaZ += dAlphaZ;
+      slice += setupZ.dir;
+    }
+
+    previousAlpha = nextAlpha;
+  }
+
+  return true;
+}
+
+template<typename Visitor>
+bool Siddon::traceFromTransaxialBetweenCrystals(
+  const TransaxialPath& transaxialPath,
+  const ScannerData& scanner,
+  int crysAxialCoord1,
+  int crysAxialCoord2,
+  Visitor&& visitor) const
+{
+  const auto* sliceZPositionVector =
+    scanner.getSliceZPositionVector();
+
+  return traceFromTransaxial(
+    transaxialPath,
+    sliceZPositionVector[crysAxialCoord1],
+    sliceZPositionVector[crysAxialCoord2],
+    visitor);
+}
+
+template<int Dim>
+std::optional<Siddon::Setup> Siddon::dimSetup(
+  types::PathExtent crys1,
+  types::PathExtent crys2) const
+{
+  const auto lowPlane = std::get<Dim>(mLowPlanes);
+  const auto highPlane = std::get<Dim>(mHighPlanes);
+
+  auto diff = crys2 - crys1;
+
+  int dir;
+  types::PathExtent alphaMin, alphaMax, nextAlpha;
+  if (ABS(diff) > EPSILON)
+  {
+    if (diff > 0)
+    {
+      // LOR entering volume from low plane
+      dir = DIR_POS;
+      alphaMin = (lowPlane - crys1) / diff;
+      alphaMax = (highPlane - crys1) / diff;
+    }
+    else
+    {
+      // LOR entering volume from high plane
+      dir = DIR_NEG;
+      alphaMin = (highPlane - crys1) / diff;
+      alphaMax = (lowPlane - crys1) / diff;
+    }
+
+    // Indicates that the dimension is not "cancelled"
+    nextAlpha = ALPHA_MIN;
+  }
+  else
+  {
+    // The LOR has no component along the current dimension
+
+    if (crys1 < lowPlane || crys1 > highPlane)
+    {
+      // The LOR doesn't intersect the volume: skip it
+      return std::nullopt;
+    }
+
+    // The LOR intersects the volume: Set special values
+
+    diff = EPSILON;
+    dir = DIR_NEG;
+
+    // Widest allowed range of alpha so that those values do not
+    // interfere in the computation of the point of entry
+    alphaMin = ALPHA_MIN;
+    alphaMax = ALPHA_MAX;
+
+    // Indicates that the dimension is "cancelled"
+    nextAlpha = ALPHA_MAX;
+  }
+
+  return Setup{diff, dir, alphaMin, alphaMax, nextAlpha};
+}
+
+std::tuple<types::PathExtent, types::PathExtent> Siddon::
+  getEntryExit(
+    const Setup& setupX,
+    const Setup& setupY,
+    const Setup& setupZ) const
+{
+  const auto alphaMin = MAX(
+    setupX.alphaMin,
+    MAX(setupY.alphaMin, MAX(setupZ.alphaMin, ALPHA_MIN)));
+
+  const auto alphaMax = MIN(
+    setupX.alphaMax,
+    MIN(setupY.alphaMax, MIN(setupZ.alphaMax, ALPHA_MAX)));
+
+  return {alphaMin, alphaMax};
+}
+
+std::tuple<types::PathExtent, types::PathExtent> Siddon::
+  getClipEntryExit(
+    types::SpatialCoord crys1X,
+    types::SpatialCoord crys1Y,
+    types::SpatialCoord crys2X,
+    types::SpatialCoord crys2Y) const
+{
+  if (mClipRadius <= 0.0)
+  {
+    return {ALPHA_MIN, ALPHA_MAX};
+  }
+
+  return getCylinderEntryExit(
+    crys1X,
+    crys1Y,
+    crys2X,
+    crys2Y,
+    mClipCenterX,
+    mClipCenterY,
+    mClipRadius);
+}
+
+std::tuple<types::PathExtent, types::PathExtent> Siddon::
+  getCylinderEntryExit(
+    types::SpatialCoord crys1X,
+    types::SpatialCoord crys1Y,
+    types::SpatialCoord crys2X,
+    types::SpatialCoord crys2Y,
+    types::SpatialCoord centerX,
+    types::SpatialCoord centerY,
+    types::SpatialCoord radius)
+{
+  // Roots of |crys1 + alpha * diff - center|^2 = radius^2 in XY
+  const auto diffX = crys2X - crys1X;
+  const auto diffY = crys2Y - crys1Y;
+  const auto offsetX = crys1X - centerX;
+  const auto offsetY = crys1Y - centerY;
+
+  const auto a = diffX * diffX + diffY * diffY;
+  const auto halfB = diffX * offsetX + diffY * offsetY;
+  const auto c =
+    offsetX * offsetX + offsetY * offsetY - radius * radius;
+
+  // LOR parallel to the axis of the cylinder
+  if (a < EPSILON * EPSILON)
+  {
+    if (c <= 0.0)
+    {
+      return {ALPHA_MIN, ALPHA_MAX};
+    }
+    return {ALPHA_MAX, ALPHA_MIN};
+  }
+
+  const auto discriminant = halfB * halfB - a * c;
+  if (discriminant <= 0.0)
+  {
+    return {ALPHA_MAX, ALPHA_MIN};
+  }
+
+  const auto root = std::sqrt(discriminant);
+
+  return {(-halfB - root) / a, (-halfB + root) / a};
+}
+
+template<int Dim>
+int Siddon::getStartInd(
+  types::PathExtent crys1,
+  types::PathExtent diff,
+  types::PathExtent alphaMin) const
+{
+  auto ind = static_cast<int>(
+    (crys1 + diff * alphaMin - std::get<Dim>(mLowPlanes)) /
+    std::get<Dim>(mVoxelExtent));
+
+  // Make sure the initial coordinates are within the volume
+  ind = MAX(0, MIN(ind, std::get<Dim>(mVolSizeM1)));
+
+  return ind;
+}
+
+template<int Dim>
+types::PathExtent Siddon::prepareDim(
+  types::PathExtent crys1,
+  const Siddon::Setup& setup,
+  IndexTriplet& position,
+  const Siddon::CoordTriplet& dAlpha) const
+{
+  auto alpha = setup.nextAlpha;
+
+  if (alpha < ALPHA_MAX)
+  {
+    const auto len = // RENAME
+      std::get<Dim>(mLowPlanes) +
+      std::get<Dim>(mVoxelExtent) * std::get<Dim>(position) -
+      crys1;
+
+    alpha = len / setup.diff;
+  }
+
+  if (setup.dir > 0)
+  {
+    alpha += std::get<Dim>(dAlpha);
+  }
+
+  return alpha;
+}
+
+template<int Dim>
+void Siddon::updateDim(
+  CoordTriplet& alphaDim,
+  IndexTriplet& position,
+  types::PathExtent nextAlpha,
+  const Siddon::CoordTriplet& dAlpha,
+  int dir) const
+{
+  if (ABS(std::get<Dim>(alphaDim) - nextAlpha) < EPSILON)
+  {
+    std::get<Dim>(alphaDim) += std::get<Dim>(dAlpha);
+    std::get<Dim>(position) += dir;
+  }
+}
+
+bool Siddon::checkIndices(const IndexTriplet& position) const
+{
+  return std::get<X_DIM>(position) >= 0 &&
+    std::get<X_DIM>(position) <= std::get<X_DIM>(mVolSizeM1) &&
+
+    std::get<Y_DIM>(position) >= 0 &&
+    std::get<Y_DIM>(position) <= std::get<Y_DIM>(mVolSizeM1) &&
+
+    std::get<Z_DIM>(position) >= 0 &&
+    std::get<Z_DIM>(position) <= std::get<Z_DIM>(mVolSizeM1);
+}
+
+types::Index Siddon::getLinearCoord(
+  const IndexTriplet& position) const
+{
+  return std::get<X_DIM>(position) +
+    std::get<Y_DIM>(position) * mRowSize +
+    std::get<Z_DIM>(position) * mSliceSize;
+}
@@ -0,0 +1,102 @@
+#include <SlabSchedule.h>
+
+#include <console.h>
+#include <macros.h>
+
+#include <string>
+
+SlabSchedule::SlabSchedule(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const Siddon& siddon):
+  mSegOffset{proj.getGeometry().segOffset},
+  mSlabThicknesses(2 * mSegOffset + 1),
+  mGroups(2 * mSegOffset + 1)
+{
+  // Check proj data dimensions
+  scanner.checkProjData(proj);
+
+  LOOP_SEG(seg, proj)
+  {
+    const auto nAxialCoords =
+      proj.getGeometry().getNAxialCoords(seg);
+
+    // [axialCoord] First and last slices crossed
+    std::vector<int> firstSlices(nAxialCoords);
+    std::vector<int> lastSlices(nAxialCoords);
+
+    auto slabThickness = 1;
+    LOOP(axialCoord, 0, nAxialCoords - 1)
+    {
+      const auto [crystalAxialCoord1, crystalAxialCoord2] =
+        proj.getCrystalAxialCoord(seg, axialCoord);
+
+      const auto [firstSlice, lastSlice] =
+        siddon.getSliceRange(
+          scanner,
+          crystalAxialCoord1,
+          crystalAxialCoord2);
+
+      firstSlices[axialCoord] = firstSlice;
+      lastSlices[axialCoord] = lastSlice;
+
+      slabThickness =
+        MAX(slabThickness, lastSlice - firstSlice + 1);
+    }
+
+    auto& groups = mGroups[seg + mSegOffset];
+    mSlabThicknesses[seg + mSegOffset] = slabThickness;
+
+    LOOP(axialCoord, 0, nAxialCoords - 1)
+    {
+      // LORs outside the volume cross no slice: Any slab
+      const auto slab =
+        firstSlices[axialCoord] > lastSlices[axialCoord] ?
+        0 :
+        firstSlices[axialCoord] / slabThickness;
+
+      auto& phaseGroups = groups[slab % N_PHASES];
+      const auto group = slab / N_PHASES;
+
+      if ((int)phaseGroups.size() <= group)
+      {
+        phaseGroups.resize(group + 1);
+      }
+      phaseGroups[group].push_back(axialCoord);
+    }
+
+    // Remove groups of empty slabs
+    for (auto& phaseGroups : groups)
+    {
+      std::vector<std::vector<int>> nonEmptyGroups;
+      for (auto& group : phaseGroups)
+      {
+        if (!group.empty())
+        {
+          nonEmptyGroups.push_back(std::move(group));
+        }
+      }
+      phaseGroups = std::move(nonEmptyGroups);
+    }
+  }
+}
+
+void SlabSchedule::printContent() const
+{
+  LOOP(segIndex, 0, 2 * mSegOffset)
+  {
+    const auto seg = segIndex - mSegOffset;
+    printValue(
+      "Segment " + std::to_string(seg) + " slab thickness",
+      mSlabThicknesses[segIndex]);
+    printValue(
+      "Segment " + std::to_string(seg) + " groups",
+      getNGroups(seg, 0) + getNGroups(seg, 1));
+  }
+  printEmptyLine();
+}
+
+int SlabSchedule::getNGroups(int seg, int phase) const
+{
+  return mGroups[seg + mSegOffset][phase].size();
+}
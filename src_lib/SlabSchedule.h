@@ -0,0 +1,75 @@
+#pragma once
+
+#include <LORCache.h>
+#include <LORList.h>
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <Siddon.h>
+#include <SystemMatrix.h>
+#include <types.h>
+
+#include <array>
+#include <vector>
+
+// Schedule of the LORs of each segment in groups whose paths
+// cross disjoint slices of the volume, so that the threads can
+// back-project them without synchronization
+//
+// The volume is split into slabs of slices as thick as the
+// widest range of slices crossed by a LOR of the segment. The
+// LORs of an axial coordinate belong to the slab of the first
+// slice they cross, and only cross that slab and the next one.
+// The groups of the even slabs, then of the odd slabs, are
+// processed in parallel, one phase after the other.
+
+class SlabSchedule
+{
+public:
+
+  // Phases of a segment: Even and odd slabs
+  static constexpr int N_PHASES{2};
+
+  SlabSchedule(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const Siddon& siddon);
+
+  void printContent() const;
+
+  // Number of groups processed in parallel in a phase
+  int getNGroups(int seg, int phase) const;
+
+  // Call function(seg, binIndex, pathElements) for each LOR of
+  // the list of the subset, in parallel
+  // Calls running at the same time are for LORs crossing
+  // disjoint slices
+  // Paths are the rows of systemMatrix if provided and stored,
+  // and are traced from the transaxial path of each view
+  // otherwise
+  template<typename Function>
+  void forEachLOR(
+    int subset,
+    int nSubsets,
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const Siddon& siddon,
+    const LORCache& cache,
+    const LORList& lorList,
+    const SystemMatrix* systemMatrix,
+    Function&& function) const;
+
+private:
+
+  int mSegOffset;
+
+  // [seg + segOffset] Thickness of the slabs in slices
+  std::vector<int> mSlabThicknesses;
+
+  // [seg + segOffset][phase][group] Axial coordinates of the
+  // LORs of each group
+  std::vector<
+    std::array<std::vector<std::vector<int>>, N_PHASES>>
+    mGroups;
+};
+
+#include <SlabSchedule.inl>
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <SlabSchedule.h>
+#include <macros.h>
+
+template<typename Function>
+void SlabSchedule::forEachLOR(
+  int subset,
+  int nSubsets,
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const Siddon& siddon,
+  const LORCache& cache,
+  const LORList& lorList,
+  const SystemMatrix* systemMatrix,
+  Function&& function) const
+{
+  const auto nViewsPerSubset =
+    proj.getGeometry().nViews / nSubsets;
+  const auto nTangCoords = proj.getHeader().nTangCoords;
+
+  LOOP_SEG(seg, proj)
+  {
+    const auto nBinsPerView = cache.getNBinsPerView(seg);
+
+    for (const auto& groups : mGroups[seg + mSegOffset])
+    {
+      // Groups of a phase don't share slices: No
+      // synchronization until the end of the phase
+#pragma omp parallel
+      {
+        // Transaxial paths of the current view
+        std::vector<Siddon::TransaxialPath> transaxialPaths;
+
+        auto* threadLocalPathElements =
+          siddon.getThreadLocalPathElements();
+
+#pragma omp for schedule(dynamic)
+        LOOP(group, 0, (int)groups.size() - 1)
+        {
+          LOOP(subview, 0, nViewsPerSubset - 1)
+          {
+            const auto view = subview * nSubsets + subset;
+
+            siddon.computeViewTransaxialPaths(
+              proj,
+              scanner,
+              view,
+              transaxialPaths);
+
+            for (const auto axialCoord : groups[group])
+            LOOP(tangIndex, 0, nTangCoords - 1)
+            {
+              // Index of LOR in LORCache order
+              const auto index = subview * nBinsPerView +
+                axialCoord * nTangCoords + tangIndex;
+
+              if (!lorList.contains(subset, seg, index))
+              {
+                continue;
+              }
+
+              const auto
+                [valid,
+                 binIndex,
+                 crystalAxialCoord1,
+                 crystalAngCoord1,
+                 crystalAxialCoord2,
+                 crystalAngCoord2] =
+                  cache.getLOR(subset, seg, index);
+
+              // Get path from system matrix if stored
+              const types::PathElement* pathElements =
+                systemMatrix == nullptr ?
+                nullptr :
+                systemMatrix->getRow(subset, seg, index);
+
+              if (pathElements == nullptr)
+              {
+                siddon.computePathFromTransaxialBetweenCrystals(
+                  transaxialPaths[tangIndex],
+                  scanner,
+                  crystalAxialCoord1,
+                  crystalAxialCoord2,
+                  threadLocalPathElements);
+
+                pathElements = threadLocalPathElements;
+              }
+
+              function(seg, binIndex, pathElements);
+            }
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,374 @@
+#include <Symmetries.h>
+
+#include <console.h>
+#include <macros.h>
+
+#include <cmath>
+
+// Tolerance on positions mapped by a symmetry, relative to the
+// pixel size for pixels and in mm for crystals
+constexpr double POSITION_TOLERANCE{1e-3};
+
+// Symmetries of the square in XY (identity excluded)
+// (x, y) -> (m[0] * x + m[1] * y, m[2] * x + m[3] * y)
+struct Transform
+{
+  const char* name;
+  int m[4];
+};
+
+constexpr Transform TRANSFORMS[]{
+  {"Rotation by 90 degrees", {0, -1, 1, 0}},
+  {"Rotation by 180 degrees", {-1, 0, 0, -1}},
+  {"Rotation by 270 degrees", {0, 1, -1, 0}},
+  {"Mirror across X axis", {1, 0, 0, -1}},
+  {"Mirror across Y axis", {-1, 0, 0, 1}},
+  {"Mirror across diagonal y = x", {0, 1, 1, 0}},
+  {"Mirror across diagonal y = -x", {0, -1, -1, 0}}};
+
+static types::SpatialCoords2D apply(
+  const Transform& transform,
+  const types::SpatialCoords2D& position)
+{
+  const auto* m = transform.m;
+
+  return {
+    m[0] * position.x + m[1] * position.y,
+    m[2] * position.x + m[3] * position.y};
+}
+
+// Get the crystal of each crystal's image
+// Returns false if an image isn't a crystal
+static bool getCrystalPermutation(
+  const ScannerData& scanner,
+  const Transform& transform,
+  std::vector<int>& crystalPermutation)
+{
+  const auto nCrystals = scanner.getGeometry().nCrystalsPerRing;
+  const auto* positions = scanner.getCrystalXYPositionVector();
+
+  crystalPermutation.assign(nCrystals, -1);
+
+  LOOP(crystal, 0, nCrystals - 1)
+  {
+    const auto image = apply(transform, positions[crystal]);
+
+    LOOP(candidate, 0, nCrystals - 1)
+    {
+      if (
+        ABS(positions[candidate].x - image.x) <
+          POSITION_TOLERANCE &&
+        ABS(positions[candidate].y - image.y) <
+          POSITION_TOLERANCE)
+      {
+        crystalPermutation[crystal] = candidate;
+        break;
+      }
+    }
+
+    if (crystalPermutation[crystal] == -1)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Get the pixel of each pixel's image within a slice
+// Returns false if an image isn't a pixel
+static bool getPixelPermutation(
+  const VolHeader& header,
+  const Transform& transform,
+  std::vector<types::Index>& pixelPermutation)
+{
+  const auto nPixelsX = header.volSize.nPixelsX;
+  const auto nPixelsY = header.volSize.nPixelsY;
+  const auto width = header.voxelExtent.pixelWidth;
+  const auto height = header.voxelExtent.pixelHeight;
+  const auto& offset = header.volOffset;
+
+  pixelPermutation.resize(nPixelsX * nPixelsY);
+
+  LOOP(y, 0, nPixelsY - 1)
+  LOOP(x, 0, nPixelsX - 1)
+  {
+    // Image of the center of the pixel
+    const auto image = apply(
+      transform,
+      {offset.x + x * width, offset.y + y * height});
+
+    const auto imageX =
+      (int)std::lround((image.x - offset.x) / width);
+    const auto imageY =
+      (int)std::lround((image.y - offset.y) / height);
+
+    if (
+      imageX < 0 || imageX >= nPixelsX || imageY < 0 ||
+      imageY >= nPixelsY ||
+      ABS(offset.x + imageX * width - image.x) >
+        POSITION_TOLERANCE * width ||
+      ABS(offset.y + imageY * height - image.y) >
+        POSITION_TOLERANCE * height)
+    {
+      return false;
+    }
+
+    pixelPermutation[y * nPixelsX + x] =
+      imageY * nPixelsX + imageX;
+  }
+
+  return true;
+}
+
+// True if swapping the crystals of the LORs of each segment
+// gives the LORs of the opposite segment
+static bool areSegmentsSwappable(const ProjData& proj)
+{
+  LOOP_SEG(seg, proj)
+  LOOP_AXIAL(axialCoord, proj, seg)
+  {
+    const auto [crystalAxialCoord1, crystalAxialCoord2] =
+      proj.getCrystalAxialCoord(seg, axialCoord);
+
+    const auto [swappedAxialCoord1, swappedAxialCoord2] =
+      proj.getCrystalAxialCoord(-seg, axialCoord);
+
+    if (
+      swappedAxialCoord1 != crystalAxialCoord2 ||
+      swappedAxialCoord2 != crystalAxialCoord1)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Get the image of each LOR of the projection in XY
+// lorIndices: [crystal pair] Index of the LOR in XY
+// (view * nTangCoords + tangIndex, -1 if not in projection)
+// Returns false if an image isn't a LOR of the projection in
+// the same subset
+static bool mapLORs(
+  const ProjData& proj,
+  const std::vector<int>& crystalPermutation,
+  const std::vector<int>& lorIndices,
+  int nSubsets,
+  bool segmentsSwappable,
+  std::vector<int>& images,
+  std::vector<bool>& swapped)
+{
+  const auto nCrystals = proj.getHeader().nCrystalsPerRing;
+  const auto nTangCoords = proj.getHeader().nTangCoords;
+  const auto tangCoordOffset =
+    proj.getGeometry().tangCoordOffset;
+
+  images.resize(proj.getGeometry().nViews * nTangCoords);
+  swapped.resize(images.size());
+
+  LOOP_VIEW(view, proj)
+  LOOP(tangIndex, 0, nTangCoords - 1)
+  {
+    const auto tangCoord = tangIndex - tangCoordOffset;
+    const auto [crystalAngCoord1, crystalAngCoord2] =
+      proj.getCrystalAngCoord(view, tangCoord);
+
+    const auto image1 = crystalPermutation[crystalAngCoord1];
+    const auto image2 = crystalPermutation[crystalAngCoord2];
+
+    auto image = lorIndices[image1 * nCrystals + image2];
+    auto imageSwapped = false;
+
+    if (image == -1 && segmentsSwappable)
+    {
+      image = lorIndices[image2 * nCrystals + image1];
+      imageSwapped = true;
+    }
+
+    if (
+      image == -1 ||
+      image / nTangCoords % nSubsets != view % nSubsets)
+    {
+      return false;
+    }
+
+    images[view * nTangCoords + tangIndex] = image;
+    swapped[view * nTangCoords + tangIndex] = imageSwapped;
+  }
+
+  return true;
+}
+
+Symmetries::Symmetries(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets):
+  mSliceSize{
+    vol.getHeader().volSize.nPixelsX *
+    vol.getHeader().volSize.nPixelsY},
+  mNTangCoords{proj.getHeader().nTangCoords}
+{
+  // Check proj data dimensions and number of subsets
+  scanner.checkProjData(proj);
+  proj.checkNSubsets(nSubsets);
+
+  const auto nCrystals = proj.getHeader().nCrystalsPerRing;
+  const auto nViews = proj.getGeometry().nViews;
+  const auto nLORs = nViews * mNTangCoords;
+  const auto tangCoordOffset =
+    proj.getGeometry().tangCoordOffset;
+
+  // Index of the LOR of each crystal pair in XY
+  std::vector<int> lorIndices(nCrystals * nCrystals, -1);
+  LOOP_VIEW(view, proj)
+  LOOP(tangIndex, 0, mNTangCoords - 1)
+  {
+    const auto tangCoord = tangIndex - tangCoordOffset;
+    const auto [crystalAngCoord1, crystalAngCoord2] =
+      proj.getCrystalAngCoord(view, tangCoord);
+
+    const auto crystalPair =
+      crystalAngCoord1 * nCrystals + crystalAngCoord2;
+    lorIndices[crystalPair] = view * mNTangCoords + tangIndex;
+  }
+
+  const auto segmentsSwappable = areSegmentsSwappable(proj);
+
+  // Keep the transforms mapping crystals onto crystals, pixels
+  // onto pixels and LORs onto LORs of the same subset
+  // Note: They form a group, so that the images of a LOR by
+  // the symmetries used are the LORs of its orbit
+  std::vector<int> crystalPermutation;
+  for (const auto& transform : TRANSFORMS)
+  {
+    Symmetry symmetry;
+    symmetry.name = transform.name;
+
+    if (
+      getCrystalPermutation(
+        scanner,
+        transform,
+        crystalPermutation) &&
+      getPixelPermutation(
+        vol.getHeader(),
+        transform,
+        symmetry.pixelPermutation) &&
+      mapLORs(
+        proj,
+        crystalPermutation,
+        lorIndices,
+        nSubsets,
+        segmentsSwappable,
+        symmetry.images,
+        symmetry.swapped))
+    {
+      mSymmetries.push_back(std::move(symmetry));
+    }
+  }
+
+  // Fundamental LOR: First LOR of each orbit
+  mFundamental.assign(nLORs, true);
+  mSymmetricLORs.resize(nLORs);
+  mHasFundamentalLORs.assign(nViews, false);
+
+  LOOP(lor, 0, nLORs - 1)
+  {
+    if (!mFundamental[lor])
+    {
+      continue;
+    }
+
+    mHasFundamentalLORs[lor / mNTangCoords] = true;
+
+    LOOP(symmetryIndex, 0, getNSymmetries() - 1)
+    {
+      const auto& symmetry = mSymmetries[symmetryIndex];
+      const auto image = symmetry.images[lor];
+
+      // Images already mapped or fundamental
+      if (image == lor || !mFundamental[image])
+      {
+        continue;
+      }
+
+      mFundamental[image] = false;
+
+      mSymmetricLORs[lor].push_back(
+        {image / mNTangCoords,
+         image % mNTangCoords,
+         symmetry.swapped[lor],
+         symmetryIndex});
+    }
+  }
+}
+
+void Symmetries::printContent() const
+{
+  printValue("Number of symmetries", getNSymmetries());
+  for (const auto& symmetry : mSymmetries)
+  {
+    echo(symmetry.name);
+  }
+  printValue(
+    "Number of fundamental LORs",
+    getNFundamentalLORs());
+  printValue("Number of LORs", mFundamental.size());
+  printEmptyLine();
+}
+
+int Symmetries::getNSymmetries() const
+{
+  return mSymmetries.size();
+}
+
+int Symmetries::getNFundamentalLORs() const
+{
+  auto nFundamentalLORs = 0;
+  for (const auto fundamental : mFundamental)
+  {
+    nFundamentalLORs += fundamental ? 1 : 0;
+  }
+
+  return nFundamentalLORs;
+}
+
+bool Symmetries::isFundamental(int view, int tangIndex) const
+{
+  return mFundamental[view * mNTangCoords + tangIndex];
+}
+
+bool Symmetries::hasFundamentalLORs(int view) const
+{
+  return mHasFundamentalLORs[view];
+}
+
+const std::vector<Symmetries::SymmetricLOR>&
+Symmetries::getSymmetricLORs(int view, int tangIndex) const
+{
+  return mSymmetricLORs[view * mNTangCoords + tangIndex];
+}
+
+void Symmetries::mapPath(
+  int symmetry,
+  const types::PathElement* pathElementsArray,
+  types::PathElement* mappedPathElementsArray) const
+{
+  const auto* pixelPermutation =
+    mSymmetries[symmetry].pixelPermutation.data();
+
+  auto pathIndex = 0;
+  for (; pathElementsArray[pathIndex].coord != -1; pathIndex++)
+  {
+    const auto coord = pathElementsArray[pathIndex].coord;
+    const auto slice = coord / mSliceSize;
+    const auto pixel = coord - slice * mSliceSize;
+
+    mappedPathElementsArray[pathIndex] = {
+      slice * mSliceSize + pixelPermutation[pixel],
+      pathElementsArray[pathIndex].length};
+  }
+
+  mappedPathElementsArray[pathIndex].coord = -1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <VolData.h>
+#include <types.h>
+
+#include <string>
+#include <vector>
+
+// Symmetries of the scanner and volume in XY (rotations by
+// multiples of 90 degrees and mirrors)
+// Paths are traced for a fundamental set of LORs only and
+// mapped to the other LORs by permuting the pixels of each
+// slice
+// LORs are identified in XY by their view and tangential index
+// (tangCoord + tangCoordOffset), all their axial coordinates
+// and segments being mapped together
+class Symmetries
+{
+public:
+
+  // Image of a fundamental LOR by a symmetry
+  struct SymmetricLOR
+  {
+    int view;
+    int tangIndex;
+
+    // True if the crystals of the image are swapped, which
+    // inverts the sign of its segment
+    bool swapped;
+
+    // Index of the symmetry, as used by mapPath
+    int symmetry;
+  };
+
+  // nSubsets: Only symmetries keeping each view in its subset
+  // are used
+  Symmetries(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    int nSubsets = 1);
+
+  void printContent() const;
+
+  // Number of symmetries used (identity excluded)
+  int getNSymmetries() const;
+
+  // Number of LORs traced in XY
+  int getNFundamentalLORs() const;
+
+  // True if the LOR is traced
+  bool isFundamental(int view, int tangIndex) const;
+
+  // True if some LORs of the view are traced
+  bool hasFundamentalLORs(int view) const;
+
+  // Images of a fundamental LOR (LOR itself excluded)
+  const std::vector<SymmetricLOR>& getSymmetricLORs(
+    int view,
+    int tangIndex) const;
+
+  // Map path of a LOR to the path of its image by a symmetry
+  // Both arrays are terminated by an element of coord -1
+  void mapPath(
+    int symmetry,
+    const types::PathElement* pathElementsArray,
+    types::PathElement* mappedPathElementsArray) const;
+
+private:
+
+  struct Symmetry
+  {
+    std::string name;
+
+    // [pixel] Pixel within a slice of the image of the pixel
+    std::vector<types::Index> pixelPermutation;
+
+    // [view * nTangCoords + tangIndex] Image of each LOR
+    // (view * nTangCoords + tangIndex) and its crystal order
+    std::vector<int> images;
+    std::vector<bool> swapped;
+  };
+
+  types::Size mSliceSize;
+
+  // Symmetries used
+  std::vector<Symmetry> mSymmetries;
+
+  int mNTangCoords;
+
+  // [view * nTangCoords + tangIndex]
+  std::vector<bool> mFundamental;
+  std::vector<std::vector<SymmetricLOR>> mSymmetricLORs;
+
+  // [view]
+  std::vector<bool> mHasFundamentalLORs;
+};
@@ -0,0 +1,493 @@
+#include <SystemMatrix.h>
+
+#include <LORCache.h>
+#include <Siddon.h>
+#include <Symmetries.h>
+#include <console.h>
+#include <macros.h>
+#include <tools.h>
+
+#include <fstream>
+#include <optional>
+
+// Identifies system matrix files ("FIRSYSMX")
+constexpr std::uint64_t MAGIC_NUMBER{0x584d535953524946ull};
+
+// Changed whenever the layout of the files changes, so that
+// older files are computed again
+constexpr std::uint64_t FILE_VERSION{2};
+
+constexpr double BYTES_PER_MB{1024.0 * 1024.0};
+
+template<typename T>
+static std::uint64_t hashValue(
+  const T& value,
+  std::uint64_t seed)
+{
+  return hashBytes(&value, sizeof(T), seed);
+}
+
+template<typename T>
+static void writeValue(std::ofstream& os, const T& value)
+{
+  os.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static void readValue(std::ifstream& is, T& value)
+{
+  is.read((char*)&value, sizeof(T));
+}
+
+SystemMatrix::SystemMatrix(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets,
+  double maxMemoryMB,
+  const std::string& fileName,
+  bool symmetric):
+  mProjHeader{proj.getHeader()},
+  mVolHeader{vol.getHeader()},
+  mNSubsets{nSubsets},
+  mSymmetric{symmetric},
+  mSegOffset{proj.getGeometry().segOffset},
+  mNSegments{proj.getHeader().nSegments},
+  mMaxMemoryMB{maxMemoryMB},
+  mMemoryMB{0.0},
+  mComplete{true},
+  mReadFromFile{false}
+{
+  // Check proj data dimensions and number of subsets
+  scanner.checkProjData(proj);
+  proj.checkNSubsets(nSubsets);
+
+  mNViewsPerSubset = proj.getGeometry().nViews / nSubsets;
+
+  if (maxMemoryMB < 0.0)
+  {
+    error("System matrix memory budget must not be negative");
+  }
+
+  mNBinsPerViewForEachSegment.resize(mNSegments);
+  LOOP_SEG(seg, proj)
+  {
+    mNBinsPerViewForEachSegment[seg + mSegOffset] =
+      proj.getGeometry().getNAxialCoords(seg) *
+      proj.getHeader().nTangCoords;
+  }
+
+  // Hash of everything the rows depend on
+  // Note: Fields are hashed one by one to avoid padding bytes
+  const auto pathElementSize = sizeof(types::PathElement);
+  auto hash = hashBytes(&pathElementSize, sizeof(std::size_t));
+  hash = hashValue(FILE_VERSION, hash);
+
+  hash = hashValue(mProjHeader.nRings, hash);
+  hash = hashValue(mProjHeader.nCrystalsPerRing, hash);
+  hash = hashValue(mProjHeader.segmentSpan, hash);
+  hash = hashValue(mProjHeader.nSegments, hash);
+  hash = hashValue(mProjHeader.nTangCoords, hash);
+
+  hash = hashValue(mVolHeader.volSize.nPixelsX, hash);
+  hash = hashValue(mVolHeader.volSize.nPixelsY, hash);
+  hash = hashValue(mVolHeader.volSize.nSlices, hash);
+  hash = hashValue(mVolHeader.voxelExtent.pixelWidth, hash);
+  hash = hashValue(mVolHeader.voxelExtent.pixelHeight, hash);
+  hash = hashValue(mVolHeader.voxelExtent.sliceThickness, hash);
+  hash = hashValue(mVolHeader.volOffset.x, hash);
+  hash = hashValue(mVolHeader.volOffset.y, hash);
+  hash = hashValue(mVolHeader.volOffset.z, hash);
+
+  hash = hashValue(mNSubsets, hash);
+  hash = hashValue(mSymmetric, hash);
+
+  const auto& scannerGeometry = scanner.getGeometry();
+  hash = hashBytes(
+    scanner.getCrystalXYPositionVector(),
+    scannerGeometry.nCrystalsPerRing *
+      sizeof(types::SpatialCoords2D),
+    hash);
+  hash = hashBytes(
+    scanner.getSliceZPositionVector(),
+    scannerGeometry.nSlices * sizeof(types::SpatialCoord),
+    hash);
+
+  mConfigurationHash = hash;
+
+  mBlocks.resize(mNSubsets * mNSegments);
+
+  if (!fileName.empty() && read(fileName))
+  {
+    mReadFromFile = true;
+    return;
+  }
+
+  compute(proj, scanner, vol);
+
+  if (!fileName.empty())
+  {
+    write(fileName);
+  }
+}
+
+void SystemMatrix::checkConfiguration(
+  const ProjData& proj,
+  const VolData& vol,
+  int nSubsets) const
+{
+  if (
+    !(proj.getHeader() == mProjHeader) ||
+    vol.getHeader() != mVolHeader || nSubsets != mNSubsets)
+  {
+    error("System matrix was computed for a different "
+          "configuration");
+  }
+}
+
+void SystemMatrix::printContent() const
+{
+  auto nStoredBlocks = 0;
+  for (const auto& block : mBlocks)
+  {
+    nStoredBlocks += block.stored ? 1 : 0;
+  }
+
+  printValue("System matrix number of subsets", mNSubsets);
+  printValue("System matrix symmetric", mSymmetric);
+  printValue("System matrix blocks stored", nStoredBlocks);
+  printValue("System matrix blocks total", mBlocks.size());
+  printValue("System matrix memory in MB", mMemoryMB);
+  printEmptyLine();
+}
+
+void SystemMatrix::compute(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol)
+{
+  echo("Computing system matrix");
+
+  Siddon siddon(vol);
+  LORCache cache(proj, mNSubsets);
+
+  std::optional<Symmetries> symmetries;
+  if (mSymmetric)
+  {
+    symmetries.emplace(proj, scanner, vol, mNSubsets);
+    symmetries->printContent();
+  }
+
+  const auto nThreads = getNThreads();
+
+  LOOP(subset, 0, mNSubsets - 1)
+  LOOP_SEG(seg, proj)
+  {
+    auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+    const auto nRows = cache.setSubsetAndSegment(subset, seg);
+
+    // Path elements of each thread, one contiguous range of
+    // rows per thread in thread order (static schedule)
+    std::vector<std::vector<types::PathElement>>
+      threadPathElements(nThreads);
+
+    // Number of path elements of each row with terminator
+    std::vector<int> rowLengths(nRows);
+
+#pragma omp parallel
+    {
+      auto& pathElements =
+        threadPathElements[getCurrentThread()];
+
+      auto* threadLocalPathElements =
+        siddon.getThreadLocalPathElements();
+
+#pragma omp for schedule(static)
+      LOOP(index, 0, nRows - 1)
+      {
+        // Leave rows of symmetric LORs empty
+        const auto nBinsPerView = cache.getNBinsPerView(seg);
+        const auto view =
+          index / nBinsPerView * mNSubsets + subset;
+        const auto tangIndex =
+          index % nBinsPerView % proj.getHeader().nTangCoords;
+
+        if (
+          symmetries &&
+          !symmetries->isFundamental(view, tangIndex))
+        {
+          rowLengths[index] = 0;
+          continue;
+        }
+
+        const auto
+          [valid,
+           binIndex,
+           crystalAxialCoord1,
+           crystalAngCoord1,
+           crystalAxialCoord2,
+           crystalAngCoord2] = cache.getLOR(index);
+
+        siddon.computePathBetweenCrystals(
+          scanner,
+          crystalAxialCoord1,
+          crystalAngCoord1,
+          crystalAxialCoord2,
+          crystalAngCoord2,
+          threadLocalPathElements);
+
+        // Copy path with terminator
+        auto pathIndex = 0;
+        while (true)
+        {
+          pathElements.push_back(
+            threadLocalPathElements[pathIndex]);
+
+          if (threadLocalPathElements[pathIndex].coord == -1)
+          {
+            break;
+          }
+
+          pathIndex++;
+        }
+
+        rowLengths[index] = pathIndex + 1;
+      }
+    }
+
+    std::int64_t nPathElements = 0;
+    for (const auto& pathElements : threadPathElements)
+    {
+      nPathElements += pathElements.size();
+    }
+
+    // Stop storing blocks as soon as one exceeds the budget
+    const auto blockMemoryMB =
+      getBlockMemoryMB(nRows, nPathElements);
+    if (
+      mMaxMemoryMB > 0.0 &&
+      mMemoryMB + blockMemoryMB > mMaxMemoryMB)
+    {
+      warning(
+        "System matrix memory budget reached: ",
+        "remaining LORs will be traced on the fly");
+      printEmptyLine();
+      mComplete = false;
+      return;
+    }
+
+    // Concatenate thread results
+    block.pathElements.reserve(nPathElements);
+    for (auto& pathElements : threadPathElements)
+    {
+      block.pathElements.insert(
+        block.pathElements.end(),
+        pathElements.cbegin(),
+        pathElements.cend());
+
+      pathElements.clear();
+      pathElements.shrink_to_fit();
+    }
+
+    block.rowOffsets.resize(nRows + 1);
+    block.rowOffsets[0] = 0;
+    LOOP(index, 0, nRows - 1)
+    {
+      block.rowOffsets[index + 1] =
+        block.rowOffsets[index] + rowLengths[index];
+    }
+
+    block.stored = true;
+    mMemoryMB += blockMemoryMB;
+  }
+}
+
+bool SystemMatrix::read(const std::string& fileName)
+{
+  std::ifstream is(fileName, std::ios::binary);
+  if (!is.is_open())
+  {
+    return false;
+  }
+
+  std::uint64_t magicNumber, configurationHash;
+  readValue(is, magicNumber);
+  readValue(is, configurationHash);
+
+  if (
+    !is || magicNumber != MAGIC_NUMBER ||
+    configurationHash != mConfigurationHash)
+  {
+    warning(
+      "System matrix file \"",
+      fileName,
+      "\" was computed for a different configuration");
+    return false;
+  }
+
+  // Matrix left incomplete by the memory budget of the run
+  // that wrote the file
+  std::uint8_t complete;
+  double fileMaxMemoryMB;
+  readValue(is, complete);
+  readValue(is, fileMaxMemoryMB);
+
+  if (!is)
+  {
+    error("System matrix file \"", fileName, "\" is corrupt");
+  }
+
+  if (
+    !complete &&
+    (mMaxMemoryMB == 0.0 || mMaxMemoryMB > fileMaxMemoryMB))
+  {
+    warning(
+      "System matrix file \"",
+      fileName,
+      "\" was computed with a smaller memory budget");
+    return false;
+  }
+
+  printQuotedValue("Reading system matrix from file", fileName);
+
+  // Read block of the file, false if it ends the stored part
+  const auto readBlock = [&](int subset, int seg)
+  {
+    auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+    std::uint8_t stored;
+    std::int64_t nRows, nPathElements;
+    readValue(is, stored);
+    readValue(is, nRows);
+    readValue(is, nPathElements);
+
+    if (!is)
+    {
+      error("System matrix file \"", fileName, "\" is corrupt");
+    }
+
+    // Blocks not stored in the file end the stored part
+    if (!stored)
+    {
+      return false;
+    }
+
+    if (
+      nRows != (std::int64_t)mNViewsPerSubset *
+          mNBinsPerViewForEachSegment[seg + mSegOffset] ||
+      nPathElements < 0)
+    {
+      error("System matrix file \"", fileName, "\" is corrupt");
+    }
+
+    const auto blockMemoryMB =
+      getBlockMemoryMB(nRows, nPathElements);
+    if (
+      mMaxMemoryMB > 0.0 &&
+      mMemoryMB + blockMemoryMB > mMaxMemoryMB)
+    {
+      warning(
+        "System matrix memory budget reached: ",
+        "remaining LORs will be traced on the fly");
+      return false;
+    }
+
+    block.rowOffsets.resize(nRows + 1);
+    block.pathElements.resize(nPathElements);
+
+    is.read(
+      (char*)block.rowOffsets.data(),
+      (nRows + 1) * sizeof(std::int64_t));
+    is.read(
+      (char*)block.pathElements.data(),
+      nPathElements * sizeof(types::PathElement));
+
+    if (
+      !is || block.rowOffsets[0] != 0 ||
+      block.rowOffsets[nRows] != nPathElements)
+    {
+      error("System matrix file \"", fileName, "\" is corrupt");
+    }
+
+    block.stored = true;
+    mMemoryMB += blockMemoryMB;
+
+    return true;
+  };
+
+  // Blocks after the end of the stored part are left to be
+  // traced on the fly, the stream being no longer aligned
+  // on a block
+  LOOP(subset, 0, mNSubsets - 1)
+  LOOP(seg, -mSegOffset, mSegOffset)
+  {
+    if (!readBlock(subset, seg))
+    {
+      mComplete = false;
+      printEmptyLine();
+
+      return true;
+    }
+  }
+
+  printEmptyLine();
+
+  return true;
+}
+
+void SystemMatrix::write(const std::string& fileName) const
+{
+  std::ofstream os(fileName, std::ios::binary);
+  if (!os.is_open())
+  {
+    error("Couldn't create file ", fileName);
+  }
+
+  printQuotedValue("Saving system matrix to file", fileName);
+  printEmptyLine();
+
+  writeValue(os, MAGIC_NUMBER);
+  writeValue(os, mConfigurationHash);
+  writeValue(os, (std::uint8_t)(mComplete ? 1 : 0));
+  writeValue(os, mMaxMemoryMB);
+
+  for (const auto& block : mBlocks)
+  {
+    const std::uint8_t stored = block.stored ? 1 : 0;
+    const std::int64_t nRows =
+      block.stored ? block.rowOffsets.size() - 1 : 0;
+    const std::int64_t nPathElements =
+      block.pathElements.size();
+
+    writeValue(os, stored);
+    writeValue(os, nRows);
+    writeValue(os, nPathElements);
+
+    if (block.stored)
+    {
+      os.write(
+        (const char*)block.rowOffsets.data(),
+        (nRows + 1) * sizeof(std::int64_t));
+      os.write(
+        (const char*)block.pathElements.data(),
+        nPathElements * sizeof(types::PathElement));
+    }
+  }
+
+  if (!os)
+  {
+    error("Couldn't write system matrix to file ", fileName);
+  }
+}
+
+double SystemMatrix::getBlockMemoryMB(
+  std::int64_t nRows,
+  std::int64_t nPathElements)
+{
+  const auto nBytes =
+    (nRows + 1) * sizeof(std::int64_t) +
+    nPathElements * sizeof(types::PathElement);
+
+  return nBytes / BYTES_PER_MB;
+}
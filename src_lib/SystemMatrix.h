@@ -0,0 +1,144 @@
+#pragma once
+
+#include <ProjData.h>
+#include <ScannerData.h>
+#include <VolData.h>
+#include <types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Precomputed sparse system matrix built with Siddon
+//
+// Rows are stored in CSR style in blocks, one block per subset
+// and segment, in the same order as the LORs of LORCache. The
+// path elements of each row are followed by a terminator
+// (coord == -1) so that a row can be used anywhere a path
+// computed by Siddon is expected.
+//
+// Blocks are stored in order until the memory budget is
+// reached. For the remaining blocks, getRow returns nullptr and
+// the caller has to compute the path with Siddon.
+//
+// A symmetric matrix only stores the rows of the fundamental
+// LORs of the symmetries of the scanner (see Symmetries). The
+// rows of the other LORs are left empty and getRow returns
+// nullptr for them.
+
+class SystemMatrix
+{
+public:
+
+  // If a file name is provided and the file contains a matrix
+  // computed for the same configuration, the matrix is read
+  // from it. Otherwise, the matrix is computed and saved to the
+  // file if a file name is provided.
+  // A file saved with a memory budget is computed again with a
+  // larger budget.
+  // maxMemoryMB: Memory budget in MB (0: No limit)
+  // symmetric: Store the rows of the fundamental LORs only
+  SystemMatrix(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol,
+    int nSubsets,
+    double maxMemoryMB = 0.0,
+    const std::string& fileName = "",
+    bool symmetric = false);
+
+  // Issue error if the matrix was not computed for the same
+  // projection and volume dimensions and number of subsets
+  void checkConfiguration(
+    const ProjData& proj,
+    const VolData& vol,
+    int nSubsets) const;
+
+  // Print matrix info
+  void printContent() const;
+
+  // Get row of LOR at index in LORCache order for a given
+  // subset and segment
+  // Returns nullptr if the row isn't stored
+  inline const types::PathElement* getRow(
+    int subset,
+    int seg,
+    int index) const;
+
+  // Get row of a bin from its segment, its view and its index
+  // within the view (axialCoord * nTangCoords + tangCoord +
+  // tangCoordOffset)
+  // Returns nullptr if the row isn't stored
+  inline const types::PathElement* getBinRow(
+    int seg,
+    int view,
+    int binIndexInView) const;
+
+  // Get matrix information
+  inline int getNSubsets() const;
+  inline bool isSymmetric() const;
+  inline bool wasReadFromFile() const;
+  inline double getMemoryMB() const;
+
+private:
+
+  struct Block
+  {
+    // False if block was left out because of memory budget
+    bool stored{false};
+
+    // [row] Offset of the first path element of each row
+    // (one more element than there are rows)
+    std::vector<std::int64_t> rowOffsets;
+
+    // [element] Path elements of all rows with terminators
+    std::vector<types::PathElement> pathElements;
+  };
+
+  // Trace all rows of all blocks that fit in memory budget
+  void compute(
+    const ProjData& proj,
+    const ScannerData& scanner,
+    const VolData& vol);
+
+  // Returns false if file can't be opened, if it doesn't fit
+  // with the current configuration, or if it was left
+  // incomplete by a smaller memory budget than the current one
+  bool read(const std::string& fileName);
+
+  void write(const std::string& fileName) const;
+
+  // Get memory used by a block in MB
+  static double getBlockMemoryMB(
+    std::int64_t nRows,
+    std::int64_t nPathElements);
+
+  inline int getBlockIndex(int subset, int seg) const;
+
+  // Configuration
+  ProjHeader mProjHeader;
+  VolHeader mVolHeader;
+  int mNSubsets;
+  bool mSymmetric;
+  int mSegOffset;
+  int mNSegments;
+  int mNViewsPerSubset;
+  std::uint64_t mConfigurationHash;
+
+  // [segment] Number of bins per view
+  std::vector<int> mNBinsPerViewForEachSegment;
+
+  // Memory
+  double mMaxMemoryMB;
+  double mMemoryMB;
+
+  // False if blocks were left out because of memory budget
+  bool mComplete;
+
+  bool mReadFromFile;
+
+  // [subset * nSegments + seg + segOffset]
+  std::vector<Block> mBlocks;
+};
+
+#include <SystemMatrix.inl>
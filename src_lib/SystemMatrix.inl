@@ -0,0 +1,61 @@
+#pragma once
+
+#include <SystemMatrix.h>
+
+const types::PathElement* SystemMatrix::getRow(
+  int subset,
+  int seg,
+  int index) const
+{
+  const auto& block = mBlocks[getBlockIndex(subset, seg)];
+
+  // Rows left empty have no terminator
+  if (
+    !block.stored ||
+    block.rowOffsets[index + 1] == block.rowOffsets[index])
+  {
+    return nullptr;
+  }
+
+  return block.pathElements.data() + block.rowOffsets[index];
+}
+
+const types::PathElement* SystemMatrix::getBinRow(
+  int seg,
+  int view,
+  int binIndexInView) const
+{
+  const auto subset = view % mNSubsets;
+  const auto subview = view / mNSubsets;
+
+  const auto index = //
+    subview * mNBinsPerViewForEachSegment[seg + mSegOffset] +
+    binIndexInView;
+
+  return getRow(subset, seg, index);
+}
+
+int SystemMatrix::getNSubsets() const
+{
+  return mNSubsets;
+}
+
+bool SystemMatrix::isSymmetric() const
+{
+  return mSymmetric;
+}
+
+bool SystemMatrix::wasReadFromFile() const
+{
+  return mReadFromFile;
+}
+
+double SystemMatrix::getMemoryMB() const
+{
+  return mMemoryMB;
+}
+
+int SystemMatrix::getBlockIndex(int subset, int seg) const
+{
+  return subset * mNSegments + seg + mSegOffset;
+}
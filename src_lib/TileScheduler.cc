@@ -0,0 +1,70 @@
+#include <TileScheduler.h>
+
+#include <console.h>
+#include <macros.h>
+
+TileScheduler::TileScheduler(
+  const ProjData& proj,
+  const std::vector<int>& nPacketsPerSegment,
+  int tileSize):
+  mTileSize{tileSize > 0 ? tileSize : DEFAULT_TILE_SIZE}
+{
+  const auto segOffset = proj.getGeometry().segOffset;
+
+  LOOP_SEG(seg, proj)
+  {
+    const auto nPackets = nPacketsPerSegment[seg + segOffset];
+
+    for (auto firstPacket = 0; firstPacket < nPackets;
+         firstPacket += mTileSize)
+    {
+      const auto nPacketsInTile =
+        MIN(mTileSize, nPackets - firstPacket);
+      mTiles.push_back({seg, firstPacket, nPacketsInTile});
+    }
+  }
+}
+
+// Number of packets of consecutive LORs of the list of a
+// subset for each segment
+static std::vector<int> getNPacketsPerSegment(
+  const ProjData& proj,
+  const LORList& lorList,
+  int subset,
+  int packetSize)
+{
+  std::vector<int> nPacketsPerSegment;
+  LOOP_SEG(seg, proj)
+  {
+    const auto nLORs = lorList.getNLORs(subset, seg);
+    nPacketsPerSegment.push_back(
+      (nLORs + packetSize - 1) / packetSize);
+  }
+
+  return nPacketsPerSegment;
+}
+
+TileScheduler::TileScheduler(
+  const ProjData& proj,
+  const LORList& lorList,
+  int subset,
+  int packetSize,
+  int tileSize):
+  TileScheduler(
+    proj,
+    getNPacketsPerSegment(proj, lorList, subset, packetSize),
+    tileSize)
+{
+}
+
+void TileScheduler::printContent() const
+{
+  printValue("Number of packets per tile", mTileSize);
+  printValue("Number of tiles", getNTiles());
+  printEmptyLine();
+}
+
+int TileScheduler::getNTiles() const
+{
+  return mTiles.size();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <LORList.h>
+#include <ProjData.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Schedule of the packets of LORs of all segments in a single
+// parallel region, with work stealing
+//
+// The packets of each segment are grouped in tiles of
+// consecutive packets. Each thread starts with a contiguous
+// range of tiles, taken from its front, and steals tiles from
+// the back of the ranges of the other threads once its own is
+// empty. Segments of different sizes and LORs of different
+// path lengths are balanced without a barrier per segment.
+
+class TileScheduler
+{
+public:
+
+  // Number of packets per tile by default
+  static constexpr int DEFAULT_TILE_SIZE{16};
+
+  // Consecutive packets of a segment
+  struct Tile
+  {
+    int seg;
+    int firstPacket;
+    int nPackets;
+  };
+
+  // nPacketsPerSegment: [seg + segOffset] Number of packets of
+  // each segment
+  // tileSize: Number of packets per tile (0: Default)
+  TileScheduler(
+    const ProjData& proj,
+    const std::vector<int>& nPacketsPerSegment,
+    int tileSize = 0);
+
+  // Packets of consecutive LORs of the list of a subset
+  TileScheduler(
+    const ProjData& proj,
+    const LORList& lorList,
+    int subset,
+    int packetSize,
+    int tileSize = 0);
+
+  void printContent() const;
+
+  int getNTiles() const;
+
+  // Call function(seg, packetIndex) for each packet of each
+  // segment, in a parallel region
+  template<typename Function>
+  void run(Function&& function) const;
+
+private:
+
+  // Tiles left to a thread, first and end tiles packed in 64
+  // bits so that both ends are updated atomically
+  struct alignas(64) TileRange
+  {
+    std::atomic<std::uint64_t> bounds;
+  };
+
+  // Take the first tile of a range (owner)
+  // Returns false if the range is empty
+  static inline bool takeFront(TileRange& range, int& tile);
+
+  // Take the last tile of a range (thieves)
+  // Returns false if the range is empty
+  static inline bool takeBack(TileRange& range, int& tile);
+
+  int mTileSize;
+  std::vector<Tile> mTiles;
+};
+
+#include <TileScheduler.inl>
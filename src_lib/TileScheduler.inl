@@ -0,0 +1,112 @@
+#pragma once
+
+#include <TileScheduler.h>
+#include <macros.h>
+#include <tools.h>
+
+#include <memory>
+
+bool TileScheduler::takeFront(TileRange& range, int& tile)
+{
+  auto bounds = range.bounds.load();
+
+  while (true)
+  {
+    const auto first = (std::uint32_t)(bounds >> 32);
+    const auto end = (std::uint32_t)bounds;
+
+    if (first >= end)
+    {
+      return false;
+    }
+
+    const auto newBounds =
+      ((std::uint64_t)(first + 1) << 32) | end;
+    if (range.bounds.compare_exchange_weak(bounds, newBounds))
+    {
+      tile = first;
+      return true;
+    }
+  }
+}
+
+bool TileScheduler::takeBack(TileRange& range, int& tile)
+{
+  auto bounds = range.bounds.load();
+
+  while (true)
+  {
+    const auto first = (std::uint32_t)(bounds >> 32);
+    const auto end = (std::uint32_t)bounds;
+
+    if (first >= end)
+    {
+      return false;
+    }
+
+    const auto newBounds =
+      ((std::uint64_t)first << 32) | (end - 1);
+    if (range.bounds.compare_exchange_weak(bounds, newBounds))
+    {
+      tile = end - 1;
+      return true;
+    }
+  }
+}
+
+template<typename Function>
+void TileScheduler::run(Function&& function) const
+{
+  const auto nThreads = getNThreads();
+  const auto nTiles = (int)mTiles.size();
+
+  // Contiguous ranges of tiles of each thread
+  std::unique_ptr<TileRange[]> ranges(new TileRange[nThreads]);
+  LOOP(thread, 0, nThreads - 1)
+  {
+    const std::uint64_t first =
+      (std::uint64_t)thread * nTiles / nThreads;
+    const std::uint64_t end =
+      (std::uint64_t)(thread + 1) * nTiles / nThreads;
+
+    ranges[thread].bounds = (first << 32) | end;
+  }
+
+#pragma omp parallel
+  {
+    const auto thread = getCurrentThread();
+
+    int tile;
+    while (true)
+    {
+      // Own tiles first, then tiles stolen from the next
+      // threads
+      auto found = takeFront(ranges[thread], tile);
+      LOOP(victimOffset, 1, nThreads - 1)
+      {
+        if (found)
+        {
+          break;
+        }
+
+        found = takeBack(
+          ranges[(thread + victimOffset) % nThreads],
+          tile);
+      }
+
+      if (!found)
+      {
+        break;
+      }
+
+      const auto& currentTile = mTiles[tile];
+      LOOP(
+        packetIndex,
+        currentTile.firstPacket,
+        currentTile.firstPacket + currentTile.nPackets - 1)
+      {
+        function(currentTile.seg, packetIndex);
+      }
+    }
+  }
+}
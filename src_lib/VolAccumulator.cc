@@ -0,0 +1,129 @@
+#include <VolAccumulator.h>
+
+#include <console.h>
+#include <macros.h>
+
+// Number of voxels summed by a thread at once during
+// reduction, within the L1 cache
+constexpr types::Size REDUCTION_BLOCK_SIZE{2048};
+
+VolAccumulator::VolAccumulator(
+  VolData& vol,
+  projections::Accumulation accumulation,
+  double maxMemoryMB):
+  mVol{vol},
+  mNVoxels{vol.getNVoxelsPerFrame()},
+  mNPartialVols{0},
+  mAtomic{accumulation != projections::Accumulation::SCHEDULED}
+{
+  if (accumulation != projections::Accumulation::PRIVATE)
+  {
+    return;
+  }
+
+  mNPartialVols = getNThreads();
+
+  const auto partialVolMemoryMB =
+    mNVoxels * sizeof(types::VoxelValue) / (1024.0 * 1024.0);
+
+  if (maxMemoryMB > 0.0)
+  {
+    mNPartialVols = MIN(
+      mNPartialVols,
+      static_cast<int>(maxMemoryMB / partialVolMemoryMB));
+  }
+
+  if (mNPartialVols == 0)
+  {
+    warning(
+      "Memory budget too small for partial volumes, ",
+      "using atomic accumulation");
+    return;
+  }
+
+  const auto nPartialVoxels =
+    static_cast<std::size_t>(mNPartialVols) * mNVoxels;
+  mPartialVols.reset(new types::VoxelValue[nPartialVoxels]);
+  mUpdated.reset(new char[mNPartialVols]());
+
+  // First touch of each partial volume by its thread
+#pragma omp parallel
+  {
+    const auto thread = getCurrentThread();
+
+    if (thread < mNPartialVols)
+    {
+      auto* partialVol =
+        mPartialVols.get() + (std::size_t)thread * mNVoxels;
+
+      LOOP(voxel, 0, mNVoxels - 1)
+      {
+        partialVol[voxel] = 0.0;
+      }
+    }
+  }
+}
+
+void VolAccumulator::printContent() const
+{
+  printValue("Number of partial volumes", mNPartialVols);
+  printValue(
+    "Memory of partial volumes (MB)",
+    (std::size_t)mNPartialVols * mNVoxels *
+      sizeof(types::VoxelValue) / (1024.0 * 1024.0));
+  printEmptyLine();
+}
+
+int VolAccumulator::getNPartialVols() const
+{
+  return mNPartialVols;
+}
+
+void VolAccumulator::reduce()
+{
+  // Partial volumes updated since the last reduction
+  std::vector<types::VoxelValue*> partialVols;
+  LOOP(thread, 0, mNPartialVols - 1)
+  {
+    if (mUpdated[thread])
+    {
+      partialVols.push_back(
+        mPartialVols.get() + (std::size_t)thread * mNVoxels);
+      mUpdated[thread] = 0;
+    }
+  }
+
+  if (partialVols.empty())
+  {
+    return;
+  }
+
+  auto* dataArray = mVol.getDataArray();
+
+  const auto nBlocks =
+    (mNVoxels + REDUCTION_BLOCK_SIZE - 1) /
+    REDUCTION_BLOCK_SIZE;
+
+  // Blocks of voxels summed over all partial volumes
+#pragma omp parallel for
+  LOOP(block, 0, nBlocks - 1)
+  {
+    const auto firstVoxel = block * REDUCTION_BLOCK_SIZE;
+    const auto nVoxelsInBlock =
+      MIN(REDUCTION_BLOCK_SIZE, mNVoxels - firstVoxel);
+
+    auto* blockDataArray = dataArray + firstVoxel;
+
+    for (auto* partialVol : partialVols)
+    {
+      auto* blockPartialVol = partialVol + firstVoxel;
+
+#pragma omp simd
+      LOOP(voxel, 0, nVoxelsInBlock - 1)
+      {
+        blockDataArray[voxel] += blockPartialVol[voxel];
+        blockPartialVol[voxel] = 0.0;
+      }
+    }
+  }
+}
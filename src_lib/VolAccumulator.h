@@ -0,0 +1,76 @@
+#pragma once
+
+#include <VolData.h>
+#include <projections.h>
+#include <types.h>
+
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// Accumulation of back projections into the active frame of a
+// volume by the threads of parallel regions
+//
+// With private accumulation, the threads within the memory
+// budget each update a partial volume of their own without
+// atomics (allocated and zeroed by the thread, so that it
+// stays close to it). reduce sums the partial volumes into the
+// active frame of the volume. The other threads update the
+// volume with atomics, as with atomic accumulation.
+//
+// With scheduled accumulation, all threads update the volume
+// without atomics: The caller ensures that they don't update
+// the same voxels at the same time (see SlabSchedule).
+
+class VolAccumulator
+{
+public:
+
+  // maxMemoryMB: Memory budget of the partial volumes in MB
+  // (0: One partial volume per thread)
+  VolAccumulator(
+    VolData& vol,
+    projections::Accumulation accumulation,
+    double maxMemoryMB = 0.0);
+
+  void printContent() const;
+
+  // Number of threads with a partial volume
+  int getNPartialVols() const;
+
+  // Get the data array updated by the current thread, and true
+  // if its updates must be atomic
+  inline std::tuple<types::VoxelValue*, bool>
+  getThreadDataArray();
+
+  // Same as VolData::projectLineIntegral for the current thread
+  inline void projectLineIntegral(
+    const types::PathElement* pathElementsArray,
+    types::VoxelValue line,
+    types::Index coordOffset = 0);
+
+  // Add the partial volumes to the active frame of the volume
+  // and reset them
+  // Call outside of parallel regions, before changing the
+  // active frame of the volume
+  void reduce();
+
+private:
+
+  VolData& mVol;
+  types::Size mNVoxels;
+  int mNPartialVols;
+
+  // True if the updates of the volume must be atomic
+  bool mAtomic;
+
+  // [thread * nVoxels + voxel]
+  std::unique_ptr<types::VoxelValue[]> mPartialVols;
+
+  // [thread] Non-zero if the partial volume was updated since
+  // the last reduction
+  // Note: Not a vector<bool>, written by several threads
+  std::unique_ptr<char[]> mUpdated;
+};
+
+#include <VolAccumulator.inl>
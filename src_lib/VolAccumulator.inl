@@ -0,0 +1,51 @@
+#pragma once
+
+#include <VolAccumulator.h>
+#include <tools.h>
+
+std::tuple<types::VoxelValue*, bool>
+VolAccumulator::getThreadDataArray()
+{
+  const auto thread = getCurrentThread();
+
+  if (thread >= mNPartialVols)
+  {
+    return {mVol.getDataArray(), mAtomic};
+  }
+
+  if (!mUpdated[thread])
+  {
+    mUpdated[thread] = 1;
+  }
+
+  return {
+    mPartialVols.get() + (std::size_t)thread * mNVoxels,
+    false};
+}
+
+void VolAccumulator::projectLineIntegral(
+  const types::PathElement* pathElementsArray,
+  types::VoxelValue line,
+  types::Index coordOffset)
+{
+  const auto [threadDataArray, atomic] = getThreadDataArray();
+
+  if (atomic)
+  {
+    mVol.projectLineIntegral(
+      pathElementsArray,
+      line,
+      coordOffset);
+    return;
+  }
+
+  auto* dataArray = threadDataArray + coordOffset;
+
+  for (auto pathIndex = 0;
+       pathElementsArray[pathIndex].coord != -1;
+       pathIndex++)
+  {
+    dataArray[pathElementsArray[pathIndex].coord] +=
+      pathElementsArray[pathIndex].length * line;
+  }
+}
@@ -59,6 +59,29 @@ void VolData::read(
   mHeader = reader.getHeader();
   mGeometry = reader.getGeometry();
 
+  // Frames used in place in the data file if they are stored
+  // as in memory (see MappedFile), allocated otherwise
+  if (
+    mode == ConstructionMode::READ_DATA ||
+    (mode == ConstructionMode::READ_DATA_IF_PROVIDED &&
+     hasDataFile))
+  {
+    mMappedFile = reader.mapData();
+  }
+
+  if (mMappedFile != nullptr)
+  {
+    mDataArray = (types::VoxelValue*)mMappedFile->getData();
+
+    mFrameVector.resize(mHeader.nFrames);
+    LOOP(frame, 0, mHeader.nFrames - 1)
+    {
+      mFrameVector[frame] =
+        mDataArray + frame * mGeometry.nVoxelsPerFrame;
+    }
+    return;
+  }
+
   allocate();
 
   switch (mode)
@@ -355,8 +378,11 @@ void VolData::setActiveFrame(int frame) const
 }
 
 types::VoxelValue VolData::computeLineIntegral(
-  types::PathElement* pathElementsArray) const
+  const types::PathElement* pathElementsArray,
+  types::Index coordOffset) const
 {
+  const auto* dataArray = mDataArray + coordOffset;
+
   types::VoxelValue line{0.0};
 
   for (auto pathIndex = 0;
@@ -364,22 +390,25 @@ types::VoxelValue VolData::computeLineIntegral(
        pathIndex++)
   {
     line += pathElementsArray[pathIndex].length *
-      mDataArray[pathElementsArray[pathIndex].coord];
+      dataArray[pathElementsArray[pathIndex].coord];
   }
 
   return line;
 }
 
 void VolData::projectLineIntegral(
-  types::PathElement* pathElementsArray,
-  types::VoxelValue line)
+  const types::PathElement* pathElementsArray,
+  types::VoxelValue line,
+  types::Index coordOffset)
 {
+  auto* dataArray = mDataArray + coordOffset;
+
   for (auto pathIndex = 0;
        pathElementsArray[pathIndex].coord != -1;
        pathIndex++)
   {
 #pragma omp atomic
-    mDataArray[pathElementsArray[pathIndex].coord] +=
+    dataArray[pathElementsArray[pathIndex].coord] +=
       pathElementsArray[pathIndex].length * line;
   }
 }
@@ -419,7 +448,12 @@ void VolData::allocate(
 
 void VolData::deallocate()
 {
-  if (mFrameVector.size() > 0)
+  if (mMappedFile != nullptr)
+  {
+    mFrameVector.clear();
+    mMappedFile.reset();
+  }
+  else if (mFrameVector.size() > 0)
   {
     std::free(mFrameVector[0]);
     mFrameVector.clear();
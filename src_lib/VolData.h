@@ -1,8 +1,10 @@
 #pragma once
 
+#include <MappedFile.h>
 #include <VolHeader.h>
 #include <types.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -105,11 +107,15 @@ public:
   inline int getActiveFrame() const;
 
   // Line integrals (TODO: Relocate?)
+  // coordOffset: Shift applied to the voxel index of each path
+  // element
   types::VoxelValue computeLineIntegral(
-    types::PathElement* pathElementsArray) const;
+    const types::PathElement* pathElementsArray,
+    types::Index coordOffset = 0) const;
   void projectLineIntegral(
-    types::PathElement* pathElementsArray,
-    types::VoxelValue line);
+    const types::PathElement* pathElementsArray,
+    types::VoxelValue line,
+    types::Index coordOffset = 0);
 
   // Get volume information
   inline const VolHeader& getHeader() const;
@@ -154,6 +160,10 @@ private:
   // Note: Frames are contiguous in memory. Therefore, the
   // pointer mFrameVector[0] points to an array containing all
   // voxels of all frames.
+
+  // Data file whose pages hold the frames, when they are used
+  // in place instead of being allocated
+  std::shared_ptr<MappedFile> mMappedFile;
 };
 
 #include <VolData.inl>
@@ -19,6 +19,10 @@ struct VolHeader
   // Number of frames
   int nFrames; // Defaults to 1
 
+  // Constructors (copy declared along with operator=)
+  VolHeader() = default;
+  VolHeader(const VolHeader& rhs) = default;
+
   // Operators
   inline bool operator==(const VolHeader& rhs) const;
   inline bool operator!=(const VolHeader& rhs) const;
@@ -43,6 +47,10 @@ struct VolGeometry
   int nVoxelsPerFrame;
   int nVoxelsTotal;
 
+  // Constructors (copy declared along with operator=)
+  VolGeometry() = default;
+  VolGeometry(const VolGeometry& rhs) = default;
+
   // Operators
   inline VolGeometry& operator=(const VolGeometry& rhs);
 
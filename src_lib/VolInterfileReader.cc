@@ -10,6 +10,7 @@
 #include <filesystem>
 #include <fstream>
 #include <optional>
+#include <type_traits>
 
 namespace
 {
@@ -380,6 +381,40 @@ void VolInterfileReader::readData(
   }
 }
 
+std::shared_ptr<MappedFile> VolInterfileReader::mapData()
+{
+  const auto nativeByteOrder = systemIsLittleEndian() ?
+    DataByteOrderEnum::LITTLEENDIAN :
+    DataByteOrderEnum::BIGENDIAN;
+
+  const auto isNativeFloat =
+    std::is_same_v<types::VoxelValue, float> &&
+    mParams.dataType == DataTypeEnum::FLOAT &&
+    mParams.bytesPerPixel == 4 &&
+    mParams.dataByteOrder == nativeByteOrder;
+
+  // Voxels must also be aligned in memory
+  if (
+    !hasDataFile() || !isNativeFloat ||
+    mParams.dataOffset % sizeof(types::VoxelValue) != 0)
+  {
+    return nullptr;
+  }
+
+  auto mappedFile = std::make_shared<MappedFile>(
+    mParams.dataFileName,
+    mParams.dataOffset,
+    (std::size_t)mGeometry.nVoxelsTotal *
+      sizeof(types::VoxelValue));
+
+  if (!mappedFile->isMapped())
+  {
+    return nullptr;
+  }
+
+  return mappedFile;
+}
+
 template<typename VoxT>
 static void writeVolInterfileDataTemplate(
   const std::vector<types::VoxelValue*>& frameVector,
@@ -388,6 +423,10 @@ static void writeVolInterfileDataTemplate(
   int nVoxelsPerFrame,
   int nFrames)
 {
+  // Previous file removed rather than rewritten, in case it is
+  // mapped (see MappedFile)
+  std::filesystem::remove(outputVolDataFile);
+
   // Open data file
   std::ofstream stream;
   stream.open(outputVolDataFile);
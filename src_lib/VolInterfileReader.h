@@ -1,8 +1,10 @@
 #pragma once
 
+#include <MappedFile.h>
 #include <VolData.h>
 #include <types.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -67,6 +69,11 @@ public:
   // Read the data file pointed to by the header file
   void readData(std::vector<types::VoxelValue*>& frameVector);
 
+  // Map the voxels of the data file, frames one after the
+  // other, if they are stored as in memory (nullptr if they
+  // need a conversion, to be read with readData)
+  std::shared_ptr<MappedFile> mapData();
+
   // Static method to write a volume to file
   static void writeVolInterfile(
     const std::string& outputVolFile,
@@ -1,10 +1,12 @@
 #include <operations.h>
 
+#include <GaussianFilter.h>
 #include <console.h>
 #include <macros.h>
 
+#include <algorithm>
 #include <cmath>
-#include <cstdlib>
+#include <cstddef>
 
 namespace operations
 {
@@ -12,209 +14,183 @@ void convolve(
   VolData& vol,
   std::vector<float> fwhmXYZ,
   float cutRadius)
+{
+  GaussianFilter filter(vol, fwhmXYZ, cutRadius);
+  filter.apply(vol);
+}
+
+void cutCircle(VolData& vol, float cutRadius)
+{
+  if (cutRadius > 0.0)
+  {
+    cutCircle(vol, getCircleRows(vol, cutRadius));
+  }
+}
+
+CircleRows getCircleRows(const VolData& vol, float cutRadius)
 {
   const auto& header = vol.getHeader();
+  const auto& volExtent = vol.getVolExtent();
+  const auto nPixelsX = header.volSize.nPixelsX;
+
+  CircleRows circleRows(
+    header.volSize.nPixelsY,
+    {0, nPixelsX});
 
-  if (fwhmXYZ[0] > 0.0 && fwhmXYZ[1] > 0.0 && fwhmXYZ[2] > 0.0)
+  if (cutRadius <= 0.0)
   {
-    // Initialize auxiliary volumes
-
-    VolData copyVol;
-    copyVol.allocateSingleFrameFromMultiVol(vol);
-
-    VolData image1;
-    image1.allocateSingleFrameFromMultiVol(vol);
-
-    VolData image2;
-    image2.allocateSingleFrameFromMultiVol(vol);
-
-    // Initialize kernel in X
-    const auto sigmaX = fwhmXYZ[0] / 2.3548f;
-    const auto halfKernelSizeX =
-      (static_cast<int>(
-         6.0 * sigmaX / header.voxelExtent.pixelWidth) +
-       1) /
-      2;
-    auto* kernelX = (float*)std::malloc(
-      (2 * halfKernelSizeX + 1) * sizeof(float));
-    LOOP(ki, -halfKernelSizeX, halfKernelSizeX)
-    {
-      kernelX[halfKernelSizeX + ki] = std::exp(
-        -(ki * ki * header.voxelExtent.pixelWidth *
-          header.voxelExtent.pixelWidth) /
-        (2 * sigmaX * sigmaX));
-    }
-    // Initialize kernel in Y
-    const auto sigmaY = fwhmXYZ[1] / 2.3548f;
-    const auto halfKernelSizeY =
-      (static_cast<int>(
-         6.0 * sigmaY / header.voxelExtent.pixelHeight) +
-       1) /
-      2;
-    auto* kernelY = (float*)std::malloc(
-      (2 * halfKernelSizeY + 1) * sizeof(float));
-    LOOP(ki, -halfKernelSizeY, halfKernelSizeY)
-    kernelY[halfKernelSizeY + ki] = std::exp(
-      -(ki * ki * header.voxelExtent.pixelHeight *
-        header.voxelExtent.pixelHeight) /
-      (2 * sigmaY * sigmaY));
-
-    // Initialize kernel in Z
-    const auto sigmaZ = fwhmXYZ[2] / 2.3548;
-    const auto halfKernelSizeZ =
-      (static_cast<int>(
-         6.0 * sigmaZ / header.voxelExtent.sliceThickness) +
-       1) /
-      2;
-    auto* kernelZ = (float*)std::malloc(
-      (2 * halfKernelSizeZ + 1) * sizeof(float));
-    LOOP(ki, -halfKernelSizeZ, halfKernelSizeZ)
-    kernelZ[ki + halfKernelSizeZ] = std::exp(
-      -(ki * ki * header.voxelExtent.sliceThickness *
-        header.voxelExtent.sliceThickness) /
-      (2 * sigmaZ * sigmaZ));
-
-    // Loop over frames
-    LOOP(frame, 0, header.nFrames - 1)
+    return circleRows;
+  }
+
+  // Voxels kept form a single range per row (empty: first
+  // index not lower than end index)
+  LOOP(j, 0, header.volSize.nPixelsY - 1)
+  {
+    auto& [firstX, endX] = circleRows[j];
+    firstX = nPixelsX;
+    endX = 0;
+
+    LOOP(i, 0, nPixelsX - 1)
     {
-      vol.setActiveFrame(frame);
-      copyVol.assignFrame(vol, frame);
+      const auto px = i * header.voxelExtent.pixelWidth +
+        header.voxelExtent.pixelWidth / 2.0 -
+        volExtent.sliceWidth / 2.0;
 
-      // Apply kernel in X
-#pragma omp parallel for
-      LOOP(k, 0, header.volSize.nSlices - 1)
-      LOOP(j, 0, header.volSize.nPixelsY - 1)
-      LOOP(i, 0, header.volSize.nPixelsX - 1)
-      {
-        float sum{0.0};
-        float norm{0.0};
-
-        LOOP(ki, -halfKernelSizeX, halfKernelSizeX)
-        {
-          if (i + ki >= 0 && i + ki < header.volSize.nPixelsX)
-          {
-            const auto kv = kernelX[halfKernelSizeX + ki];
-            sum += kv * vol.getVoxel(i + ki, j, k);
-            norm += kv;
-          }
-        }
-
-        if (norm > 0.0)
-        {
-          image1.setVoxel(i, j, k, sum / norm);
-        }
-      }
+      const auto py = j * header.voxelExtent.pixelHeight +
+        header.voxelExtent.pixelHeight / 2.0 -
+        volExtent.sliceHeight / 2.0;
 
-      // Apply kernel in Y
-#pragma omp parallel for
-      LOOP(k, 0, header.volSize.nSlices - 1)
-      LOOP(j, 0, header.volSize.nPixelsY - 1)
-      LOOP(i, 0, header.volSize.nPixelsX - 1)
+      if (std::sqrt(px * px + py * py) <= cutRadius)
       {
-        float sum{0.0};
-        float norm{0.0};
-
-        LOOP(ki, -halfKernelSizeY, halfKernelSizeY)
-        {
-          if (j + ki >= 0 && j + ki < header.volSize.nPixelsY)
-          {
-            const auto kv = kernelY[halfKernelSizeY + ki];
-            sum += kv * image1.getVoxel(i, j + ki, k);
-            norm += kv;
-          }
-        }
-
-        if (norm > 0.0)
-        {
-          image2.setVoxel(i, j, k, sum / norm);
-        }
+        firstX = MIN(firstX, i);
+        endX = i + 1;
       }
+    }
+  }
+
+  return circleRows;
+}
+
+void cutCircle(VolData& vol, const CircleRows& circleRows)
+{
+  const auto& volSize = vol.getHeader().volSize;
+  auto* dataArray = vol.getDataArray();
 
-      // Apply kernel in Z
 #pragma omp parallel for
-      LOOP(k, 0, header.volSize.nSlices - 1)
-      LOOP(j, 0, header.volSize.nPixelsY - 1)
-      LOOP(i, 0, header.volSize.nPixelsX - 1)
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  {
+    const auto [firstX, endX] = circleRows[j];
+    const auto rowOffset =
+      ((std::size_t)k * volSize.nPixelsY + j) *
+      volSize.nPixelsX;
+    auto* row = dataArray + rowOffset;
+
+    LOOP(i, 0, volSize.nPixelsX - 1)
+    {
+      if (i < firstX || i >= endX)
       {
-        float sum{0.0};
-        float norm{0.0};
-
-        LOOP(ki, -halfKernelSizeZ, halfKernelSizeZ)
-        {
-          if (k + ki >= 0 && k + ki < header.volSize.nSlices)
-          {
-            const auto kv = kernelZ[halfKernelSizeZ + ki];
-            sum += kv * image2.getVoxel(i, j, k + ki);
-            norm += kv;
-          }
-        }
-
-        if (norm > 0.0)
-        {
-          vol.setVoxel(i, j, k, sum / norm);
-        }
+        row[i] = 0.0;
       }
+    }
+  }
+}
 
-      // Set voxels outside cylindrical fov with original
-      // values to suppress artifacts
-      if (cutRadius > 0.0)
-      {
-        const auto fwhm = MAX(fwhmXYZ[0], fwhmXYZ[1]);
-        const auto& volExtent = vol.getVolExtent();
+void updateOSEM(
+  VolData& vol,
+  VolData& backProj,
+  const VolData& sensVol,
+  const CircleRows& circleRows)
+{
+  const auto& volSize = vol.getHeader().volSize;
+  auto* dataArray = vol.getDataArray();
+  auto* backProjDataArray = backProj.getDataArray();
+  const auto* sensDataArray = sensVol.getDataArray();
 
 #pragma omp parallel for
-        LOOP(k, 0, header.volSize.nSlices - 1)
-        LOOP(j, 0, header.volSize.nPixelsY - 1)
-        LOOP(i, 0, header.volSize.nPixelsX - 1)
-        {
-          const auto px = i * header.voxelExtent.pixelWidth +
-            header.voxelExtent.pixelWidth / 2.0 -
-            volExtent.sliceWidth / 2.0;
-
-          const auto py = j * header.voxelExtent.pixelHeight +
-            header.voxelExtent.pixelHeight / 2.0 -
-            volExtent.sliceHeight / 2.0;
-
-          if (
-            std::sqrt(px * px + py * py) >=
-            cutRadius - 5.0 * fwhm)
-          {
-            vol.setVoxel(i, j, k, copyVol.getVoxel(i, j, k));
-          }
-        }
-      }
-    }
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  {
+    const auto [firstX, endX] = circleRows[j];
+    const auto rowOffset =
+      ((std::size_t)k * volSize.nPixelsY + j) *
+      volSize.nPixelsX;
+
+    auto* row = dataArray + rowOffset;
+    auto* backProjRow = backProjDataArray + rowOffset;
+    const auto* sensRow = sensDataArray + rowOffset;
+
+    // Same operations as backProj /= sensVol and
+    // vol *= backProj
+#pragma omp simd
+    LOOP(i, 0, volSize.nPixelsX - 1)
+    {
+      const types::VoxelValue ratio =
+        backProjRow[i] > EPSILON && sensRow[i] > EPSILON ?
+        backProjRow[i] / sensRow[i] :
+        0.0;
 
-    std::free(kernelX);
-    std::free(kernelY);
-    std::free(kernelZ);
+      const auto inside = i >= firstX && i < endX;
+
+      row[i] = inside && row[i] > EPSILON && ratio > EPSILON ?
+        row[i] * ratio :
+        0.0;
+      backProjRow[i] = 0.0;
+    }
   }
 }
 
-void cutCircle(VolData& vol, float cutRadius)
+void updateOSEM_ResoReco(
+  VolData& vol,
+  VolData& backProj,
+  const VolData& sensVol,
+  const CircleRows& circleRows,
+  VolData* blurVol)
 {
-  const auto& header = vol.getHeader();
-  const auto& volExtent = vol.getVolExtent();
+  const auto& volSize = vol.getHeader().volSize;
+  auto* dataArray = vol.getDataArray();
+  auto* backProjDataArray = backProj.getDataArray();
+  const auto* sensDataArray = sensVol.getDataArray();
+  auto* blurDataArray =
+    blurVol != nullptr ? blurVol->getDataArray() : nullptr;
 
-  if (cutRadius > 0.0)
-  {
 #pragma omp parallel for
-    LOOP(k, 0, header.volSize.nSlices - 1)
-    LOOP(j, 0, header.volSize.nPixelsY - 1)
-    LOOP(i, 0, header.volSize.nPixelsX - 1)
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  {
+    const auto [firstX, endX] = circleRows[j];
+    const auto rowOffset =
+      ((std::size_t)k * volSize.nPixelsY + j) *
+      volSize.nPixelsX;
+
+    auto* row = dataArray + rowOffset;
+    auto* backProjRow = backProjDataArray + rowOffset;
+    const auto* sensRow = sensDataArray + rowOffset;
+
+    // Same operations as vol /= sensVol and vol *= backProj
+#pragma omp simd
+    LOOP(i, 0, volSize.nPixelsX - 1)
     {
-      const auto px = i * header.voxelExtent.pixelWidth +
-        header.voxelExtent.pixelWidth / 2.0 -
-        volExtent.sliceWidth / 2.0;
-
-      const auto py = j * header.voxelExtent.pixelHeight +
-        header.voxelExtent.pixelHeight / 2.0 -
-        volExtent.sliceHeight / 2.0;
+      const types::VoxelValue ratio =
+        row[i] > EPSILON && sensRow[i] > EPSILON ?
+        row[i] / sensRow[i] :
+        0.0;
+
+      const auto inside = i >= firstX && i < endX;
+
+      row[i] =
+        inside && ratio > EPSILON && backProjRow[i] > EPSILON ?
+        ratio * backProjRow[i] :
+        0.0;
+      backProjRow[i] = 0.0;
+    }
 
-      if (std::sqrt(px * px + py * py) > cutRadius)
-      {
-        vol.setVoxel(i, j, k, 0.0);
-      }
+    if (blurDataArray != nullptr)
+    {
+      std::copy(
+        row,
+        row + volSize.nPixelsX,
+        blurDataArray + rowOffset);
     }
   }
 }
@@ -1,9 +1,12 @@
 #include <VolData.h>
 
+#include <utility>
 #include <vector>
 
 namespace operations
 {
+// Gaussian filter (see GaussianFilter, which keeps its kernels
+// and workspaces for repeated filtering)
 void convolve(
   VolData& vol,
   std::vector<float> fwhmXYZ,
@@ -14,6 +17,35 @@ void cutCircle(
   VolData& vol,
   float cutRadius = 0.0); // 0: No cut
 
+// [j] First and end X indices of the voxels of row j of each
+// slice kept by cutCircle
+using CircleRows = std::vector<std::pair<int, int>>;
+
+CircleRows getCircleRows(
+  const VolData& vol,
+  float cutRadius = 0.0); // 0: No cut
+
+// Same as cutCircle with the rows of getCircleRows
+void cutCircle(VolData& vol, const CircleRows& circleRows);
+
+// Update of an OSEM sub-iteration in a single pass over the
+// voxels: vol *= backProj / sensVol, voxels outside circleRows
+// set to zero and backProj reset to zero
+void updateOSEM(
+  VolData& vol,
+  VolData& backProj,
+  const VolData& sensVol,
+  const CircleRows& circleRows);
+
+// Same for OSEM_ResoReco: vol /= sensVol, then vol *= backProj,
+// vol being also copied to blurVol if provided
+void updateOSEM_ResoReco(
+  VolData& vol,
+  VolData& backProj,
+  const VolData& sensVol,
+  const CircleRows& circleRows,
+  VolData* blurVol = nullptr);
+
 // Apply mask: Volume maskVol of the same size.
 // Keep voxels for which maskVol > 0
 void applyMask(VolData& vol, VolData& maskVol);
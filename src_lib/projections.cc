@@ -1,101 +1,863 @@
 #include <projections.h>
 
 #include <LORCache.h>
+#include <LORList.h>
+#include <OccupancyGrid.h>
 #include <Siddon.h>
+#include <SlabSchedule.h>
+#include <Symmetries.h>
+#include <TileScheduler.h>
+#include <VolAccumulator.h>
 #include <console.h>
 #include <macros.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 // TODO: Get rid of this
 const bool DEBUG{false};
 
-namespace projections
+// Get the axial and tangential coordinates of a bin from its
+// index within its view
+static std::pair<int, int> getBinCoords(
+  const ProjData& proj,
+  int binIndexInView)
 {
-void forward(
+  const auto nTangCoords = proj.getHeader().nTangCoords;
+
+  return {
+    binIndexInView / nTangCoords,
+    binIndexInView % nTangCoords -
+      proj.getGeometry().tangCoordOffset};
+}
+
+// Print info about a projection bin
+static void printBinInfo(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  int seg,
+  int view,
+  int binIndexInView,
+  const VolData& vol,
+  const types::PathElement* pathElements,
+  types::VoxelValue line)
+{
+  const auto [axialCoord, tangCoord] =
+    getBinCoords(proj, binIndexInView);
+
+  const auto [crystalAxialCoord1, crystalAxialCoord2] =
+    proj.getCrystalAxialCoord(seg, axialCoord);
+
+  const auto [crystalAngCoord1, crystalAngCoord2] =
+    proj.getCrystalAngCoord(view, tangCoord);
+
+  scanner.printBinInfo(
+    seg,
+    view,
+    axialCoord,
+    tangCoord,
+    crystalAngCoord1,
+    crystalAxialCoord1,
+    crystalAngCoord2,
+    crystalAxialCoord2,
+    vol,
+    pathElements,
+    line);
+}
+
+// Forward projection with the transaxial paths of each view
+// traced once for all segments
+// If the scanner is axially aligned, the paths of the reference
+// axial coordinate of each segment are shifted for the axial
+// coordinates with the same ring difference
+// With symmetries, only fundamental LORs are traced and their
+// paths are mapped to the symmetric LORs
+// Without symmetries, the LORs crossing the empty bricks of
+// occupancyGrid only are skipped, if provided
+static void forwardFactorized(
   const VolData& inputVol,
   const ScannerData& scanner,
-  ProjData& outputProj)
+  ProjData& outputProj,
+  const SystemMatrix* systemMatrix,
+  const Siddon& siddon,
+  const LORCache& cache,
+  const LORList& lorList,
+  const Symmetries* symmetries,
+  const OccupancyGrid* occupancyGrid)
 {
-  // Check proj data dimensions
-  scanner.checkProjData(outputProj);
+  std::cout << "Computing all segments" << std::endl;
 
-  Siddon siddon(inputVol);
+  const auto nSubsets = lorList.getNSubsets();
+  const auto nTangCoords = outputProj.getHeader().nTangCoords;
 
-  LOOP_SEG(seg, outputProj)
+  const auto axiallyAligned = siddon.isAxiallyAligned(scanner);
+  const auto maxPathLength = siddon.getMaxPathLength();
+
+  const auto* dataArray = inputVol.getDataArray();
+
+#pragma omp parallel
   {
-    std::cout << "Computing segment " << seg << std::endl;
+    // Transaxial paths of the current view
+    std::vector<Siddon::TransaxialPath> transaxialPaths;
+
+    // [tangIndex * maxPathLength + element] Paths of the
+    // reference axial coordinate of the current segment
+    std::vector<types::PathElement> referencePaths(
+      axiallyAligned ? nTangCoords * maxPathLength : 0);
 
-    const auto nBinsPerViewForCurrentSegment =
-      outputProj.getGeometry().getNAxialCoords(seg) *
-      outputProj.getHeader().nTangCoords;
+    // [tangIndex] True once the path of the reference axial
+    // coordinate is traced
+    std::vector<bool> referenceTraced;
 
-    types::PathElement* threadLocalPathElements = nullptr;
+    auto* threadLocalPathElements =
+      siddon.getThreadLocalPathElements();
+
+    // Paths mapped by a symmetry
+    auto* mappedPathElements =
+      siddon.getThreadLocalPathElements(1);
 
     // Parallelization over views
-#pragma omp parallel for firstprivate(threadLocalPathElements)
+#pragma omp for schedule(dynamic)
     LOOP_VIEW(view, outputProj)
     {
-      if (threadLocalPathElements == nullptr)
+      if (
+        symmetries != nullptr &&
+        !symmetries->hasFundamentalLORs(view))
       {
-        threadLocalPathElements =
-          siddon.getThreadLocalPathElements();
+        continue;
       }
 
-      auto binIndex = view * nBinsPerViewForCurrentSegment;
+      const auto subset = view % nSubsets;
+      const auto subview = view / nSubsets;
+
+      siddon.computeViewTransaxialPaths(
+        outputProj,
+        scanner,
+        view,
+        transaxialPaths);
 
-      LOOP_AXIAL(axialCoord, outputProj, seg)
-      LOOP_TANG(tangCoord, outputProj)
+      LOOP_SEG(seg, outputProj)
       {
-        const auto [crystalAxialCoord1, crystalAxialCoord2] =
-          outputProj.getCrystalAxialCoord(seg, axialCoord);
+        const auto nBinsPerView = cache.getNBinsPerView(seg);
+
+        const auto referenceAxialCoord =
+          outputProj.getReferenceAxialCoord(seg);
+        const auto
+          [referenceCrystalAxialCoord1,
+           referenceCrystalAxialCoord2] =
+            outputProj.getCrystalAxialCoord(
+              seg,
+              referenceAxialCoord);
+
+        // Paths of the reference axial coordinate are traced on
+        // first use, whether its LORs are listed or not
+        referenceTraced.assign(nTangCoords, false);
 
-        const auto [crystalAngCoord1, crystalAngCoord2] =
-          outputProj.getCrystalAngCoord(view, tangCoord);
+        const auto [firstPosition, endPosition] =
+          lorList.getViewRange(subset, seg, subview);
 
-        siddon.computePathBetweenCrystals(
+        LOOP(position, firstPosition, endPosition - 1)
+        {
+          // Index of LOR in LORCache order
+          const auto index =
+            lorList.getIndex(subset, seg, position);
+
+          const auto binIndexInView =
+            index - subview * nBinsPerView;
+          const auto tangIndex = binIndexInView % nTangCoords;
+
+          // Symmetric LORs are mapped from fundamental LORs
+          if (
+            symmetries != nullptr &&
+            !symmetries->isFundamental(view, tangIndex))
+          {
+            continue;
+          }
+
+          // Get LOR crystals
+          const auto
+            [valid,
+             binIndex,
+             crystalAxialCoord1,
+             crystalAngCoord1,
+             crystalAxialCoord2,
+             crystalAngCoord2] =
+              cache.getLOR(subset, seg, index);
+
+          // Bin left to zero
+          if (
+            occupancyGrid != nullptr && symmetries == nullptr &&
+            !occupancyGrid->crossesOccupiedBetweenCrystals(
+              scanner,
+              crystalAxialCoord1,
+              crystalAngCoord1,
+              crystalAxialCoord2,
+              crystalAngCoord2))
+          {
+            continue;
+          }
+
+          // Path of the reference axial coordinate is shifted
+          // for the axial coordinates with the same ring
+          // difference
+          const auto shifted = axiallyAligned &&
+            crystalAxialCoord1 - crystalAxialCoord2 ==
+              referenceCrystalAxialCoord1 -
+                referenceCrystalAxialCoord2;
+
+          auto* referencePath = shifted ?
+            &referencePaths[tangIndex * maxPathLength] :
+            nullptr;
+
+          if (shifted && !referenceTraced[tangIndex])
+          {
+            siddon.computePathFromTransaxialBetweenCrystals(
+              transaxialPaths[tangIndex],
+              scanner,
+              referenceCrystalAxialCoord1,
+              referenceCrystalAxialCoord2,
+              referencePath);
+            referenceTraced[tangIndex] = true;
+          }
+
+          // Get path from system matrix if stored
+          const auto* pathElements = systemMatrix == nullptr ?
+            nullptr :
+            systemMatrix->getRow(subset, seg, index);
+
+          // Shift of the voxel indices of the path
+          types::Index coordOffset{0};
+
+          // Shift path of the reference axial coordinate, or
+          // merge axial crossings with transaxial path
+          // otherwise
+          if (pathElements == nullptr && shifted)
+          {
+            pathElements = referencePath;
+            coordOffset = siddon.getAxialShift(
+              crystalAxialCoord1,
+              referenceCrystalAxialCoord1);
+          }
+          else if (
+            pathElements == nullptr && symmetries == nullptr)
+          {
+            // Path not stored: Line integral accumulated during
+            // traversal
+            types::VoxelValue line{0.0};
+
+            siddon.traceFromTransaxialBetweenCrystals(
+              transaxialPaths[tangIndex],
+              scanner,
+              crystalAxialCoord1,
+              crystalAxialCoord2,
+              [&](types::Index coord, types::PathExtent length)
+              {
+                line += length * dataArray[coord];
+              });
+
+            outputProj.setWeightedBin(seg, binIndex, line);
+            continue;
+          }
+          else if (pathElements == nullptr)
+          {
+            siddon.computePathFromTransaxialBetweenCrystals(
+              transaxialPaths[tangIndex],
+              scanner,
+              crystalAxialCoord1,
+              crystalAxialCoord2,
+              threadLocalPathElements);
+
+            pathElements = threadLocalPathElements;
+          }
+
+          outputProj.setWeightedBin(
+            seg,
+            binIndex,
+            inputVol.computeLineIntegral(
+              pathElements,
+              coordOffset));
+
+          if (symmetries == nullptr)
+          {
+            continue;
+          }
+
+          const auto axialBinIndex = binIndexInView - tangIndex;
+
+          for (const auto& symmetricLOR :
+               symmetries->getSymmetricLORs(view, tangIndex))
+          {
+            symmetries->mapPath(
+              symmetricLOR.symmetry,
+              pathElements,
+              mappedPathElements);
+
+            const auto imageSeg =
+              symmetricLOR.swapped ? -seg : seg;
+
+            const auto imageBinIndex =
+              symmetricLOR.view * nBinsPerView + axialBinIndex +
+              symmetricLOR.tangIndex;
+
+            outputProj.setWeightedBin(
+              imageSeg,
+              imageBinIndex,
+              inputVol.computeLineIntegral(
+                mappedPathElements,
+                coordOffset));
+          }
+        }
+      }
+    }
+  }
+}
+
+// Back projection with the transaxial paths of each view
+// traced once for all segments
+// If the scanner is axially aligned, the paths of the reference
+// axial coordinate of each segment are shifted for the axial
+// coordinates with the same ring difference
+// With symmetries, only fundamental LORs are traced and their
+// paths are mapped to the symmetric LORs
+// The subsets from firstSubset to lastSubset are back projected
+// into the frames of outputVol from the first one
+template<typename BinValue>
+static void backwardFactorized(
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  int nSubsets,
+  const SystemMatrix* systemMatrix,
+  const Siddon& siddon,
+  const LORCache& cache,
+  const LORList& lorList,
+  const Symmetries* symmetries,
+  VolAccumulator& accumulator,
+  int firstSubset,
+  int lastSubset,
+  BinValue&& binValue)
+{
+  const auto nViewsPerSubset =
+    inputProj.getGeometry().nViews / nSubsets;
+  const auto nTangCoords = inputProj.getHeader().nTangCoords;
+
+  const auto axiallyAligned = siddon.isAxiallyAligned(scanner);
+  const auto maxPathLength = siddon.getMaxPathLength();
+
+  // Sub-iterations
+  LOOP(subset, firstSubset, lastSubset)
+  {
+    if (nSubsets > 1)
+    {
+      std::cout <<                 //
+        "subset " << subset + 1 << //
+        " of " << nSubsets << std::endl;
+    }
+
+    outputVol.setActiveFrame(subset - firstSubset);
+
+#pragma omp parallel
+    {
+      // Voxels updated by the current thread
+      types::VoxelValue* dataArray;
+      bool atomic;
+      std::tie(dataArray, atomic) =
+        accumulator.getThreadDataArray();
+
+      // Transaxial paths of the current view
+      std::vector<Siddon::TransaxialPath> transaxialPaths;
+
+      // [tangIndex * maxPathLength + element] Paths of the
+      // reference axial coordinate of the current segment
+      std::vector<types::PathElement> referencePaths(
+        axiallyAligned ? nTangCoords * maxPathLength : 0);
+
+      // [tangIndex] True once the path of the reference axial
+      // coordinate is traced
+      std::vector<bool> referenceTraced;
+
+      auto* threadLocalPathElements =
+        siddon.getThreadLocalPathElements();
+
+      // Paths mapped by a symmetry
+      auto* mappedPathElements =
+        siddon.getThreadLocalPathElements(1);
+
+      // Parallelization over views of the subset
+#pragma omp for schedule(dynamic)
+      LOOP(subview, 0, nViewsPerSubset - 1)
+      {
+        const auto view = subview * nSubsets + subset;
+
+        if (
+          symmetries != nullptr &&
+          !symmetries->hasFundamentalLORs(view))
+        {
+          continue;
+        }
+
+        siddon.computeViewTransaxialPaths(
+          inputProj,
+          scanner,
+          view,
+          transaxialPaths);
+
+        LOOP_SEG(seg, inputProj)
+        {
+          const auto nBinsPerView = cache.getNBinsPerView(seg);
+
+          const auto referenceAxialCoord =
+            inputProj.getReferenceAxialCoord(seg);
+          const auto
+            [referenceCrystalAxialCoord1,
+             referenceCrystalAxialCoord2] =
+              inputProj.getCrystalAxialCoord(
+                seg,
+                referenceAxialCoord);
+
+          // Paths of the reference axial coordinate are traced
+          // on first use, whether its LORs are listed or not
+          referenceTraced.assign(nTangCoords, false);
+
+          const auto [firstPosition, endPosition] =
+            lorList.getViewRange(subset, seg, subview);
+
+          LOOP(position, firstPosition, endPosition - 1)
+          {
+            // Index of LOR in LORCache order
+            const auto index =
+              lorList.getIndex(subset, seg, position);
+
+            const auto binIndexInView =
+              index - subview * nBinsPerView;
+            const auto tangIndex = binIndexInView % nTangCoords;
+
+            // Symmetric LORs are mapped from fundamental LORs
+            if (
+              symmetries != nullptr &&
+              !symmetries->isFundamental(view, tangIndex))
+            {
+              continue;
+            }
+
+            const auto
+              [valid,
+               binIndex,
+               crystalAxialCoord1,
+               crystalAngCoord1,
+               crystalAxialCoord2,
+               crystalAngCoord2] =
+                cache.getLOR(subset, seg, index);
+
+            // Path of the reference axial coordinate is shifted
+            // for the axial coordinates with the same ring
+            // difference
+            const auto shifted = axiallyAligned &&
+              crystalAxialCoord1 - crystalAxialCoord2 ==
+                referenceCrystalAxialCoord1 -
+                  referenceCrystalAxialCoord2;
+
+            auto* referencePath = shifted ?
+              &referencePaths[tangIndex * maxPathLength] :
+              nullptr;
+
+            if (shifted && !referenceTraced[tangIndex])
+            {
+              siddon.computePathFromTransaxialBetweenCrystals(
+                transaxialPaths[tangIndex],
+                scanner,
+                referenceCrystalAxialCoord1,
+                referenceCrystalAxialCoord2,
+                referencePath);
+              referenceTraced[tangIndex] = true;
+            }
+
+            // Get path from system matrix if stored
+            const types::PathElement* pathElements =
+              systemMatrix == nullptr ?
+              nullptr :
+              systemMatrix->getRow(subset, seg, index);
+
+            // Shift of the voxel indices of the path
+            types::Index coordOffset{0};
+
+            // Shift path of the reference axial coordinate, or
+            // merge axial crossings with transaxial path
+            // otherwise
+            if (pathElements == nullptr && shifted)
+            {
+              pathElements = referencePath;
+              coordOffset = siddon.getAxialShift(
+                crystalAxialCoord1,
+                referenceCrystalAxialCoord1);
+            }
+            else if (
+              pathElements == nullptr && symmetries == nullptr)
+            {
+              // Path not stored: Volume updated during
+              // traversal
+              const auto value = binValue(seg, binIndex);
+
+              siddon.traceFromTransaxialBetweenCrystals(
+                transaxialPaths[tangIndex],
+                scanner,
+                crystalAxialCoord1,
+                crystalAxialCoord2,
+                [&](
+                  types::Index coord,
+                  types::PathExtent length)
+                {
+                  if (atomic)
+                  {
+#pragma omp atomic
+                    dataArray[coord] += length * value;
+                  }
+                  else
+                  {
+                    dataArray[coord] += length * value;
+                  }
+                });
+
+              continue;
+            }
+            else if (pathElements == nullptr)
+            {
+              siddon.computePathFromTransaxialBetweenCrystals(
+                transaxialPaths[tangIndex],
+                scanner,
+                crystalAxialCoord1,
+                crystalAxialCoord2,
+                threadLocalPathElements);
+
+              pathElements = threadLocalPathElements;
+            }
+
+            accumulator.projectLineIntegral(
+              pathElements,
+              binValue(seg, binIndex),
+              coordOffset);
+
+            if (symmetries == nullptr)
+            {
+              continue;
+            }
+
+            const auto axialBinIndex =
+              binIndexInView - tangIndex;
+
+            for (const auto& symmetricLOR :
+                 symmetries->getSymmetricLORs(view, tangIndex))
+            {
+              symmetries->mapPath(
+                symmetricLOR.symmetry,
+                pathElements,
+                mappedPathElements);
+
+              const auto imageSeg =
+                symmetricLOR.swapped ? -seg : seg;
+
+              const auto imageBinIndex =
+                symmetricLOR.view * nBinsPerView +
+                axialBinIndex + symmetricLOR.tangIndex;
+
+              accumulator.projectLineIntegral(
+                mappedPathElements,
+                binValue(imageSeg, imageBinIndex),
+                coordOffset);
+            }
+          }
+        }
+      }
+    }
+
+    accumulator.reduce();
+  }
+}
+
+// LOR lists provided, checked against the configuration, or
+// computed into computedLORList otherwise
+static const LORList& getLORList(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets,
+  const LORList* lorList,
+  std::optional<LORList>& computedLORList)
+{
+  if (lorList != nullptr)
+  {
+    lorList->checkConfiguration(proj, vol, nSubsets);
+    return *lorList;
+  }
+
+  computedLORList.emplace(proj, scanner, vol, nSubsets);
+  computedLORList->printContent();
+
+  return *computedLORList;
+}
+
+// Schedulers of the packets of the LOR lists of each subset
+static std::vector<TileScheduler> getSchedulers(
+  const ProjData& proj,
+  const Siddon& siddon,
+  const LORList& lorList,
+  int tileSize)
+{
+  std::vector<TileScheduler> schedulers;
+  LOOP(subset, 0, lorList.getNSubsets() - 1)
+  {
+    schedulers.emplace_back(
+      proj,
+      lorList,
+      subset,
+      siddon.getPacketSize(),
+      tileSize);
+  }
+  schedulers[0].printContent();
+
+  return schedulers;
+}
+
+// Single frame volume with the frames of vol interleaved voxel
+// by voxel: Frame f of voxel v at v * nFrames + f, so that a
+// path element gathers the values of all frames at once
+// copyValues: Copy the frames of vol (zero otherwise)
+static VolData getInterleavedVol(
+  const VolData& vol,
+  bool copyValues)
+{
+  const auto nFrames = vol.getNFrames();
+
+  auto header = vol.getHeader();
+  header.volSize.nPixelsX *= nFrames;
+  header.voxelExtent.pixelWidth /= nFrames;
+  header.nFrames = 1;
+
+  VolData interleavedVol(header);
+
+  auto* interleavedArray = interleavedVol.getDataArray();
+  const auto nVoxels = vol.getNVoxelsPerFrame();
+
+  if (!copyValues)
+  {
+    interleavedVol.setAllVoxels(0.0);
+    return interleavedVol;
+  }
+
+  LOOP(frame, 0, nFrames - 1)
+  {
+    vol.setActiveFrame(frame);
+    const auto* dataArray = vol.getDataArray();
+
+#pragma omp parallel for
+    LOOP(voxel, 0, nVoxels - 1)
+    {
+      interleavedArray[(std::size_t)voxel * nFrames + frame] =
+        dataArray[voxel];
+    }
+  }
+  vol.setActiveFrame(0);
+
+  return interleavedVol;
+}
+
+// Copy the frames of an interleaved volume to vol
+static void deinterleave(
+  const VolData& interleavedVol,
+  VolData& vol)
+{
+  const auto nFrames = vol.getNFrames();
+  const auto nVoxels = vol.getNVoxelsPerFrame();
+  const auto* interleavedArray = interleavedVol.getDataArray();
+
+  LOOP(frame, 0, nFrames - 1)
+  {
+    vol.setActiveFrame(frame);
+    auto* dataArray = vol.getDataArray();
+
+#pragma omp parallel for
+    LOOP(voxel, 0, nVoxels - 1)
+    {
+      dataArray[voxel] =
+        interleavedArray[(std::size_t)voxel * nFrames + frame];
+    }
+  }
+  vol.setActiveFrame(0);
+}
+
+// Line integrals of all frames of an interleaved volume
+static void computeLineIntegrals(
+  const types::VoxelValue* interleavedArray,
+  int nFrames,
+  const types::PathElement* pathElementsArray,
+  types::VoxelValue* lines)
+{
+  std::fill_n(lines, nFrames, 0.0);
+
+  for (auto pathIndex = 0;
+       pathElementsArray[pathIndex].coord != -1;
+       pathIndex++)
+  {
+    const auto length = pathElementsArray[pathIndex].length;
+    const auto* values = interleavedArray +
+      (std::size_t)pathElementsArray[pathIndex].coord * nFrames;
+
+    LOOP(frame, 0, nFrames - 1)
+    {
+      lines[frame] += length * values[frame];
+    }
+  }
+}
+
+// Back projection of the line integrals of all frames into an
+// interleaved volume
+static void projectLineIntegrals(
+  types::VoxelValue* interleavedArray,
+  bool atomic,
+  int nFrames,
+  const types::PathElement* pathElementsArray,
+  const types::VoxelValue* lines)
+{
+  for (auto pathIndex = 0;
+       pathElementsArray[pathIndex].coord != -1;
+       pathIndex++)
+  {
+    const auto length = pathElementsArray[pathIndex].length;
+    auto* values = interleavedArray +
+      (std::size_t)pathElementsArray[pathIndex].coord * nFrames;
+
+    if (atomic)
+    {
+      LOOP(frame, 0, nFrames - 1)
+      {
+#pragma omp atomic
+        values[frame] += length * lines[frame];
+      }
+    }
+    else
+    {
+      LOOP(frame, 0, nFrames - 1)
+      {
+        values[frame] += length * lines[frame];
+      }
+    }
+  }
+}
+
+// Trace the packets of LORs of the list of the first subset,
+// each LOR once, and call function(seg, binIndex, pathElements)
+// for each LOR of the packet within the parallel region
+template<typename Function>
+static void forEachPacketLOR(
+  const ScannerData& scanner,
+  const Siddon& siddon,
+  const LORCache& cache,
+  const LORList& lorList,
+  const TileScheduler& scheduler,
+  Function&& function)
+{
+  const auto packetSize = siddon.getPacketSize();
+
+  scheduler.run(
+    [&](int seg, int packetIndex)
+    {
+      const auto nLORs = lorList.getNLORs(0, seg);
+
+      types::PathElement*
+        pathElements[Siddon::MAX_PACKET_SIZE]{};
+      LOOP(lane, 0, packetSize - 1)
+      {
+        pathElements[lane] =
+          siddon.getThreadLocalPathElements(lane);
+      }
+
+      const auto firstPosition = packetIndex * packetSize;
+      const auto nLORsInPacket =
+        MIN(packetSize, nLORs - firstPosition);
+
+      int binIndices[Siddon::MAX_PACKET_SIZE];
+      Siddon::Packet packet;
+
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        const auto index =
+          lorList.getOrderedIndex(0, seg, firstPosition + lane);
+
+        const auto
+          [valid,
+           binIndex,
+           crystalAxialCoord1,
+           crystalAngCoord1,
+           crystalAxialCoord2,
+           crystalAngCoord2] = cache.getLOR(0, seg, index);
+
+        binIndices[lane] = binIndex;
+
+        siddon.addToPacket(
+          packet,
           scanner,
           crystalAxialCoord1,
           crystalAngCoord1,
           crystalAxialCoord2,
-          crystalAngCoord2,
-          threadLocalPathElements);
+          crystalAngCoord2);
+      }
+
+      bool crosses[Siddon::MAX_PACKET_SIZE];
+      siddon.computePathPacket(packet, pathElements, crosses);
 
-        // Compute line integral
-        const auto line =
-          inputVol.computeLineIntegral(threadLocalPathElements);
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        function(seg, binIndices[lane], pathElements[lane]);
+      }
+    });
+}
 
-        // Put result in ProjData
-        BIN(outputProj, seg, binIndex) = line;
+// Issue error if the projections of the frames don't fit with
+// the scanner or with each other
+static void checkFrameProjs(
+  const std::vector<ProjData>& projs,
+  const ScannerData& scanner,
+  int nFrames)
+{
+  if ((int)projs.size() != nFrames)
+  {
+    error("Number of projections different from frames");
+  }
 
-        binIndex++;
+  for (const auto& proj : projs)
+  {
+    scanner.checkProjData(proj);
 
-        // Print info about current projection bin
-        if (DEBUG)
-        {
-          scanner.printBinInfo(
-            seg,
-            view,
-            axialCoord,
-            tangCoord,
-            crystalAngCoord1,
-            crystalAxialCoord1,
-            crystalAngCoord2,
-            crystalAxialCoord2,
-            inputVol,
-            threadLocalPathElements,
-            line);
-        }
-      }
+    if (!(proj.getHeader() == projs[0].getHeader()))
+    {
+      error("Projections of the frames not the same size");
     }
   }
 }
 
-void backward(
+// Back projection of the value of each bin given by
+// binValue(seg, binIndex), inputProj giving the geometry
+// onlySubset: Subset back projected into the single frame of
+// outputVol (-1: Each subset into its frame)
+template<typename BinValue>
+static void backwardBins(
   const ProjData& inputProj,
   const ScannerData& scanner,
   VolData& outputVol,
-  int nSubsets)
+  int nSubsets,
+  const SystemMatrix* systemMatrix,
+  projections::Projector projector,
+  projections::Accumulation accumulation,
+  double maxAccumulationMemoryMB,
+  int tileSize,
+  const LORList* lorList,
+  int onlySubset,
+  BinValue&& binValue)
 {
   // Check proj data dimensions
   scanner.checkProjData(inputProj);
@@ -103,96 +865,711 @@ void backward(
   // Check number of subsets
   inputProj.checkNSubsets(nSubsets);
 
+  if (onlySubset < -1 || onlySubset >= nSubsets)
+  {
+    error("Subset out of range");
+  }
+
+  const auto firstSubset = onlySubset == -1 ? 0 : onlySubset;
+  const auto lastSubset =
+    onlySubset == -1 ? nSubsets - 1 : onlySubset;
+
   // Check number of frames allocated
-  outputVol.checkNFrames(nSubsets);
+  outputVol.checkNFrames(lastSubset - firstSubset + 1);
 
-  // Initialize siddon algorithm and LOR list
+  // Check system matrix configuration
+  if (systemMatrix != nullptr)
+  {
+    systemMatrix->checkConfiguration(
+      inputProj,
+      outputVol,
+      nSubsets);
+  }
+
+  // Initialize siddon algorithm and LOR lists
   Siddon siddon(outputVol);
   LORCache cache(inputProj, nSubsets);
 
+  std::optional<LORList> computedLORList;
+  const auto& lorLists = getLORList(
+    inputProj,
+    scanner,
+    outputVol,
+    nSubsets,
+    lorList,
+    computedLORList);
+
   echo("Back-projection");
 
   // Initialize output volume
   outputVol.setAllVoxelsAllFrames(0.0);
 
-  if (nSubsets == 1)
+  VolAccumulator accumulator(
+    outputVol,
+    accumulation,
+    maxAccumulationMemoryMB);
+  if (accumulation == projections::Accumulation::PRIVATE)
   {
-    std::cout << "Segment:";
+    accumulator.printContent();
   }
 
+  if (accumulation == projections::Accumulation::SCHEDULED)
+  {
+    const SlabSchedule schedule(inputProj, scanner, siddon);
+    schedule.printContent();
+
+    // Sub-iterations
+    LOOP(subset, firstSubset, lastSubset)
+    {
+      if (nSubsets > 1)
+      {
+        std::cout <<                 //
+          "subset " << subset + 1 << //
+          " of " << nSubsets << std::endl;
+      }
+
+      outputVol.setActiveFrame(subset - firstSubset);
+
+      schedule.forEachLOR(
+        subset,
+        nSubsets,
+        inputProj,
+        scanner,
+        siddon,
+        cache,
+        lorLists,
+        systemMatrix,
+        [&](
+          int seg,
+          int binIndex,
+          const types::PathElement* pathElements)
+        {
+          accumulator.projectLineIntegral(
+            pathElements,
+            binValue(seg, binIndex));
+        });
+    }
+    return;
+  }
+
+  if (projector == projections::Projector::FACTORIZED)
+  {
+    backwardFactorized(
+      inputProj,
+      scanner,
+      outputVol,
+      nSubsets,
+      systemMatrix,
+      siddon,
+      cache,
+      lorLists,
+      nullptr,
+      accumulator,
+      firstSubset,
+      lastSubset,
+      binValue);
+    return;
+  }
+
+  if (projector == projections::Projector::SYMMETRIC)
+  {
+    const Symmetries symmetries(
+      inputProj,
+      scanner,
+      outputVol,
+      nSubsets);
+    symmetries.printContent();
+
+    backwardFactorized(
+      inputProj,
+      scanner,
+      outputVol,
+      nSubsets,
+      systemMatrix,
+      siddon,
+      cache,
+      lorLists,
+      &symmetries,
+      accumulator,
+      firstSubset,
+      lastSubset,
+      binValue);
+    return;
+  }
+
+  const auto packetSize = siddon.getPacketSize();
+  const auto schedulers =
+    getSchedulers(inputProj, siddon, lorLists, tileSize);
+
   // Sub-iterations
-  LOOP(subset, 0, nSubsets - 1)
+  LOOP(subset, firstSubset, lastSubset)
   {
     if (nSubsets > 1)
     {
       std::cout <<                 //
         "subset " << subset + 1 << //
         " of " << nSubsets << std::endl;
-      std::cout << "Segment:";
     }
 
-    outputVol.setActiveFrame(subset);
+    outputVol.setActiveFrame(subset - firstSubset);
 
-    LOOP_SEG(seg, inputProj)
-    {
-      std::cout << " " << seg << std::flush;
+    // Packets of consecutive LORs of the list of the subset
+    schedulers[subset].run(
+      [&](int seg, int packetIndex)
+      {
+        const auto nLORs = lorLists.getNLORs(subset, seg);
+
+        types::PathElement*
+          threadLocalPathElements[Siddon::MAX_PACKET_SIZE];
+        LOOP(lane, 0, packetSize - 1)
+        {
+          threadLocalPathElements[lane] =
+            siddon.getThreadLocalPathElements(lane);
+        }
+
+        const auto firstPosition = packetIndex * packetSize;
+        const auto nLORsInPacket =
+          MIN(packetSize, nLORs - firstPosition);
 
-      auto nBinsForCurrentSubsetAndSegment =
-        cache.setSubsetAndSegment(subset, seg);
+        int binIndices[Siddon::MAX_PACKET_SIZE];
+        const types::PathElement*
+          pathElements[Siddon::MAX_PACKET_SIZE];
 
-      types::PathElement* threadLocalPathElements{nullptr};
+        // LORs to trace and their position in the packet
+        Siddon::Packet packet;
+        int packetLanes[Siddon::MAX_PACKET_SIZE];
+
+        LOOP(lane, 0, nLORsInPacket - 1)
+        {
+          const auto index = lorLists.getOrderedIndex(
+            subset,
+            seg,
+            firstPosition + lane);
 
-#pragma omp parallel for firstprivate(threadLocalPathElements)
-      LOOP(index, 0, nBinsForCurrentSubsetAndSegment - 1)
+          // Get LOR crystals
+          const auto
+            [valid,
+             binIndex,
+             crystalAxialCoord1,
+             crystalAngCoord1,
+             crystalAxialCoord2,
+             crystalAngCoord2] =
+              cache.getLOR(subset, seg, index);
+
+          binIndices[lane] = binIndex;
+
+          // Get path from system matrix if stored
+          pathElements[lane] = systemMatrix == nullptr ?
+            nullptr :
+            systemMatrix->getRow(subset, seg, index);
+
+          // Apply siddon algorithm otherwise
+          if (pathElements[lane] == nullptr)
+          {
+            packetLanes[packet.nLORs] = lane;
+
+            siddon.addToPacket(
+              packet,
+              scanner,
+              crystalAxialCoord1,
+              crystalAngCoord1,
+              crystalAxialCoord2,
+              crystalAngCoord2);
+          }
+        }
+
+        if (packet.nLORs > 0)
+        {
+          bool crosses[Siddon::MAX_PACKET_SIZE];
+          siddon.computePathPacket(
+            packet,
+            threadLocalPathElements,
+            crosses);
+
+          LOOP(i, 0, packet.nLORs - 1)
+          {
+            pathElements[packetLanes[i]] =
+              threadLocalPathElements[i];
+          }
+        }
+
+        // Add line integrals to volume
+        LOOP(lane, 0, nLORsInPacket - 1)
+        {
+          accumulator.projectLineIntegral(
+            pathElements[lane],
+            binValue(seg, binIndices[lane]));
+        }
+      });
+
+    accumulator.reduce();
+  }
+}
+
+namespace projections
+{
+void forward(
+  const VolData& inputVol,
+  const ScannerData& scanner,
+  ProjData& outputProj,
+  const SystemMatrix* systemMatrix,
+  Projector projector,
+  int tileSize,
+  const LORList* lorList,
+  bool skipEmptySpace)
+{
+  // Check proj data dimensions
+  scanner.checkProjData(outputProj);
+
+  // Same subsets as the system matrix, or as the LOR lists
+  const auto nSubsets = systemMatrix != nullptr ?
+    systemMatrix->getNSubsets() :
+    lorList != nullptr ?
+    lorList->getNSubsets() :
+    1;
+
+  // Check system matrix configuration
+  if (systemMatrix != nullptr)
+  {
+    systemMatrix->checkConfiguration(
+      outputProj,
+      inputVol,
+      nSubsets);
+  }
+
+  Siddon siddon(inputVol);
+  LORCache cache(outputProj, nSubsets);
+
+  std::optional<LORList> computedLORList;
+  const auto& lorLists = getLORList(
+    outputProj,
+    scanner,
+    inputVol,
+    nSubsets,
+    lorList,
+    computedLORList);
+
+  std::optional<OccupancyGrid> occupancyGrid;
+  if (skipEmptySpace && projector != Projector::SYMMETRIC)
+  {
+    occupancyGrid.emplace(inputVol);
+    occupancyGrid->printContent();
+  }
+  const auto* occupancyGridPtr =
+    occupancyGrid.has_value() ? &*occupancyGrid : nullptr;
+
+  // Bins of the LORs missing the volume, or crossing empty
+  // space only, are left to zero
+  outputProj.setAllBins(0.0);
+
+  if (projector == Projector::FACTORIZED)
+  {
+    forwardFactorized(
+      inputVol,
+      scanner,
+      outputProj,
+      systemMatrix,
+      siddon,
+      cache,
+      lorLists,
+      nullptr,
+      occupancyGridPtr);
+    return;
+  }
+
+  if (projector == Projector::SYMMETRIC)
+  {
+    // Same fundamental LORs as the system matrix
+    const Symmetries symmetries(
+      outputProj,
+      scanner,
+      inputVol,
+      nSubsets);
+    symmetries.printContent();
+
+    forwardFactorized(
+      inputVol,
+      scanner,
+      outputProj,
+      systemMatrix,
+      siddon,
+      cache,
+      lorLists,
+      &symmetries,
+      nullptr);
+    return;
+  }
+
+  const auto packetSize = siddon.getPacketSize();
+  const auto schedulers =
+    getSchedulers(outputProj, siddon, lorLists, tileSize);
+
+  LOOP(subset, 0, nSubsets - 1)
+  {
+    // Packets of consecutive LORs of the list of the subset
+    schedulers[subset].run(
+      [&](int seg, int packetIndex)
       {
-        if (threadLocalPathElements == nullptr)
+        const auto nLORs = lorLists.getNLORs(subset, seg);
+
+        types::PathElement*
+          threadLocalPathElements[Siddon::MAX_PACKET_SIZE];
+        LOOP(lane, 0, packetSize - 1)
         {
-          threadLocalPathElements =
-            siddon.getThreadLocalPathElements();
+          threadLocalPathElements[lane] =
+            siddon.getThreadLocalPathElements(lane);
         }
 
-        // Get LOR crystals (seg and binIndex assigned even if
-        // LOR is skipped)
-        const auto
-          [valid,
-           binIndex,
-           crystalAxialCoord1,
-           crystalAngCoord1,
-           crystalAxialCoord2,
-           crystalAngCoord2] = cache.getLOR(index);
+        const auto firstPosition = packetIndex * packetSize;
+        const auto nLORsInPacket =
+          MIN(packetSize, nLORs - firstPosition);
 
-        // TODO: Check if valid should be used
+        // Bin of each LOR (-1: Skipped, left to zero)
+        int binIndices[Siddon::MAX_PACKET_SIZE];
+        const types::PathElement*
+          pathElements[Siddon::MAX_PACKET_SIZE];
 
-        // Apply siddon algorithm
-        siddon.computePathBetweenCrystals(
-          scanner,
-          crystalAxialCoord1,
-          crystalAngCoord1,
-          crystalAxialCoord2,
-          crystalAngCoord2,
-          threadLocalPathElements);
+        // LORs to trace and their position in the packet
+        Siddon::Packet packet;
+        int packetLanes[Siddon::MAX_PACKET_SIZE];
 
-        // Add line integral to volume
-        outputVol.projectLineIntegral(
-          threadLocalPathElements,
-          BIN(inputProj, seg, binIndex));
-      }
-    }
+        LOOP(lane, 0, nLORsInPacket - 1)
+        {
+          const auto index = lorLists.getOrderedIndex(
+            subset,
+            seg,
+            firstPosition + lane);
+
+          // Get LOR crystals
+          const auto
+            [valid,
+             binIndex,
+             crystalAxialCoord1,
+             crystalAngCoord1,
+             crystalAxialCoord2,
+             crystalAngCoord2] =
+              cache.getLOR(subset, seg, index);
+
+          if (
+            occupancyGridPtr != nullptr &&
+            !occupancyGridPtr->crossesOccupiedBetweenCrystals(
+              scanner,
+              crystalAxialCoord1,
+              crystalAngCoord1,
+              crystalAxialCoord2,
+              crystalAngCoord2))
+          {
+            binIndices[lane] = -1;
+            continue;
+          }
+
+          binIndices[lane] = binIndex;
+
+          // Get path from system matrix if stored
+          pathElements[lane] = systemMatrix == nullptr ?
+            nullptr :
+            systemMatrix->getRow(subset, seg, index);
+
+          // Apply siddon algorithm otherwise
+          if (pathElements[lane] == nullptr)
+          {
+            packetLanes[packet.nLORs] = lane;
+
+            siddon.addToPacket(
+              packet,
+              scanner,
+              crystalAxialCoord1,
+              crystalAngCoord1,
+              crystalAxialCoord2,
+              crystalAngCoord2);
+          }
+        }
+
+        if (packet.nLORs > 0)
+        {
+          bool crosses[Siddon::MAX_PACKET_SIZE];
+          siddon.computePathPacket(
+            packet,
+            threadLocalPathElements,
+            crosses);
+
+          LOOP(i, 0, packet.nLORs - 1)
+          {
+            pathElements[packetLanes[i]] =
+              threadLocalPathElements[i];
+          }
+        }
+
+        LOOP(lane, 0, nLORsInPacket - 1)
+        {
+          const auto binIndex = binIndices[lane];
+          if (binIndex == -1)
+          {
+            continue;
+          }
+
+          // Compute line integral
+          const auto line =
+            inputVol.computeLineIntegral(pathElements[lane]);
+
+          // Put result in ProjData
+          outputProj.setWeightedBin(seg, binIndex, line);
+
+          // Print info about current projection bin
+          if (DEBUG)
+          {
+            const auto nBinsPerView =
+              cache.getNBinsPerView(seg);
 
-    printEmptyLine();
+            printBinInfo(
+              outputProj,
+              scanner,
+              seg,
+              binIndex / nBinsPerView,
+              binIndex % nBinsPerView,
+              inputVol,
+              pathElements[lane],
+              line);
+          }
+        }
+      });
   }
 }
 
+void backward(
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  int nSubsets,
+  const SystemMatrix* systemMatrix,
+  Projector projector,
+  Accumulation accumulation,
+  double maxAccumulationMemoryMB,
+  int tileSize,
+  const LORList* lorList)
+{
+  backwardBins(
+    inputProj,
+    scanner,
+    outputVol,
+    nSubsets,
+    systemMatrix,
+    projector,
+    accumulation,
+    maxAccumulationMemoryMB,
+    tileSize,
+    lorList,
+    -1,
+    [&](int seg, int binIndex)
+    {
+      return inputProj.getWeightedBin(seg, binIndex);
+    });
+}
+
 void computeSensitivityVol(
   const ProjData& proj,
   const ScannerData& scanner,
   VolData& outputSensitivityVol,
-  int nSubsets)
+  int nSubsets,
+  const SystemMatrix* systemMatrix,
+  Projector projector,
+  Accumulation accumulation,
+  double maxAccumulationMemoryMB,
+  int tileSize,
+  const LORList* lorList,
+  const ProjData* attenFactors,
+  const ProjData* normFactors,
+  int subset)
 {
-  ProjData ones(
+  for (const auto* factors : {attenFactors, normFactors})
+  {
+    if (
+      factors != nullptr &&
+      !(factors->getHeader() == proj.getHeader()))
+    {
+      error("Factors not the same size as the projection");
+    }
+  }
+
+  // Weight of each LOR computed when it is back projected
+  const auto binWeight = [&](int seg, int binIndex)
+  {
+    types::BinValue weight{1.0};
+
+    if (attenFactors != nullptr)
+    {
+      weight *= BIN(*attenFactors, seg, binIndex);
+    }
+
+    if (normFactors != nullptr)
+    {
+      weight *= BIN(*normFactors, seg, binIndex);
+    }
+
+    return weight;
+  };
+
+  backwardBins(
     proj,
-    ProjData::ConstructionMode::INITIALIZE,
-    1.0);
-  backward(ones, scanner, outputSensitivityVol, nSubsets);
+    scanner,
+    outputSensitivityVol,
+    nSubsets,
+    systemMatrix,
+    projector,
+    accumulation,
+    maxAccumulationMemoryMB,
+    tileSize,
+    lorList,
+    subset,
+    binWeight);
+}
+
+void forwardFrames(
+  const VolData& inputVol,
+  const ScannerData& scanner,
+  std::vector<ProjData>& outputProjs,
+  int tileSize,
+  const LORList* lorList)
+{
+  const auto nFrames = inputVol.getNFrames();
+  checkFrameProjs(outputProjs, scanner, nFrames);
+
+  auto& firstProj = outputProjs[0];
+
+  Siddon siddon(inputVol);
+  LORCache cache(firstProj, 1);
+
+  std::optional<LORList> computedLORList;
+  const auto& lorLists = getLORList(
+    firstProj,
+    scanner,
+    inputVol,
+    1,
+    lorList,
+    computedLORList);
+
+  const auto schedulers =
+    getSchedulers(firstProj, siddon, lorLists, tileSize);
+
+  // Bins of the LORs missing the volume are left to zero
+  for (auto& proj : outputProjs)
+  {
+    proj.setAllBins(0.0);
+  }
+
+  const auto interleavedVol = getInterleavedVol(inputVol, true);
+  const auto* interleavedArray = interleavedVol.getDataArray();
+
+  forEachPacketLOR(
+    scanner,
+    siddon,
+    cache,
+    lorLists,
+    schedulers[0],
+    [&](
+      int seg,
+      int binIndex,
+      const types::PathElement* pathElements)
+    {
+      thread_local std::vector<types::VoxelValue> lines;
+      lines.resize(nFrames);
+
+      computeLineIntegrals(
+        interleavedArray,
+        nFrames,
+        pathElements,
+        lines.data());
+
+      LOOP(frame, 0, nFrames - 1)
+      {
+        outputProjs[frame].setWeightedBin(
+          seg,
+          binIndex,
+          lines[frame]);
+      }
+    });
+}
+
+void backwardFrames(
+  const std::vector<ProjData>& inputProjs,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  Accumulation accumulation,
+  double maxAccumulationMemoryMB,
+  int tileSize,
+  const LORList* lorList)
+{
+  const auto nFrames = outputVol.getNFrames();
+  checkFrameProjs(inputProjs, scanner, nFrames);
+
+  if (accumulation == Accumulation::SCHEDULED)
+  {
+    error("Scheduled accumulation not supported for frames");
+  }
+
+  const auto& firstProj = inputProjs[0];
+
+  Siddon siddon(outputVol);
+  LORCache cache(firstProj, 1);
+
+  std::optional<LORList> computedLORList;
+  const auto& lorLists = getLORList(
+    firstProj,
+    scanner,
+    outputVol,
+    1,
+    lorList,
+    computedLORList);
+
+  const auto schedulers =
+    getSchedulers(firstProj, siddon, lorLists, tileSize);
+
+  echo("Back-projection");
+
+  auto interleavedVol = getInterleavedVol(outputVol, false);
+
+  VolAccumulator accumulator(
+    interleavedVol,
+    accumulation,
+    maxAccumulationMemoryMB);
+  if (accumulation == Accumulation::PRIVATE)
+  {
+    accumulator.printContent();
+  }
+
+  forEachPacketLOR(
+    scanner,
+    siddon,
+    cache,
+    lorLists,
+    schedulers[0],
+    [&](
+      int seg,
+      int binIndex,
+      const types::PathElement* pathElements)
+    {
+      thread_local std::vector<types::VoxelValue> lines;
+      lines.resize(nFrames);
+
+      LOOP(frame, 0, nFrames - 1)
+      {
+        lines[frame] =
+          inputProjs[frame].getWeightedBin(seg, binIndex);
+      }
+
+      const auto [dataArray, atomic] =
+        accumulator.getThreadDataArray();
+
+      projectLineIntegrals(
+        dataArray,
+        atomic,
+        nFrames,
+        pathElements,
+        lines.data());
+    });
+
+  accumulator.reduce();
+
+  deinterleave(interleavedVol, outputVol);
 }
 }
@@ -1,25 +1,133 @@
 #pragma once
 
+#include <LORList.h>
 #include <ProjData.h>
 #include <ScannerData.h>
+#include <SystemMatrix.h>
 #include <VolData.h>
 
+#include <vector>
+
+// Projections use the rows of systemMatrix when it is provided
+// and stored, and trace LORs with Siddon otherwise
+// Bins are multiplied by the bin weights of the projections
+// (see ProjData) when written by forward projections and read
+// by back projections
 namespace projections
 {
+// Way LORs are traced with Siddon
+enum class Projector
+{
+  // Packets of LORs traced together with SIMD instructions
+  PACKET,
+
+  // Transaxial path traced once per view and tangential
+  // coordinate and merged with the axial crossings of each
+  // axial coordinate and segment
+  FACTORIZED,
+
+  // Same as FACTORIZED for the fundamental LORs of the
+  // symmetries of the scanner only, whose paths are mapped to
+  // the other LORs (see Symmetries)
+  SYMMETRIC
+};
+
+// Way the threads accumulate back projections in the volume
+enum class Accumulation
+{
+  // Atomic updates of the volume
+  ATOMIC,
+
+  // Updates of a partial volume per thread, summed into the
+  // volume after each subset (see VolAccumulator)
+  PRIVATE,
+
+  // Updates of the volume without synchronization, the LORs
+  // being scheduled in groups crossing disjoint slices (see
+  // SlabSchedule)
+  // Paths are traced as by the factorized projector, whatever
+  // the projector
+  SCHEDULED
+};
+
+// tileSize: Number of packets per tile scheduled at once by
+// the packet projector (0: Default, see TileScheduler)
+// lorList: LORs crossing the volume, computed for the number of
+// subsets of systemMatrix if provided, without cut cylinder
+// nor leaving out zero bins (nullptr: Computed)
+// skipEmptySpace: LORs crossing zero voxels only are left out,
+// from an OccupancyGrid of inputVol (same projection), except
+// with the symmetric projector
 void forward(
   const VolData& inputVol,
   const ScannerData& scanner,
-  ProjData& outputProj);
+  ProjData& outputProj,
+  const SystemMatrix* systemMatrix = nullptr,
+  Projector projector = Projector::PACKET,
+  int tileSize = 0,
+  const LORList* lorList = nullptr,
+  bool skipEmptySpace = false);
 
+// maxAccumulationMemoryMB: Memory budget of the partial
+// volumes of private accumulation in MB (0: No limit)
+// tileSize, lorList: Same as for forward, lorList being
+// computed for nSubsets
 void backward(
   const ProjData& inputProj,
   const ScannerData& scanner,
   VolData& outputVol,
-  int nSubsets = 1);
+  int nSubsets = 1,
+  const SystemMatrix* systemMatrix = nullptr,
+  Projector projector = Projector::PACKET,
+  Accumulation accumulation = Accumulation::ATOMIC,
+  double maxAccumulationMemoryMB = 0.0,
+  int tileSize = 0,
+  const LORList* lorList = nullptr);
 
+// Back projection of the weight of each LOR into the frame of
+// its subset, without projection data: proj only gives the
+// geometry and its bins and bin weights are not read
+// attenFactors, normFactors: Attenuation (exp(-line integral of
+// mu)) and normalization factors of the bins of proj,
+// multiplying the weights when provided (nullptr: 1)
+// subset: Subset computed into the single frame of
+// initializedSensVol (-1: Each subset into its frame)
 void computeSensitivityVol(
   const ProjData& proj,
   const ScannerData& scanner,
   VolData& initializedSensVol,
-  int nSubsets = 1);
+  int nSubsets = 1,
+  const SystemMatrix* systemMatrix = nullptr,
+  Projector projector = Projector::PACKET,
+  Accumulation accumulation = Accumulation::ATOMIC,
+  double maxAccumulationMemoryMB = 0.0,
+  int tileSize = 0,
+  const LORList* lorList = nullptr,
+  const ProjData* attenFactors = nullptr,
+  const ProjData* normFactors = nullptr,
+  int subset = -1);
+
+// Projections of the frames of a dynamic or gated study, or of
+// replicates: Each LOR is traced once by the packet projector
+// for all frames, with the frames interleaved voxel by voxel
+// outputProjs: Projection of each frame of inputVol (all of
+// the same size)
+// lorList: Same as for forward, for a single subset
+void forwardFrames(
+  const VolData& inputVol,
+  const ScannerData& scanner,
+  std::vector<ProjData>& outputProjs,
+  int tileSize = 0,
+  const LORList* lorList = nullptr);
+
+// Back projection of inputProjs into the frames of outputVol,
+// with atomic or private accumulation
+void backwardFrames(
+  const std::vector<ProjData>& inputProjs,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  Accumulation accumulation = Accumulation::ATOMIC,
+  double maxAccumulationMemoryMB = 0.0,
+  int tileSize = 0,
+  const LORList* lorList = nullptr);
 }
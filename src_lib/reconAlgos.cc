@@ -1,61 +1,666 @@
 #include <reconAlgos.h>
 
+#include <GaussianFilter.h>
 #include <LORCache.h>
+#include <LORList.h>
+#include <RayCache.h>
 #include <Siddon.h>
+#include <SlabSchedule.h>
+#include <Symmetries.h>
+#include <TileScheduler.h>
+#include <VolAccumulator.h>
 #include <console.h>
 #include <macros.h>
 #include <operations.h>
 
 #include <tuple>
+#include <utility>
+#include <vector>
 
-inline std::tuple<int, types::VoxelValue> getLine(
-  int index,
-  LORCache& cache,
+// Compute line integrals of a packet of consecutive LORs of
+// the list of a subset and segment starting at firstPosition
+// Outputs for each LOR: binIndices, lines, pathElements
+inline void getLines(
+  int subset,
+  int seg,
+  int firstPosition,
+  int nLORsInPacket,
+  const LORCache& cache,
+  const LORList& lorList,
   const Siddon& siddon,
+  const SystemMatrix* systemMatrix,
+  const RayCache* rayCache,
   const ScannerData& scanner,
-  types::PathElement* threadLocalPathElements,
-  bool firstIter,
-  const VolData& outputVol)
+  types::PathElement* const* threadLocalPathElements,
+  const VolData& outputVol,
+  int* binIndices,
+  types::VoxelValue* lines,
+  const types::PathElement** pathElements)
 {
-  // Get LOR crystals (seg and binIndex assigned even if LOR is
-  // skipped)
-  const auto
-    [validSaved,
-     binIndex,
-     crystalAxialCoord1,
-     crystalAngCoord1,
-     crystalAxialCoord2,
-     crystalAngCoord2] = cache.getLOR(index);
-
-  types::VoxelValue line;
-  if (validSaved)
+  // Start straight at the voxel walk if the setups of the LORs
+  // are stored
+  const auto raysStored =
+    rayCache != nullptr && rayCache->isStored(subset, seg);
+
+  // LORs to trace and their position in the packet
+  Siddon::Packet packet;
+  Siddon::RayPacket rays;
+  int packetLanes[Siddon::MAX_PACKET_SIZE];
+
+  LOOP(lane, 0, nLORsInPacket - 1)
   {
-    // Apply siddon algorithm
-    const auto valid = siddon.computePathBetweenCrystals(
-      scanner,
-      crystalAxialCoord1,
-      crystalAngCoord1,
-      crystalAxialCoord2,
-      crystalAngCoord2,
-      threadLocalPathElements);
-
-    // Disable LOR for future iterations
-    if (firstIter && !valid)
+    const auto position = firstPosition + lane;
+    const auto index =
+      lorList.getOrderedIndex(subset, seg, position);
+
+    // Get LOR crystals
+    const auto
+      [valid,
+       binIndex,
+       crystalAxialCoord1,
+       crystalAngCoord1,
+       crystalAxialCoord2,
+       crystalAngCoord2] = cache.getLOR(subset, seg, index);
+
+    binIndices[lane] = binIndex;
+
+    // Get path from system matrix if stored
+    const auto* storedPathElements = systemMatrix == nullptr ?
+      nullptr :
+      systemMatrix->getRow(subset, seg, index);
+
+    if (storedPathElements != nullptr)
     {
-      cache.disableLOR(index);
+      // Compute line integral (zero for empty path)
+      lines[lane] =
+        outputVol.computeLineIntegral(storedPathElements);
+      pathElements[lane] = storedPathElements;
     }
+    else if (raysStored)
+    {
+      // Apply siddon algorithm from stored setup (below)
+      packetLanes[rays.nLORs] = lane;
+
+      rayCache->addToPacket(rays, subset, seg, position);
+    }
+    else
+    {
+      // Apply siddon algorithm (below)
+      packetLanes[packet.nLORs] = lane;
+
+      siddon.addToPacket(
+        packet,
+        scanner,
+        crystalAxialCoord1,
+        crystalAngCoord1,
+        crystalAxialCoord2,
+        crystalAngCoord2);
+    }
+  }
+
+  // Only one of the packets is filled
+  const auto nTracedLORs = packet.nLORs + rays.nLORs;
+  if (nTracedLORs == 0)
+  {
+    return;
+  }
+
+  bool crosses[Siddon::MAX_PACKET_SIZE];
+  if (raysStored)
+  {
+    siddon.computePathPacket(
+      rays,
+      threadLocalPathElements,
+      crosses);
+  }
+  else
+  {
+    siddon.computePathPacket(
+      packet,
+      threadLocalPathElements,
+      crosses);
+  }
+
+  LOOP(i, 0, nTracedLORs - 1)
+  {
+    const auto lane = packetLanes[i];
+
+    pathElements[lane] = threadLocalPathElements[i];
 
     // Compute line integral
-    line = valid ?
-      outputVol.computeLineIntegral(threadLocalPathElements) :
+    lines[lane] = crosses[i] ?
+      outputVol.computeLineIntegral(pathElements[lane]) :
       0.0;
   }
-  else
+}
+
+// Back-project the ratio of a bin of inputProj to the line
+// integral of outputVol (plus bias) along its path into
+// backProj
+// coordOffset: Shift of the voxel indices of the path
+static void backProjectRatio(
+  const types::PathElement* pathElements,
+  types::Index coordOffset,
+  int seg,
+  int binIndex,
+  const ProjData& inputProj,
+  const VolData& outputVol,
+  const std::optional<ProjData>& biasProj,
+  VolAccumulator& backProj)
+{
+  auto line =
+    outputVol.computeLineIntegral(pathElements, coordOffset);
+
+  // Add bias if biasProj is provided
+  if (biasProj != std::nullopt)
+  {
+    line += BIN(*biasProj, seg, binIndex);
+  }
+
+  if (line > EPSILON)
+  {
+    backProj.projectLineIntegral(
+      pathElements,
+      inputProj.getWeightedBin(seg, binIndex) / line,
+      coordOffset);
+  }
+}
+
+// Same as backProjectRatios with the transaxial paths of each
+// view of the subset traced once for all segments
+// If the scanner is axially aligned, the paths of the reference
+// axial coordinate of each segment are shifted for the axial
+// coordinates with the same ring difference
+// With symmetries, only fundamental LORs are traced and their
+// paths are mapped to the symmetric LORs
+static void backProjectRatiosFactorized(
+  int subset,
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  const VolData& outputVol,
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix,
+  int nSubsets,
+  const Siddon& siddon,
+  const Symmetries* symmetries,
+  const LORCache& cache,
+  const LORList& lorList,
+  VolAccumulator& backProj)
+{
+  const auto nViewsPerSubset =
+    inputProj.getGeometry().nViews / nSubsets;
+  const auto nTangCoords = inputProj.getHeader().nTangCoords;
+
+  const auto axiallyAligned = siddon.isAxiallyAligned(scanner);
+  const auto maxPathLength = siddon.getMaxPathLength();
+
+#pragma omp parallel
+  {
+    // Transaxial paths of the current view
+    std::vector<Siddon::TransaxialPath> transaxialPaths;
+
+    // [tangIndex * maxPathLength + element] Paths of the
+    // reference axial coordinate of the current segment
+    std::vector<types::PathElement> referencePaths(
+      axiallyAligned ? nTangCoords * maxPathLength : 0);
+
+    // [tangIndex] True once the path of the reference axial
+    // coordinate is traced
+    std::vector<bool> referenceTraced;
+
+    auto* threadLocalPathElements =
+      siddon.getThreadLocalPathElements();
+
+    // Paths mapped by a symmetry
+    auto* mappedPathElements =
+      siddon.getThreadLocalPathElements(1);
+
+    // Parallelization over views of the subset
+#pragma omp for schedule(dynamic)
+    LOOP(subview, 0, nViewsPerSubset - 1)
+    {
+      const auto view = subview * nSubsets + subset;
+
+      if (
+        symmetries != nullptr &&
+        !symmetries->hasFundamentalLORs(view))
+      {
+        continue;
+      }
+
+      siddon.computeViewTransaxialPaths(
+        inputProj,
+        scanner,
+        view,
+        transaxialPaths);
+
+      LOOP_SEG(seg, inputProj)
+      {
+        const auto nBinsPerView = cache.getNBinsPerView(seg);
+
+        const auto referenceAxialCoord =
+          inputProj.getReferenceAxialCoord(seg);
+        const auto
+          [referenceCrystalAxialCoord1,
+           referenceCrystalAxialCoord2] =
+            inputProj.getCrystalAxialCoord(
+              seg,
+              referenceAxialCoord);
+
+        // Paths of the reference axial coordinate are traced on
+        // first use, whether its LORs are listed or not
+        referenceTraced.assign(nTangCoords, false);
+
+        const auto [firstPosition, endPosition] =
+          lorList.getViewRange(subset, seg, subview);
+
+        LOOP(position, firstPosition, endPosition - 1)
+        {
+          // Index of LOR in LORCache order
+          const auto index =
+            lorList.getIndex(subset, seg, position);
+
+          const auto binIndexInView =
+            index - subview * nBinsPerView;
+          const auto tangIndex = binIndexInView % nTangCoords;
+
+          // Symmetric LORs are mapped from fundamental LORs
+          if (
+            symmetries != nullptr &&
+            !symmetries->isFundamental(view, tangIndex))
+          {
+            continue;
+          }
+
+          // Get LOR crystals
+          const auto
+            [valid,
+             binIndex,
+             crystalAxialCoord1,
+             crystalAngCoord1,
+             crystalAxialCoord2,
+             crystalAngCoord2] =
+              cache.getLOR(subset, seg, index);
+
+          // Path of the reference axial coordinate is shifted
+          // for the axial coordinates with the same ring
+          // difference
+          const auto shifted = axiallyAligned &&
+            crystalAxialCoord1 - crystalAxialCoord2 ==
+              referenceCrystalAxialCoord1 -
+                referenceCrystalAxialCoord2;
+
+          auto* referencePath = shifted ?
+            &referencePaths[tangIndex * maxPathLength] :
+            nullptr;
+
+          if (shifted && !referenceTraced[tangIndex])
+          {
+            siddon.computePathFromTransaxialBetweenCrystals(
+              transaxialPaths[tangIndex],
+              scanner,
+              referenceCrystalAxialCoord1,
+              referenceCrystalAxialCoord2,
+              referencePath);
+            referenceTraced[tangIndex] = true;
+          }
+
+          // Get path from system matrix if stored
+          const auto* pathElements = systemMatrix == nullptr ?
+            nullptr :
+            systemMatrix->getRow(subset, seg, index);
+
+          // Shift of the voxel indices of the path
+          types::Index coordOffset{0};
+
+          // Shift path of the reference axial coordinate, or
+          // merge axial crossings with transaxial path
+          // otherwise
+          if (pathElements == nullptr && shifted)
+          {
+            pathElements = referencePath;
+            coordOffset = siddon.getAxialShift(
+              crystalAxialCoord1,
+              referenceCrystalAxialCoord1);
+          }
+          else if (pathElements == nullptr)
+          {
+            siddon.computePathFromTransaxialBetweenCrystals(
+              transaxialPaths[tangIndex],
+              scanner,
+              crystalAxialCoord1,
+              crystalAxialCoord2,
+              threadLocalPathElements);
+
+            pathElements = threadLocalPathElements;
+          }
+
+          backProjectRatio(
+            pathElements,
+            coordOffset,
+            seg,
+            binIndex,
+            inputProj,
+            outputVol,
+            biasProj,
+            backProj);
+
+          if (symmetries == nullptr)
+          {
+            continue;
+          }
+
+          const auto axialBinIndex = binIndexInView - tangIndex;
+
+          for (const auto& symmetricLOR :
+               symmetries->getSymmetricLORs(view, tangIndex))
+          {
+            symmetries->mapPath(
+              symmetricLOR.symmetry,
+              pathElements,
+              mappedPathElements);
+
+            const auto imageBinIndex =
+              symmetricLOR.view * nBinsPerView + axialBinIndex +
+              symmetricLOR.tangIndex;
+
+            backProjectRatio(
+              mappedPathElements,
+              coordOffset,
+              symmetricLOR.swapped ? -seg : seg,
+              imageBinIndex,
+              inputProj,
+              outputVol,
+              biasProj,
+              backProj);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Symmetries used by the symmetric projector, if selected
+static std::optional<Symmetries> getSymmetries(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  const OSEMCoreParams& params)
+{
+  if (params.projector != projections::Projector::SYMMETRIC)
+  {
+    return std::nullopt;
+  }
+
+  std::optional<Symmetries> symmetries{
+    std::in_place,
+    proj,
+    scanner,
+    vol,
+    params.nSubsets};
+  symmetries->printContent();
+
+  return symmetries;
+}
+
+// Schedule used by scheduled accumulation, if selected
+static std::optional<SlabSchedule> getSchedule(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const Siddon& siddon,
+  const OSEMCoreParams& params)
+{
+  if (
+    params.accumulation != projections::Accumulation::SCHEDULED)
+  {
+    return std::nullopt;
+  }
+
+  std::optional<SlabSchedule> schedule{
+    std::in_place,
+    proj,
+    scanner,
+    siddon};
+  schedule->printContent();
+
+  return schedule;
+}
+
+// LOR lists provided, checked against the configuration, or
+// computed into computedLORList otherwise
+static const LORList& getLORList(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  int nSubsets,
+  float cutRadius,
+  const LORList* lorList,
+  std::optional<LORList>& computedLORList)
+{
+  if (lorList != nullptr)
+  {
+    lorList->checkConfiguration(proj, vol, nSubsets, cutRadius);
+    return *lorList;
+  }
+
+  computedLORList.emplace(
+    proj,
+    scanner,
+    vol,
+    nSubsets,
+    cutRadius);
+  computedLORList->printContent();
+
+  return *computedLORList;
+}
+
+// LORs of lorList whose bin of inputProj is not zero, whose
+// ratios add nothing to the back projections
+// With the symmetric projector, fundamental LORs carry their
+// images and are all kept
+static const LORList& getNonZeroLORList(
+  const ProjData& inputProj,
+  const LORList& lorList,
+  const OSEMCoreParams& params,
+  std::optional<LORList>& nonZeroLORList)
+{
+  if (params.projector == projections::Projector::SYMMETRIC)
+  {
+    return lorList;
+  }
+
+  nonZeroLORList.emplace(lorList, inputProj);
+  nonZeroLORList->printContent();
+
+  return *nonZeroLORList;
+}
+
+// Schedulers of the packets of the LOR lists of each subset
+static std::vector<TileScheduler> getSchedulers(
+  const ProjData& proj,
+  const Siddon& siddon,
+  const LORList& lorList,
+  const OSEMCoreParams& params)
+{
+  std::vector<TileScheduler> schedulers;
+  LOOP(subset, 0, params.nSubsets - 1)
   {
-    line = 0.0;
+    schedulers.emplace_back(
+      proj,
+      lorList,
+      subset,
+      siddon.getPacketSize(),
+      params.tileSize);
   }
 
-  return {binIndex, line};
+  return schedulers;
+}
+
+// Ray cache used by the packet projector, if selected
+static std::optional<RayCache> getRayCache(
+  const ProjData& proj,
+  const ScannerData& scanner,
+  const VolData& vol,
+  const LORList& lorList,
+  const OSEMCoreParams& params,
+  double clipRadius)
+{
+  if (
+    !params.useRayCache ||
+    params.projector != projections::Projector::PACKET ||
+    params.accumulation == projections::Accumulation::SCHEDULED)
+  {
+    return std::nullopt;
+  }
+
+  std::optional<RayCache> rayCache{
+    std::in_place,
+    proj,
+    scanner,
+    vol,
+    lorList,
+    params.maxRayCacheMemoryMB,
+    clipRadius};
+  rayCache->printContent();
+
+  return rayCache;
+}
+
+// Back-project the ratios of inputProj to the line integrals
+// of outputVol (plus bias) of all LORs of a subset into
+// backProj
+static void backProjectRatios(
+  int subset,
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  const VolData& outputVol,
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix,
+  const RayCache* rayCache,
+  const OSEMCoreParams& params,
+  const Siddon& siddon,
+  const Symmetries* symmetries,
+  const SlabSchedule* schedule,
+  const TileScheduler& scheduler,
+  const LORCache& cache,
+  const LORList& lorList,
+  VolAccumulator& backProj)
+{
+  if (schedule != nullptr)
+  {
+    schedule->forEachLOR(
+      subset,
+      params.nSubsets,
+      inputProj,
+      scanner,
+      siddon,
+      cache,
+      lorList,
+      systemMatrix,
+      [&](
+        int seg,
+        int binIndex,
+        const types::PathElement* pathElements)
+      {
+        backProjectRatio(
+          pathElements,
+          0,
+          seg,
+          binIndex,
+          inputProj,
+          outputVol,
+          biasProj,
+          backProj);
+      });
+    return;
+  }
+
+  if (
+    params.projector == projections::Projector::FACTORIZED ||
+    params.projector == projections::Projector::SYMMETRIC)
+  {
+    backProjectRatiosFactorized(
+      subset,
+      inputProj,
+      scanner,
+      outputVol,
+      biasProj,
+      systemMatrix,
+      params.nSubsets,
+      siddon,
+      symmetries,
+      cache,
+      lorList,
+      backProj);
+    backProj.reduce();
+    return;
+  }
+
+  const auto packetSize = siddon.getPacketSize();
+
+  // Packets of consecutive LORs of the list of the subset
+  scheduler.run(
+    [&](int seg, int packetIndex)
+    {
+      const auto nLORs = lorList.getNLORs(subset, seg);
+
+      types::PathElement*
+        threadLocalPathElements[Siddon::MAX_PACKET_SIZE];
+      LOOP(lane, 0, packetSize - 1)
+      {
+        threadLocalPathElements[lane] =
+          siddon.getThreadLocalPathElements(lane);
+      }
+
+      const auto firstPosition = packetIndex * packetSize;
+      const auto nLORsInPacket =
+        MIN(packetSize, nLORs - firstPosition);
+
+      int binIndices[Siddon::MAX_PACKET_SIZE];
+      types::VoxelValue lines[Siddon::MAX_PACKET_SIZE];
+      const types::PathElement*
+        pathElements[Siddon::MAX_PACKET_SIZE];
+
+      getLines(
+        subset,
+        seg,
+        firstPosition,
+        nLORsInPacket,
+        cache,
+        lorList,
+        siddon,
+        systemMatrix,
+        rayCache,
+        scanner,
+        threadLocalPathElements,
+        outputVol,
+        binIndices,
+        lines,
+        pathElements);
+
+      LOOP(lane, 0, nLORsInPacket - 1)
+      {
+        const auto binIndex = binIndices[lane];
+        auto line = lines[lane];
+
+        // Add bias if biasProj is provided
+        if (biasProj != std::nullopt)
+        {
+          line += BIN(*biasProj, seg, binIndex);
+        }
+
+        // Compute ratio with input projection and project
+        // into backProj
+        if (line > EPSILON)
+        {
+          backProj.projectLineIntegral(
+            pathElements[lane],
+            inputProj.getWeightedBin(seg, binIndex) / line);
+        }
+      }
+    });
+
+  backProj.reduce();
 }
 
 namespace reconAlgos
@@ -67,7 +672,34 @@ void OSEM(
   const std::string& outputVolFileName,
   const OSEMCoreParams& params,
   const VolData& sensitivityMap,
-  const std::optional<ProjData>& biasProj)
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix,
+  const LORList* lorList)
+{
+  SensitivityStore sensitivityStore(sensitivityMap);
+
+  OSEM(
+    inputProj,
+    scanner,
+    outputVol,
+    outputVolFileName,
+    params,
+    sensitivityStore,
+    biasProj,
+    systemMatrix,
+    lorList);
+}
+
+void OSEM(
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  const std::string& outputVolFileName,
+  const OSEMCoreParams& params,
+  SensitivityStore& sensitivityStore,
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix,
+  const LORList* lorList)
 {
   echo("OSEM:");
 
@@ -77,6 +709,15 @@ void OSEM(
   // Check number of subsets
   inputProj.checkNSubsets(params.nSubsets);
 
+  // Check system matrix configuration
+  if (systemMatrix != nullptr)
+  {
+    systemMatrix->checkConfiguration(
+      inputProj,
+      outputVol,
+      params.nSubsets);
+  }
+
   const auto convolveFlag = //
     params.convolutionInterval > 0 && params.fwhmXYZ[0] > 0.0 &&
     params.fwhmXYZ[1] > 0.0 && params.fwhmXYZ[2] > 0.0;
@@ -86,13 +727,70 @@ void OSEM(
     outputVol,
     VolData::ConstructionMode::INITIALIZE,
     0.0);
+  VolAccumulator accumulator(
+    backProj,
+    params.accumulation,
+    params.maxAccumulationMemoryMB);
+  if (params.accumulation == projections::Accumulation::PRIVATE)
+  {
+    accumulator.printContent();
+  }
 
-  // Initialize siddon algorithm and LOR list
+  // Initialize siddon algorithm and LOR lists
+  // Voxels outside the cut cylinder are kept at zero: Rays are
+  // clipped to the cylinder and LORs missing it are left out
   LORCache cache(inputProj, params.nSubsets);
-  Siddon siddon(outputVol);
+  Siddon siddon(outputVol, params.cutRadius);
+  std::optional<LORList> computedLORList;
+  const auto& allLORLists = getLORList(
+    inputProj,
+    scanner,
+    outputVol,
+    params.nSubsets,
+    params.cutRadius,
+    lorList,
+    computedLORList);
+  std::optional<LORList> nonZeroLORList;
+  const auto& lorLists = getNonZeroLORList(
+    inputProj,
+    allLORLists,
+    params,
+    nonZeroLORList);
+  const auto symmetries =
+    getSymmetries(inputProj, scanner, outputVol, params);
+  const auto schedule =
+    getSchedule(inputProj, scanner, siddon, params);
+  const auto schedulers =
+    getSchedulers(inputProj, siddon, lorLists, params);
+  if (
+    params.projector == projections::Projector::PACKET &&
+    !schedule)
+  {
+    schedulers[0].printContent();
+  }
+  const auto rayCache = getRayCache(
+    inputProj,
+    scanner,
+    outputVol,
+    lorLists,
+    params,
+    params.cutRadius);
 
   // Cut circle at the center of the image
-  operations::cutCircle(outputVol, params.cutRadius);
+  const auto circleRows =
+    operations::getCircleRows(outputVol, params.cutRadius);
+  operations::cutCircle(outputVol, circleRows);
+
+  // Gaussian kernel of the convolutions
+  GaussianFilter filter(
+    outputVol,
+    params.fwhmXYZ,
+    params.cutRadius,
+    params.convolutionBackend);
+  printValue(
+    "Convolution backend",
+    GaussianFilter::getBackendName(filter.getBackend()));
+  printEmptyLine();
 
   const auto nSubiterations =
     params.nIterations * params.nSubsets;
@@ -116,73 +814,42 @@ void OSEM(
           params.nSubsets);
       }
 
-      LOOP_SEG(seg, inputProj)
-      {
-        const auto nBinsForCurrentSubsetAndSegment =
-          cache.setSubsetAndSegment(subset, seg);
-
-        types::PathElement* threadLocalPathElements{nullptr};
-
-#pragma omp parallel for firstprivate(threadLocalPathElements)
-        LOOP(index, 0, nBinsForCurrentSubsetAndSegment - 1)
-        {
-          if (threadLocalPathElements == nullptr)
-          {
-            threadLocalPathElements =
-              siddon.getThreadLocalPathElements();
-          }
-
-          auto [binIndex, line] = getLine(
-            index,
-            cache,
-            siddon,
-            scanner,
-            threadLocalPathElements,
-            iter == 0,
-            outputVol);
-
-          // Add bias if biasProj is provided
-          if (biasProj != std::nullopt)
-          {
-            line += BIN(*biasProj, seg, binIndex);
-          }
-
-          // Compute ratio with input projection and project
-          // into backProj
-          if (line > EPSILON)
-          {
-            backProj.projectLineIntegral(
-              threadLocalPathElements,
-              BIN(inputProj, seg, binIndex) / line);
-          }
-        }
-      }
-
-      // Divide backProj by sensitivity
-      sensitivityMap.setActiveFrame(subset);
-      backProj /= sensitivityMap;
+      // Back-project ratios with input projection
+      backProjectRatios(
+        subset,
+        inputProj,
+        scanner,
+        outputVol,
+        biasProj,
+        systemMatrix,
+        rayCache ? &*rayCache : nullptr,
+        params,
+        siddon,
+        symmetries ? &*symmetries : nullptr,
+        schedule ? &*schedule : nullptr,
+        schedulers[subset],
+        cache,
+        lorLists,
+        accumulator);
 
-      // Multiply output volume by backProj
-      outputVol *= backProj;
+      // Divide backProj by sensitivity, multiply output volume
+      // by backProj, cut circle at the center of the image and
+      // reset backProj to zero for next iteration in one pass
+      operations::updateOSEM(
+        outputVol,
+        backProj,
+        sensitivityStore.getFrame(subset),
+        circleRows);
 
       // Convolve output image with a gaussian kernel
       if (
         convolveFlag &&
         subiter % params.convolutionInterval == 0)
       {
-        operations::convolve(
-          outputVol,
-          params.fwhmXYZ,
-          params.cutRadius);
-      }
-
-      // Cut circle at the center of the image
-      operations::cutCircle(outputVol, params.cutRadius);
+        filter.apply(outputVol);
 
-      // Reset backProj to zero for next iteration
-      if (subiter != nSubiterations)
-      {
-        backProj.setAllVoxels(0.0);
+        // Cut circle at the center of the image
+        operations::cutCircle(outputVol, circleRows);
       }
 
       // Save intermediate result if requested
@@ -207,7 +874,9 @@ void OSEM_ResoReco(
   const std::string& outputVolFileName,
   const OSEMCoreParams& params,
   VolData& sensitivityMap,
-  const std::optional<ProjData>& biasProj)
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix,
+  const LORList* lorList)
 {
   echo("OSEM_ResoReco:");
 
@@ -217,28 +886,114 @@ void OSEM_ResoReco(
   // Check number of subsets
   inputProj.checkNSubsets(params.nSubsets);
 
+  // Check system matrix configuration
+  if (systemMatrix != nullptr)
+  {
+    systemMatrix->checkConfiguration(
+      inputProj,
+      outputVol,
+      params.nSubsets);
+  }
+
   const auto convolveFlag = params.convolutionInterval > 0 &&
     params.fwhmXYZ[0] > 0.0 && params.fwhmXYZ[1] > 0.0 &&
     params.fwhmXYZ[2] > 0.0;
 
-  // Initialize siddon algorithm and LOR list
+  // Initialize siddon algorithm and LOR lists
   LORCache cache(inputProj, params.nSubsets);
   Siddon siddon(outputVol);
+  // Back projections are convolved: LORs missing the cut
+  // cylinder are kept
+  std::optional<LORList> computedLORList;
+  const auto& allLORLists = getLORList(
+    inputProj,
+    scanner,
+    outputVol,
+    params.nSubsets,
+    0.0,
+    lorList,
+    computedLORList);
+  std::optional<LORList> nonZeroLORList;
+  const auto& lorLists = getNonZeroLORList(
+    inputProj,
+    allLORLists,
+    params,
+    nonZeroLORList);
+  const auto symmetries =
+    getSymmetries(inputProj, scanner, outputVol, params);
+  const auto schedule =
+    getSchedule(inputProj, scanner, siddon, params);
+  const auto schedulers =
+    getSchedulers(inputProj, siddon, lorLists, params);
+  if (
+    params.projector == projections::Projector::PACKET &&
+    !schedule)
+  {
+    schedulers[0].printContent();
+  }
+  const auto rayCache = getRayCache(
+    inputProj,
+    scanner,
+    outputVol,
+    lorLists,
+    params,
+    0.0);
 
   // Initialize empty volume for back-projection
   VolData backProj(
     outputVol,
     VolData::ConstructionMode::INITIALIZE,
     0.0);
+  VolAccumulator accumulator(
+    backProj,
+    params.accumulation,
+    params.maxAccumulationMemoryMB);
+  if (params.accumulation == projections::Accumulation::PRIVATE)
+  {
+    accumulator.printContent();
+  }
 
   // Cut circle at the center of the image
-  operations::cutCircle(outputVol, params.cutRadius);
+  const auto circleRows =
+    operations::getCircleRows(outputVol, params.cutRadius);
+  operations::cutCircle(outputVol, circleRows);
 
-  // Convolve sensitivity image with a gaussian kernel
-  operations::convolve(
-    sensitivityMap,
+  // Gaussian kernel of the convolutions
+  GaussianFilter filter(
+    outputVol,
     params.fwhmXYZ,
-    params.cutRadius);
+    params.cutRadius,
+    params.convolutionBackend);
+  printValue(
+    "Convolution backend",
+    GaussianFilter::getBackendName(filter.getBackend()));
+  printEmptyLine();
+
+  // Resolution model: the gaussian kernel, or the measured PSF
+  // kernel and its adjoint
+  std::optional<GaussianFilter> psfFilter;
+  std::optional<GaussianFilter> psfAdjointFilter;
+  if (!params.psfKernelFile.empty())
+  {
+    const VolData psfKernel(params.psfKernelFile);
+    psfFilter.emplace(
+      outputVol,
+      psfKernel,
+      params.fwhmXYZ,
+      params.cutRadius);
+    psfAdjointFilter.emplace(
+      outputVol,
+      psfKernel,
+      params.fwhmXYZ,
+      params.cutRadius,
+      true);
+  }
+  auto& modelFilter = psfFilter ? *psfFilter : filter;
+  auto& adjointFilter =
+    psfAdjointFilter ? *psfAdjointFilter : filter;
+
+  // Convolve sensitivity image with the resolution model
+  adjointFilter.apply(sensitivityMap);
 
   // Initialize copy of output volume used for blurring
   VolData blur(outputVol, VolData::ConstructionMode::READ_DATA);
@@ -265,89 +1020,54 @@ void OSEM_ResoReco(
           params.nSubsets);
       }
 
-      operations::convolve(
-        blur,
-        params.fwhmXYZ,
-        params.cutRadius);
-
-      LOOP_SEG(seg, inputProj)
-      {
-        const auto nBinsForCurrentSubsetAndSegment =
-          cache.setSubsetAndSegment(subset, seg);
+      modelFilter.apply(blur);
 
-        types::PathElement* threadLocalPathElements{nullptr};
+      // Back-project ratios with input projection, forward
+      // projecting the blurred volume
+      backProjectRatios(
+        subset,
+        inputProj,
+        scanner,
+        blur,
+        biasProj,
+        systemMatrix,
+        rayCache ? &*rayCache : nullptr,
+        params,
+        siddon,
+        symmetries ? &*symmetries : nullptr,
+        schedule ? &*schedule : nullptr,
+        schedulers[subset],
+        cache,
+        lorLists,
+        accumulator);
 
-#pragma omp parallel for firstprivate(threadLocalPathElements)
-        LOOP(index, 0, nBinsForCurrentSubsetAndSegment - 1)
-        {
-          if (threadLocalPathElements == nullptr)
-          {
-            threadLocalPathElements =
-              siddon.getThreadLocalPathElements();
-          }
+      // Convolve back-projection with the resolution model
+      adjointFilter.apply(backProj);
 
-          auto [binIndex, line] = getLine(
-            index,
-            cache,
-            siddon,
-            scanner,
-            threadLocalPathElements,
-            iter == 0,
-            outputVol);
-
-          // Add bias if biasProj is provided
-          if (biasProj != std::nullopt)
-          {
-            line += BIN(*biasProj, seg, binIndex);
-          }
+      const auto convolveOutput = convolveFlag &&
+        subiter % params.convolutionInterval == 0;
 
-          // Compute ratio with input projection and project
-          // into backProj
-          if (line > EPSILON)
-          {
-            backProj.projectLineIntegral(
-              threadLocalPathElements,
-              BIN(inputProj, seg, binIndex) / line);
-          }
-        }
-      }
-
-      // Convolve back-projection with a gaussian kernel
-      operations::convolve(
-        backProj,
-        params.fwhmXYZ,
-        params.cutRadius);
-
-      // Divide backProj by sensitivity
+      // Divide output volume by sensitivity, multiply it by
+      // backProj, cut circle at the center of the image, reset
+      // backProj to zero and set blur to output volume for next
+      // iteration in one pass
       sensitivityMap.setActiveFrame(subset);
-      outputVol /= sensitivityMap;
-
-      // Multiply output volume by backProj
-      outputVol *= backProj;
-
-      // Reset backProj to zero for next iteration
-      if (subiter != nSubiterations)
-      {
-        backProj.setAllVoxels(0.0);
-      }
+      operations::updateOSEM_ResoReco(
+        outputVol,
+        backProj,
+        sensitivityMap,
+        circleRows,
+        convolveOutput ? nullptr : &blur);
 
       // Convolve output image with a gaussian kernel
-      if (
-        convolveFlag &&
-        subiter % params.convolutionInterval == 0)
+      if (convolveOutput)
       {
-        operations::convolve(
-          outputVol,
-          params.fwhmXYZ,
-          params.cutRadius);
-      }
+        filter.apply(outputVol);
 
-      // Cut circle at the center of the image
-      operations::cutCircle(outputVol, params.cutRadius);
+        // Cut circle at the center of the image
+        operations::cutCircle(outputVol, circleRows);
 
-      // Set blur to output volume for next iteration
-      if (subiter != nSubiterations)
-      {
+        // Set blur to output volume for next iteration
         blur.assign(outputVol);
       }
 
@@ -1,6 +1,11 @@
+#include <GaussianFilter.h>
+#include <LORList.h>
 #include <ProjData.h>
 #include <ScannerData.h>
+#include <SensitivityStore.h>
+#include <SystemMatrix.h>
 #include <VolData.h>
+#include <projections.h>
 
 #include <optional>
 #include <string>
@@ -15,10 +20,27 @@ struct OSEMCoreParams
   // Save parameters
   int saveInterval{0};
 
+  // Projection parameters
+  projections::Projector projector{
+    projections::Projector::PACKET};
+  int tileSize{0};
+  projections::Accumulation accumulation{
+    projections::Accumulation::ATOMIC};
+  double maxAccumulationMemoryMB{0.0};
+  bool useRayCache{false};
+  double maxRayCacheMemoryMB{0.0};
+
   // Operation parameters
   float cutRadius{0.0};
   int convolutionInterval{0};
   std::vector<float> fwhmXYZ{0.0, 0.0, 0.0};
+  GaussianFilter::Backend convolutionBackend{
+    GaussianFilter::Backend::AUTO};
+
+  // Measured PSF kernel volume of OSEM_ResoReco (see
+  // GaussianFilter), replacing the gaussian kernel of the
+  // resolution model if provided
+  std::string psfKernelFile;
 };
 
 namespace reconAlgos
@@ -26,6 +48,15 @@ namespace reconAlgos
 // Iterative reconstruction
 // -> biasProj is given as pointer to allow a default value
 // (no bias)
+// -> systemMatrix is optional: LORs whose rows are not stored
+// are traced with Siddon
+// -> lorList is optional: If not provided, the lists of the
+// LORs crossing the volume are computed at the start (OSEM
+// also leaves out the LORs missing the cut cylinder, so that
+// lists provided to OSEM must have the cut radius of params,
+// and lists provided to OSEM_ResoReco no cut radius)
+// -> LORs whose bin of inputProj is zero are left out of the
+// iterations, except with the symmetric projector
 void OSEM(
   const ProjData& inputProj,
   const ScannerData& scanner,
@@ -33,7 +64,22 @@ void OSEM(
   const std::string& outputVolFileName,
   const OSEMCoreParams& params,
   const VolData& sensitivityMap,
-  const std::optional<ProjData>& biasProj);
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix = nullptr,
+  const LORList* lorList = nullptr);
+
+// Same with the sensitivity map of each subset taken from a
+// store, possibly compact or computed on demand
+void OSEM(
+  const ProjData& inputProj,
+  const ScannerData& scanner,
+  VolData& outputVol,
+  const std::string& outputVolFileName,
+  const OSEMCoreParams& params,
+  SensitivityStore& sensitivityStore,
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix = nullptr,
+  const LORList* lorList = nullptr);
 
 void OSEM_ResoReco(
   const ProjData& inputProj,
@@ -42,5 +88,7 @@ void OSEM_ResoReco(
   const std::string& outputVolFileName,
   const OSEMCoreParams& params,
   VolData& sensitivityMap,
-  const std::optional<ProjData>& biasProj);
+  const std::optional<ProjData>& biasProj,
+  const SystemMatrix* systemMatrix = nullptr,
+  const LORList* lorList = nullptr);
 }
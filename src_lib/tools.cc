@@ -1,5 +1,7 @@
 #include <tools.h>
 
+#include <cstring>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -36,6 +38,77 @@ void addPath(
   }
 }
 
+std::uint64_t hashBytes(
+  const void* data,
+  std::size_t size,
+  std::uint64_t seed)
+{
+  const auto* bytes = static_cast<const unsigned char*>(data);
+
+  auto hash = seed;
+  for (std::size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+std::uint16_t floatToHalf(float value)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const std::uint32_t sign = (bits >> 16) & 0x8000;
+  const int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7fffff;
+
+  // Infinity or NaN
+  if (((bits >> 23) & 0xff) == 0xff)
+  {
+    return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+  }
+
+  // Overflow
+  if (exponent >= 31)
+  {
+    return sign | 0x7c00;
+  }
+
+  // Subnormal half, or zero if less than half the smallest
+  if (exponent <= 0)
+  {
+    if (exponent < -10)
+    {
+      return sign;
+    }
+
+    mantissa |= 0x800000;
+    const auto shift = 14 - exponent;
+    std::uint32_t half = mantissa >> shift;
+    const auto rest = mantissa & ((1u << shift) - 1);
+    const auto halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+    {
+      half++;
+    }
+
+    return sign | half;
+  }
+
+  // Rounding up may carry into the exponent, as it should
+  std::uint32_t half = ((std::uint32_t)exponent << 10) |
+    (mantissa >> 13);
+  const auto rest = mantissa & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+  {
+    half++;
+  }
+
+  return sign | half;
+}
+
 int getNThreads()
 {
   int nThreads = 0;
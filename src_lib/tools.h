@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 /// String utilities
@@ -24,6 +26,22 @@ void addPath(
   const std::string& headerFile,
   std::string& dataFile);
 
+/// Hashing utilities
+
+// 64-bit FNV-1a hash of a block of memory
+// Chain calls by passing the previous result as seed
+std::uint64_t hashBytes(
+  const void* data,
+  std::size_t size,
+  std::uint64_t seed = 14695981039346656037ull);
+
+/// Half precision utilities
+
+// IEEE half float nearest to a float (ties to even)
+std::uint16_t floatToHalf(float value);
+
+inline float halfToFloat(std::uint16_t half);
+
 /// Multi-threading utilities
 
 int getNThreads();
@@ -2,6 +2,8 @@
 
 #include <tools.h>
 
+#include <cmath>
+#include <cstring>
 #include <limits.h>
 
 template<typename T>
@@ -24,3 +26,27 @@ T swapEndianness(T u)
 
   return dest.u;
 }
+
+float halfToFloat(std::uint16_t half)
+{
+  const std::uint32_t sign = (std::uint32_t)(half & 0x8000)
+    << 16;
+  const int exponent = (half >> 10) & 0x1f;
+  const std::uint32_t mantissa = half & 0x3ff;
+
+  if (exponent == 0)
+  {
+    const auto value = std::ldexp((float)mantissa, -24);
+    return sign != 0 ? -value : value;
+  }
+
+  const std::uint32_t bits = exponent == 31 ?
+    sign | 0x7f800000 | (mantissa << 13) :
+    sign | ((std::uint32_t)(exponent - 15 + 127) << 23) |
+      (mantissa << 13);
+
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
@@ -69,10 +69,19 @@ struct SpatialCoords2D
 
 // === Siddon ===
 
+// Precision of path lengths and of the arithmetic of Siddon
+// Single precision (FIR_SINGLE_PRECISION_PATHS) gives 8-byte
+// path elements, halving path and system matrix memory
+#ifdef FIR_SINGLE_PRECISION_PATHS
+using PathExtent = float;
+#else
+using PathExtent = SpatialExtent;
+#endif
+
 struct PathElement
 {
   Index coord;
-  SpatialExtent length;
+  PathExtent length;
 };
 }
 
@@ -0,0 +1,1906 @@
+#include <GaussianFilter.h>
+#include <LORCache.h>
+#include <LORList.h>
+#include <OccupancyGrid.h>
+#include <PrecomputationCache.h>
+#include <ProjData.h>
+#include <RayCache.h>
+#include <ScannerData.h>
+#include <SensitivityStore.h>
+#include <Siddon.h>
+#include <SlabSchedule.h>
+#include <Symmetries.h>
+#include <SystemMatrix.h>
+#include <TileScheduler.h>
+#include <VolData.h>
+#include <macros.h>
+#include <operations.h>
+#include <projections.h>
+#include <reconAlgos.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+// Single precision paths (FIR_SINGLE_PRECISION_PATHS) are
+// traced in double by packets and in single precision otherwise
+const double TOLERANCE =
+  std::is_same_v<types::PathExtent, float> ? 1e-4 : 1e-5;
+
+// Planes crossed at the same point within Siddon's tolerance
+// can be split differently by the factorized projector
+const double FACTORIZED_TOLERANCE = 1e-4;
+
+// Small scanner with 96 crystals per ring and 8 rings
+const std::string SCANNER_HEADER{
+  "!SCANNER PARAMETERS :=\n"
+  "crystal dimensions XYZ in mm := {20, 4, 4}\n"
+  "crystal repeat numbers YZ := {6, 8}\n"
+  "rSector repeat number := 16\n"
+  "rSector inner radius in mm := 120\n"
+  "!END OF SCANNER PARAMETERS :=\n"};
+
+const std::string PROJ_HEADER{
+  "!PROJECTION DATA PARAMETERS :=\n"
+  "name of data file :=\n"
+  "number of rings := 8\n"
+  "number of crystals per ring := 96\n"
+  "segment span := 3\n"
+  "number of segments := 3\n"
+  "number of tangential coordinates := 61\n"
+  "!END OF PROJECTION DATA PARAMETERS :=\n"};
+
+std::string writeTempFile(
+  const std::string& name,
+  const std::string& content)
+{
+  const auto fileName = testing::TempDir() + name;
+
+  std::ofstream os(fileName);
+  os << content;
+
+  return fileName;
+}
+
+double maxRelativeDifference(
+  const ProjData& proj1,
+  const ProjData& proj2)
+{
+  double maxDiff{0.0};
+  double maxValue{0.0};
+
+  LOOP_SEG(seg, proj1)
+  {
+    const auto nBinsInSegment =
+      proj1.getGeometry().nViews *
+      proj1.getGeometry().getNAxialCoords(seg) *
+      proj1.getHeader().nTangCoords;
+
+    LOOP(binIndex, 0, nBinsInSegment - 1)
+    {
+      const double value1 = BIN(proj1, seg, binIndex);
+      const double value2 = BIN(proj2, seg, binIndex);
+
+      maxDiff = MAX(maxDiff, ABS(value1 - value2));
+      maxValue = MAX(maxValue, ABS(value1));
+    }
+  }
+
+  return maxDiff / maxValue;
+}
+
+double maxRelativeDifference(
+  const VolData& vol1,
+  const VolData& vol2)
+{
+  double maxDiff{0.0};
+  double maxValue{0.0};
+
+  LOOP(frame, 0, vol1.getNFrames() - 1)
+  {
+    vol1.setActiveFrame(frame);
+    vol2.setActiveFrame(frame);
+
+    LOOP(i, 0, vol1.getNVoxelsPerFrame() - 1)
+    {
+      const double value1 = vol1.getDataArray()[i];
+      const double value2 = vol2.getDataArray()[i];
+
+      maxDiff = MAX(maxDiff, ABS(value1 - value2));
+      maxValue = MAX(maxValue, ABS(value1));
+    }
+  }
+
+  return maxDiff / maxValue;
+}
+}
+
+class ProjectionsTest: public testing::Test
+{
+protected:
+
+  ProjectionsTest():
+    mScanner(writeTempFile("scanner.hs", SCANNER_HEADER)),
+    mProj(
+      writeTempFile("proj.hs", PROJ_HEADER),
+      ProjData::ConstructionMode::INITIALIZE),
+    mVol(VolHeader{
+      {   40,    40,  15},
+      {  4.0,   4.0, 2.0},
+      {-78.0, -78.0, 0.0},
+      1
+    })
+  {
+    // Random activity
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0, 1);
+    LOOP(i, 0, mVol.getNVoxelsPerFrame() - 1)
+    {
+      mVol.getDataArray()[i] = distribution(generator);
+    }
+  }
+
+  ScannerData mScanner;
+  ProjData mProj;
+  VolData mVol;
+};
+
+// Forward projection is the same with and without system matrix
+TEST_F(ProjectionsTest, ForwardWithSystemMatrix)
+{
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+
+  // Complete matrix and matrix limited by memory budget
+  for (const auto maxMemoryMB : {0.0, 25.0})
+  {
+    SystemMatrix systemMatrix(
+      mProj,
+      mScanner,
+      mVol,
+      1,
+      maxMemoryMB);
+
+    ProjData proj(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+    projections::forward(mVol, mScanner, proj, &systemMatrix);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, proj),
+      TOLERANCE);
+  }
+}
+
+// Back projection is the same with and without system matrix
+TEST_F(ProjectionsTest, BackwardWithSystemMatrix)
+{
+  const auto nSubsets = 4;
+
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, reference, nSubsets);
+
+  SystemMatrix systemMatrix(mProj, mScanner, mVol, nSubsets);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    mProj,
+    mScanner,
+    vol,
+    nSubsets,
+    &systemMatrix);
+
+  EXPECT_LT(maxRelativeDifference(reference, vol), TOLERANCE);
+}
+
+// Factorized projector gives the same forward projection, with
+// and without system matrix
+TEST_F(ProjectionsTest, ForwardFactorized)
+{
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+
+  SystemMatrix systemMatrix(mProj, mScanner, mVol, 1, 25.0);
+
+  const SystemMatrix* systemMatrices[]{nullptr, &systemMatrix};
+  for (const auto* systemMatrixPtr : systemMatrices)
+  {
+    ProjData proj(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+    projections::forward(
+      mVol,
+      mScanner,
+      proj,
+      systemMatrixPtr,
+      projections::Projector::FACTORIZED);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, proj),
+      FACTORIZED_TOLERANCE);
+  }
+}
+
+// LORs reported as crossing empty bricks only are traced
+// through zero voxels only
+TEST_F(ProjectionsTest, OccupancyGrid)
+{
+  // Single voxel not zero
+  const auto& volSize = mVol.getHeader().volSize;
+  const auto voxel =
+    (7 * volSize.nPixelsY + 13) * volSize.nPixelsX + 25;
+  std::fill_n(
+    mVol.getDataArray(),
+    mVol.getNVoxelsPerFrame(),
+    0.0);
+  mVol.getDataArray()[voxel] = 1.0;
+
+  const OccupancyGrid occupancyGrid(mVol);
+  Siddon siddon(mVol);
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> distribution(
+    -150.0,
+    150.0);
+
+  auto* pathElements = siddon.getThreadLocalPathElements();
+  auto nCrossing = 0;
+  auto nSkipped = 0;
+
+  LOOP(lorIndex, 0, 9999)
+  {
+    double crys1[3], crys2[3];
+    LOOP(dim, 0, 2)
+    {
+      crys1[dim] = distribution(generator);
+      crys2[dim] = distribution(generator);
+    }
+
+    const auto crossesOccupied = occupancyGrid.crossesOccupied(
+      crys1[0],
+      crys1[1],
+      crys1[2],
+      crys2[0],
+      crys2[1],
+      crys2[2]);
+
+    siddon.computePath(
+      crys1[0],
+      crys1[1],
+      crys1[2],
+      crys2[0],
+      crys2[1],
+      crys2[2],
+      pathElements);
+
+    auto crossesVoxel = false;
+    for (auto i = 0; pathElements[i].coord != -1; ++i)
+    {
+      crossesVoxel |= pathElements[i].coord == voxel;
+    }
+
+    ASSERT_TRUE(crossesOccupied || !crossesVoxel);
+    nCrossing += crossesVoxel;
+    nSkipped += !crossesOccupied;
+  }
+
+  EXPECT_GT(nCrossing, 0);
+  EXPECT_GT(nSkipped, 0);
+}
+
+// Forward projection skipping empty space is the same
+TEST_F(ProjectionsTest, ForwardSkipEmptySpace)
+{
+  // Activity in a box of the volume only
+  const auto& volSize = mVol.getHeader().volSize;
+  LOOP(k, 0, volSize.nSlices - 1)
+  LOOP(j, 0, volSize.nPixelsY - 1)
+  LOOP(i, 0, volSize.nPixelsX - 1)
+  {
+    if (
+      i < 22 || i >= 30 || j < 10 || j >= 18 || k < 4 ||
+      k >= 10)
+    {
+      mVol.getDataArray()
+        [(k * volSize.nPixelsY + j) * volSize.nPixelsX + i] =
+        0.0;
+    }
+  }
+
+  for (const auto projector :
+       {projections::Projector::PACKET,
+        projections::Projector::FACTORIZED})
+  {
+    ProjData reference(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+    projections::forward(
+      mVol,
+      mScanner,
+      reference,
+      nullptr,
+      projector);
+
+    ProjData proj(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+    projections::forward(
+      mVol,
+      mScanner,
+      proj,
+      nullptr,
+      projector,
+      0,
+      nullptr,
+      true);
+
+    EXPECT_EQ(maxRelativeDifference(reference, proj), 0.0);
+  }
+}
+
+// Projections of several frames traced at once are the same as
+// the projections of each frame
+TEST_F(ProjectionsTest, ProjectFrames)
+{
+  const auto nFrames = 3;
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nFrames);
+
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<float> distribution(0, 1);
+  LOOP(frame, 0, nFrames - 1)
+  {
+    vol.setActiveFrame(frame);
+    LOOP(i, 0, vol.getNVoxelsPerFrame() - 1)
+    {
+      vol.getDataArray()[i] = distribution(generator);
+    }
+  }
+
+  std::vector<ProjData> projs;
+  LOOP(frame, 0, nFrames - 1)
+  {
+    projs.emplace_back(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+  }
+  projections::forwardFrames(vol, mScanner, projs);
+
+  for (const auto accumulation :
+       {projections::Accumulation::ATOMIC,
+        projections::Accumulation::PRIVATE})
+  {
+    VolData backProj;
+    backProj.allocateAsMultiVol(mVol, nFrames);
+    projections::backwardFrames(
+      projs,
+      mScanner,
+      backProj,
+      accumulation);
+
+    LOOP(frame, 0, nFrames - 1)
+    {
+      vol.setActiveFrame(frame);
+      mVol.assignFrame(vol, frame);
+
+      ProjData reference(
+        mProj,
+        ProjData::ConstructionMode::ALLOCATE);
+      projections::forward(mVol, mScanner, reference);
+
+      EXPECT_LT(
+        maxRelativeDifference(reference, projs[frame]),
+        TOLERANCE);
+
+      VolData referenceBackProj(mVol);
+      projections::backward(
+        projs[frame],
+        mScanner,
+        referenceBackProj);
+
+      backProj.setActiveFrame(frame);
+      mVol.assignFrame(backProj, frame);
+
+      EXPECT_LT(
+        maxRelativeDifference(referenceBackProj, mVol),
+        TOLERANCE);
+    }
+  }
+}
+
+// Factorized projector gives the same back projection
+TEST_F(ProjectionsTest, BackwardFactorized)
+{
+  const auto nSubsets = 4;
+
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, reference, nSubsets);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    mProj,
+    mScanner,
+    vol,
+    nSubsets,
+    nullptr,
+    projections::Projector::FACTORIZED);
+
+  EXPECT_LT(
+    maxRelativeDifference(reference, vol),
+    FACTORIZED_TOLERANCE);
+}
+
+// Private accumulation gives the same back projection as
+// atomic accumulation, with and without memory budget
+TEST_F(ProjectionsTest, BackwardPrivateAccumulation)
+{
+  const auto nSubsets = 4;
+
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, reference, nSubsets);
+
+  const projections::Projector projectors[]{
+    projections::Projector::PACKET,
+    projections::Projector::FACTORIZED};
+
+  // No limit and a single partial volume
+  for (const auto projector : projectors)
+  for (const auto maxMemoryMB : {0.0, 0.1})
+  {
+    VolData vol;
+    vol.allocateAsMultiVol(mVol, nSubsets);
+    projections::backward(
+      mProj,
+      mScanner,
+      vol,
+      nSubsets,
+      nullptr,
+      projector,
+      projections::Accumulation::PRIVATE,
+      maxMemoryMB);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, vol),
+      projector == projections::Projector::PACKET ?
+        TOLERANCE :
+        FACTORIZED_TOLERANCE);
+  }
+}
+
+// LORs only cross the slices of their slice range, so that
+// the groups of a phase of the schedule don't share slices
+TEST_F(ProjectionsTest, SliceRanges)
+{
+  const Siddon siddon(mVol);
+  const auto sliceSize = mVol.getHeader().volSize.nPixelsX *
+    mVol.getHeader().volSize.nPixelsY;
+  auto* pathElements = siddon.getThreadLocalPathElements();
+
+  LOOP_SEG(seg, mProj)
+  LOOP_AXIAL(axialCoord, mProj, seg)
+  {
+    const auto [crystalAxialCoord1, crystalAxialCoord2] =
+      mProj.getCrystalAxialCoord(seg, axialCoord);
+
+    const auto [firstSlice, lastSlice] = siddon.getSliceRange(
+      mScanner,
+      crystalAxialCoord1,
+      crystalAxialCoord2);
+
+    LOOP_VIEW(view, mProj)
+    LOOP_TANG(tangCoord, mProj)
+    {
+      const auto [crystalAngCoord1, crystalAngCoord2] =
+        mProj.getCrystalAngCoord(view, tangCoord);
+
+      siddon.computePathBetweenCrystals(
+        mScanner,
+        crystalAxialCoord1,
+        crystalAngCoord1,
+        crystalAxialCoord2,
+        crystalAngCoord2,
+        pathElements);
+
+      for (auto i = 0; pathElements[i].coord != -1; ++i)
+      {
+        const auto slice = pathElements[i].coord / sliceSize;
+        ASSERT_GE(slice, firstSlice);
+        ASSERT_LE(slice, lastSlice);
+      }
+    }
+  }
+
+  const SlabSchedule schedule(mProj, mScanner, siddon);
+  EXPECT_GT(schedule.getNGroups(0, 0), 1);
+}
+
+// Scheduled accumulation gives the same back projection, with
+// and without system matrix
+TEST_F(ProjectionsTest, BackwardScheduledAccumulation)
+{
+  const auto nSubsets = 4;
+
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, reference, nSubsets);
+
+  SystemMatrix systemMatrix(mProj, mScanner, mVol, nSubsets);
+
+  const SystemMatrix* systemMatrices[]{nullptr, &systemMatrix};
+  for (const auto* systemMatrixPtr : systemMatrices)
+  {
+    VolData vol;
+    vol.allocateAsMultiVol(mVol, nSubsets);
+    projections::backward(
+      mProj,
+      mScanner,
+      vol,
+      nSubsets,
+      systemMatrixPtr,
+      projections::Projector::PACKET,
+      projections::Accumulation::SCHEDULED);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, vol),
+      FACTORIZED_TOLERANCE);
+  }
+}
+
+// Each packet of each segment is visited once, whatever the
+// tile size
+TEST_F(ProjectionsTest, TileScheduler)
+{
+  const auto segOffset = mProj.getGeometry().segOffset;
+  const std::vector<int> nPacketsPerSegment{37, 100, 0};
+
+  for (const auto tileSize : {0, 1, 7})
+  {
+    const TileScheduler scheduler(
+      mProj,
+      nPacketsPerSegment,
+      tileSize);
+
+    std::vector<std::vector<int>> nVisits(
+      nPacketsPerSegment.size());
+    LOOP_SEG(seg, mProj)
+    {
+      nVisits[seg + segOffset].assign(
+        nPacketsPerSegment[seg + segOffset],
+        0);
+    }
+
+    scheduler.run(
+      [&](int seg, int packetIndex)
+      {
+#pragma omp atomic
+        nVisits[seg + segOffset][packetIndex]++;
+      });
+
+    for (const auto& segmentVisits : nVisits)
+    {
+      for (const auto visits : segmentVisits)
+      {
+        EXPECT_EQ(visits, 1);
+      }
+    }
+  }
+
+  // Same projections with a tile per packet
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(
+    mVol,
+    mScanner,
+    proj,
+    nullptr,
+    projections::Projector::PACKET,
+    1);
+
+  EXPECT_LT(maxRelativeDifference(reference, proj), TOLERANCE);
+}
+
+// Sensitivity map with attenuation and normalization factors is
+// the back projection of their products
+TEST_F(ProjectionsTest, SensitivityVolWithFactors)
+{
+  const auto nSubsets = 4;
+
+  ProjData attenFactors(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, attenFactors);
+
+  ProjData normFactors(
+    mProj,
+    ProjData::ConstructionMode::INITIALIZE,
+    0.5);
+
+  ProjData weights(
+    attenFactors,
+    ProjData::ConstructionMode::READ_DATA);
+  weights *= normFactors;
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(weights, mScanner, reference, nSubsets);
+
+  for (const auto projector :
+       {projections::Projector::PACKET,
+        projections::Projector::FACTORIZED})
+  {
+    VolData sensitivityMap;
+    sensitivityMap.allocateAsMultiVol(mVol, nSubsets);
+    projections::computeSensitivityVol(
+      mProj,
+      mScanner,
+      sensitivityMap,
+      nSubsets,
+      nullptr,
+      projector,
+      projections::Accumulation::ATOMIC,
+      0.0,
+      0,
+      nullptr,
+      &attenFactors,
+      &normFactors);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, sensitivityMap),
+      FACTORIZED_TOLERANCE);
+  }
+}
+
+// Bin weights applied inside the projections give the same
+// projections as weights applied to the bins in a separate
+// pass, whether full, from crystal weights or compressed
+TEST_F(ProjectionsTest, BinWeights)
+{
+  const auto nCrystalsPerRing =
+    mProj.getHeader().nCrystalsPerRing;
+
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<float> distribution(0.5, 2);
+
+  std::vector<types::BinValue> crystalWeights(nCrystalsPerRing);
+  for (auto& weight : crystalWeights)
+  {
+    weight = distribution(generator);
+  }
+
+  // Attenuation correction factors of a mu map of the order of
+  // water, and their product with the weights of the crystals
+  // of each bin
+  VolData muMap(mVol);
+  LOOP(i, 0, muMap.getNVoxelsPerFrame() - 1)
+  {
+    muMap.getDataArray()[i] *= 0.01;
+  }
+
+  ProjData attenFactors(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(muMap, mScanner, attenFactors);
+  attenFactors.exponential();
+
+  ProjData weights(
+    attenFactors,
+    ProjData::ConstructionMode::READ_DATA);
+  const auto& geometry = weights.getGeometry();
+  const auto nTangCoords = weights.getHeader().nTangCoords;
+  LOOP_SEG(seg, weights)
+  {
+    const auto nBinsPerView =
+      geometry.getNAxialCoords(seg) * nTangCoords;
+
+    LOOP(binIndex, 0, geometry.nViews * nBinsPerView - 1)
+    {
+      const auto view = binIndex / nBinsPerView;
+      const auto tangCoord =
+        binIndex % nTangCoords - geometry.tangCoordOffset;
+      const auto [crystalAngCoord1, crystalAngCoord2] =
+        weights.getCrystalAngCoord(view, tangCoord);
+
+      BIN(weights, seg, binIndex) *=
+        crystalWeights[crystalAngCoord1] *
+        crystalWeights[crystalAngCoord2];
+    }
+  }
+
+  // Forward projection
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+  reference *= weights;
+
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  proj.multiplyBinWeights(attenFactors);
+  proj.multiplyCrystalWeights(crystalWeights);
+  ASSERT_TRUE(proj.hasBinWeights());
+  projections::forward(mVol, mScanner, proj);
+
+  EXPECT_LT(maxRelativeDifference(reference, proj), TOLERANCE);
+
+  // Back projection
+  const auto nSubsets = 4;
+  VolData referenceVol;
+  referenceVol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    reference,
+    mScanner,
+    referenceVol,
+    nSubsets);
+
+  projections::forward(mVol, mScanner, mProj);
+  mProj.multiplyBinWeights(attenFactors);
+  mProj.multiplyCrystalWeights(crystalWeights);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, vol, nSubsets);
+
+  EXPECT_LT(
+    maxRelativeDifference(referenceVol, vol),
+    TOLERANCE);
+
+  // Compressed weights
+  mProj.compressBinWeights();
+
+  vol.setAllVoxelsAllFrames(0.0);
+  projections::backward(mProj, mScanner, vol, nSubsets);
+
+  EXPECT_LT(maxRelativeDifference(referenceVol, vol), 1e-3);
+
+  mProj.clearBinWeights();
+  EXPECT_FALSE(mProj.hasBinWeights());
+}
+
+// Compact and lazy sensitivity storages give the frames of the
+// full map within their precision, whichever the order of the
+// subsets and the number of frames cached
+TEST_F(ProjectionsTest, SensitivityStore)
+{
+  const auto nSubsets = 4;
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::computeSensitivityVol(
+    mProj,
+    mScanner,
+    reference,
+    nSubsets);
+
+  VolData referenceFrame;
+  referenceFrame.allocateAsMultiVol(mVol, 1);
+
+  using Storage = SensitivityStore::Storage;
+  const std::vector<std::tuple<Storage, double>> storages{
+    {Storage::HALF, 1e-3},
+    {Storage::SCALED, 1e-4},
+    {Storage::LAZY, TOLERANCE}};
+
+  for (const auto& [storage, tolerance] : storages)
+  for (const auto nCachedFrames : {1, 2})
+  {
+    SensitivityStore computedStore(
+      mProj,
+      mScanner,
+      mVol,
+      nSubsets,
+      storage,
+      nCachedFrames);
+
+    for (const auto subset : {0, 1, 2, 3, 1, 0, 0})
+    {
+      referenceFrame.assignFrame(reference, subset);
+
+      EXPECT_LT(
+        maxRelativeDifference(
+          referenceFrame,
+          computedStore.getFrame(subset)),
+        tolerance);
+    }
+  }
+
+  SensitivityStore encodedStore(reference, Storage::HALF);
+  LOOP(subset, 0, nSubsets - 1)
+  {
+    referenceFrame.assignFrame(reference, subset);
+
+    EXPECT_LT(
+      maxRelativeDifference(
+        referenceFrame,
+        encodedStore.getFrame(subset)),
+      1e-3);
+  }
+
+  EXPECT_THROW(
+    SensitivityStore(reference, Storage::LAZY),
+    std::runtime_error);
+}
+
+// Cached entries are found under the key of the same
+// configuration only, and read back as written
+TEST_F(ProjectionsTest, PrecomputationCache)
+{
+  const auto nSubsets = 4;
+
+  const PrecomputationCache cache(
+    testing::TempDir() + "precomputation_cache");
+
+  const auto sensKey = PrecomputationCache::getSensitivityKey(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets);
+  EXPECT_EQ(
+    sensKey,
+    PrecomputationCache::getSensitivityKey(
+      mProj,
+      mScanner,
+      mVol,
+      nSubsets));
+  EXPECT_NE(
+    sensKey,
+    PrecomputationCache::getSensitivityKey(
+      mProj,
+      mScanner,
+      mVol,
+      2));
+
+  const auto attenKey = PrecomputationCache::getAttenuationKey(
+    mProj,
+    mScanner,
+    mVol);
+  VolData changedVol(mVol);
+  changedVol.setVoxel(20, 20, 7, 2.0);
+  EXPECT_NE(
+    attenKey,
+    PrecomputationCache::getAttenuationKey(
+      mProj,
+      mScanner,
+      changedVol));
+
+  VolData sensitivityMap;
+  sensitivityMap.allocateAsMultiVol(mVol, nSubsets);
+  projections::computeSensitivityVol(
+    mProj,
+    mScanner,
+    sensitivityMap,
+    nSubsets);
+  cache.write("sensitivity", sensKey, sensitivityMap);
+
+  ProjData attenFactors(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, attenFactors);
+  cache.write("attenuation", attenKey, attenFactors);
+
+  ASSERT_TRUE(cache.contains("sensitivity", sensKey));
+  ASSERT_TRUE(cache.contains("attenuation", attenKey));
+  EXPECT_FALSE(cache.contains("sensitivity", attenKey));
+
+  VolData cachedMap;
+  cache.read("sensitivity", sensKey, cachedMap);
+  EXPECT_EQ(cachedMap.getNFrames(), nSubsets);
+  EXPECT_EQ(
+    maxRelativeDifference(sensitivityMap, cachedMap),
+    0.0);
+
+  ProjData cachedFactors;
+  cache.read("attenuation", attenKey, cachedFactors);
+  EXPECT_EQ(
+    maxRelativeDifference(attenFactors, cachedFactors),
+    0.0);
+
+  // Entry replaced while read, without temporary files left
+  sensitivityMap.setAllVoxelsAllFrames(1.0);
+  cache.write("sensitivity", sensKey, sensitivityMap);
+  EXPECT_TRUE(cache.contains("sensitivity", sensKey));
+  EXPECT_NE(
+    maxRelativeDifference(sensitivityMap, cachedMap),
+    0.0);
+
+  VolData replacedMap;
+  cache.read("sensitivity", sensKey, replacedMap);
+  EXPECT_EQ(
+    maxRelativeDifference(sensitivityMap, replacedMap),
+    0.0);
+
+  for (const auto& file : std::filesystem::directory_iterator(
+         testing::TempDir() + "precomputation_cache"))
+  {
+    EXPECT_NE(file.path().extension(), ".tmp");
+  }
+}
+
+// Data files read in place are left unchanged by writes to the
+// data, and can be written over while in use
+TEST_F(ProjectionsTest, MappedData)
+{
+  const auto projFile = testing::TempDir() + "mapped_proj";
+  const auto volFile = testing::TempDir() + "mapped_vol";
+
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, proj);
+  proj.write(projFile);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, 2);
+  vol.setAllVoxelsAllFrames(1.0);
+  vol.setActiveFrame(1);
+  vol.setVoxel(20, 20, 7, 2.0);
+  vol.write(volFile);
+
+  ProjData mappedProj(
+    projFile + ".hs",
+    ProjData::ConstructionMode::READ_DATA);
+  VolData mappedVol(
+    volFile + ".h33",
+    VolData::ConstructionMode::READ_DATA);
+  EXPECT_EQ(maxRelativeDifference(proj, mappedProj), 0.0);
+  EXPECT_EQ(maxRelativeDifference(vol, mappedVol), 0.0);
+
+  const auto bin = proj.getBin(0, 5, 7, 10);
+  mappedProj.setBin(0, 5, 7, 10, bin + 1);
+  mappedVol.setActiveFrame(1);
+  mappedVol.setVoxel(20, 20, 7, 3.0);
+
+  const ProjData readProj(
+    projFile + ".hs",
+    ProjData::ConstructionMode::READ_DATA);
+  VolData readVol(
+    volFile + ".h33",
+    VolData::ConstructionMode::READ_DATA);
+  EXPECT_EQ(readProj.getBin(0, 5, 7, 10), bin);
+  readVol.setActiveFrame(1);
+  EXPECT_EQ(readVol.getVoxel(20, 20, 7), 2.0);
+
+  mappedProj.write(projFile);
+  mappedVol.write(volFile);
+  EXPECT_EQ(mappedProj.getBin(0, 5, 7, 10), bin + 1);
+  EXPECT_EQ(mappedVol.getVoxel(20, 20, 7), 3.0);
+
+  const ProjData writtenProj(
+    projFile + ".hs",
+    ProjData::ConstructionMode::READ_DATA);
+  EXPECT_EQ(
+    maxRelativeDifference(mappedProj, writtenProj),
+    0.0);
+}
+
+// OSEM gives the same volume with and without ray cache, with
+// all or part of the LORs set up in advance
+TEST_F(ProjectionsTest, OSEMWithRayCache)
+{
+  projections::forward(mVol, mScanner, mProj);
+
+  OSEMCoreParams params;
+  params.nIterations = 2;
+  params.nSubsets = 4;
+
+  VolData sensitivityMap;
+  sensitivityMap.allocateAsMultiVol(mVol, params.nSubsets);
+  projections::computeSensitivityVol(
+    mProj,
+    mScanner,
+    sensitivityMap,
+    params.nSubsets);
+
+  VolData reference(
+    mVol,
+    VolData::ConstructionMode::INITIALIZE,
+    1.0);
+  reconAlgos::OSEM(
+    mProj,
+    mScanner,
+    reference,
+    "",
+    params,
+    sensitivityMap,
+    std::nullopt);
+
+  const LORList lorList(
+    mProj,
+    mScanner,
+    mVol,
+    params.nSubsets);
+  const RayCache rayCache(mProj, mScanner, mVol, lorList);
+  EXPECT_GT(rayCache.getMemoryMB(), 0.0);
+
+  params.useRayCache = true;
+  for (const auto maxMemoryMB :
+       {0.0, rayCache.getMemoryMB() / 2.0})
+  {
+    params.maxRayCacheMemoryMB = maxMemoryMB;
+
+    VolData vol(
+      mVol,
+      VolData::ConstructionMode::INITIALIZE,
+      1.0);
+    reconAlgos::OSEM(
+      mProj,
+      mScanner,
+      vol,
+      "",
+      params,
+      sensitivityMap,
+      std::nullopt);
+
+    EXPECT_LT(maxRelativeDifference(reference, vol), TOLERANCE);
+  }
+}
+
+// OSEM_ResoReco forward projects the blurred volume: A delta
+// kernel reproduces OSEM, and a sub-iteration with a measured
+// kernel is the update computed step by step
+TEST_F(ProjectionsTest, OSEMResoReco)
+{
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData kernel(VolHeader{
+    {3, 3, 3},
+    mVol.getHeader().voxelExtent,
+    {0.0, 0.0, 0.0},
+    1
+  });
+  std::fill_n(kernel.getDataArray(), 27, 0.0);
+  kernel.setVoxel(1, 1, 1, 1.0);
+  const auto deltaFile = testing::TempDir() + "delta_kernel";
+  kernel.write(deltaFile);
+
+  kernel.setVoxel(2, 1, 1, 0.5);
+  const auto kernelFile = testing::TempDir() + "psf_kernel";
+  kernel.write(kernelFile);
+
+  OSEMCoreParams params;
+  params.nIterations = 2;
+  params.nSubsets = 4;
+
+  VolData sensitivityMap;
+  sensitivityMap.allocateAsMultiVol(mVol, params.nSubsets);
+  projections::computeSensitivityVol(
+    mProj,
+    mScanner,
+    sensitivityMap,
+    params.nSubsets);
+
+  VolData reference(
+    mVol,
+    VolData::ConstructionMode::INITIALIZE,
+    1.0);
+  reconAlgos::OSEM(
+    mProj,
+    mScanner,
+    reference,
+    "",
+    params,
+    sensitivityMap,
+    std::nullopt);
+
+  params.psfKernelFile = deltaFile + ".h33";
+  VolData vol(mVol, VolData::ConstructionMode::INITIALIZE, 1.0);
+  reconAlgos::OSEM_ResoReco(
+    mProj,
+    mScanner,
+    vol,
+    "",
+    params,
+    sensitivityMap,
+    std::nullopt);
+  EXPECT_LT(maxRelativeDifference(reference, vol), TOLERANCE);
+
+  // Single sub-iteration from the activity with the measured
+  // kernel
+  params.nIterations = 1;
+  params.nSubsets = 1;
+  params.psfKernelFile = kernelFile + ".h33";
+
+  const VolData psfKernel(params.psfKernelFile);
+  GaussianFilter model(mVol, psfKernel, {0.0, 0.0, 0.0});
+  GaussianFilter adjoint(
+    mVol,
+    psfKernel,
+    {0.0, 0.0, 0.0},
+    0.0,
+    true);
+
+  VolData sensVol(mVol, VolData::ConstructionMode::INITIALIZE);
+  projections::computeSensitivityVol(mProj, mScanner, sensVol);
+
+  VolData blur(mVol);
+  model.apply(blur);
+  ProjData ratios(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(blur, mScanner, ratios);
+  LOOP_SEG(seg, ratios)
+  {
+    const auto nBinsInSegment =
+      ratios.getGeometry().nViews *
+      ratios.getGeometry().getNAxialCoords(seg) *
+      ratios.getHeader().nTangCoords;
+
+    LOOP(binIndex, 0, nBinsInSegment - 1)
+    {
+      auto& line = BIN(ratios, seg, binIndex);
+      line = line > EPSILON ?
+        BIN(mProj, seg, binIndex) / line :
+        0.0;
+    }
+  }
+  VolData backProj(
+    mVol,
+    VolData::ConstructionMode::INITIALIZE);
+  projections::backward(ratios, mScanner, backProj);
+  adjoint.apply(backProj);
+
+  // Voxels whose ratio to the sensitivity is below EPSILON are
+  // set to zero by the update
+  VolData expected(mVol);
+  adjoint.apply(sensVol);
+  LOOP(i, 0, expected.getNVoxelsPerFrame() - 1)
+  {
+    auto& value = expected.getDataArray()[i];
+    const auto ratio = value / sensVol.getDataArray()[i];
+    value = ratio > EPSILON ?
+      ratio * backProj.getDataArray()[i] :
+      0.0;
+  }
+
+  VolData resoSensVol(
+    mVol,
+    VolData::ConstructionMode::INITIALIZE);
+  projections::computeSensitivityVol(
+    mProj,
+    mScanner,
+    resoSensVol);
+  VolData resoVol(mVol);
+  reconAlgos::OSEM_ResoReco(
+    mProj,
+    mScanner,
+    resoVol,
+    "",
+    params,
+    resoSensVol,
+    std::nullopt);
+  EXPECT_LT(
+    maxRelativeDifference(expected, resoVol),
+    TOLERANCE);
+}
+
+// Lists of LORs crossing the volume give the same projections
+// as computed lists, and fewer LORs with a cut cylinder
+TEST_F(ProjectionsTest, LORList)
+{
+  const auto nSubsets = 4;
+  const LORList lorList(mProj, mScanner, mVol, nSubsets);
+  const LORList cutLORList(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    40.0);
+
+  auto nLORs = 0;
+  auto nCutLORs = 0;
+  LOOP(subset, 0, nSubsets - 1)
+  LOOP_SEG(seg, mProj)
+  {
+    nLORs += lorList.getNLORs(subset, seg);
+
+    LOOP(position, 0, cutLORList.getNLORs(subset, seg) - 1)
+    {
+      EXPECT_TRUE(lorList.contains(
+        subset,
+        seg,
+        cutLORList.getIndex(subset, seg, position)));
+      nCutLORs++;
+    }
+  }
+  EXPECT_GT(nCutLORs, 0);
+  EXPECT_LT(nCutLORs, nLORs);
+
+  EXPECT_THROW(
+    lorList.checkConfiguration(mProj, mVol, 1),
+    std::runtime_error);
+  EXPECT_THROW(
+    cutLORList.checkConfiguration(mProj, mVol, nSubsets),
+    std::runtime_error);
+  EXPECT_NO_THROW(
+    cutLORList.checkConfiguration(mProj, mVol, nSubsets, 40.0));
+
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(
+    mVol,
+    mScanner,
+    proj,
+    nullptr,
+    projections::Projector::PACKET,
+    0,
+    &lorList);
+  EXPECT_LT(maxRelativeDifference(reference, proj), TOLERANCE);
+
+  VolData referenceVol;
+  referenceVol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    reference,
+    mScanner,
+    referenceVol,
+    nSubsets);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    reference,
+    mScanner,
+    vol,
+    nSubsets,
+    nullptr,
+    projections::Projector::FACTORIZED,
+    projections::Accumulation::ATOMIC,
+    0.0,
+    0,
+    &lorList);
+  EXPECT_LT(
+    maxRelativeDifference(referenceVol, vol),
+    FACTORIZED_TOLERANCE);
+}
+
+// LORs in locality order are the same LORs as in LORCache
+// order and give the same projections
+TEST_F(ProjectionsTest, LORListOrdering)
+{
+  const auto nSubsets = 2;
+  const LORList lorList(mProj, mScanner, mVol, nSubsets);
+  const LORList orderedLORList(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    0.0,
+    LORList::Ordering::MORTON);
+
+  auto nMoved = 0;
+  LOOP(subset, 0, nSubsets - 1)
+  LOOP_SEG(seg, mProj)
+  {
+    const auto nLORs = lorList.getNLORs(subset, seg);
+    ASSERT_EQ(orderedLORList.getNLORs(subset, seg), nLORs);
+
+    std::vector<int> indices(nLORs);
+    LOOP(position, 0, nLORs - 1)
+    {
+      indices[position] =
+        orderedLORList.getOrderedIndex(subset, seg, position);
+      if (
+        indices[position] !=
+        lorList.getIndex(subset, seg, position))
+      {
+        nMoved++;
+      }
+    }
+    std::sort(indices.begin(), indices.end());
+
+    LOOP(position, 0, nLORs - 1)
+    {
+      EXPECT_EQ(
+        indices[position],
+        lorList.getIndex(subset, seg, position));
+    }
+  }
+  EXPECT_GT(nMoved, 0);
+
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(
+    mVol,
+    mScanner,
+    reference,
+    nullptr,
+    projections::Projector::PACKET,
+    0,
+    &lorList);
+
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(
+    mVol,
+    mScanner,
+    proj,
+    nullptr,
+    projections::Projector::PACKET,
+    0,
+    &orderedLORList);
+  EXPECT_LT(maxRelativeDifference(reference, proj), TOLERANCE);
+
+  VolData referenceVol;
+  referenceVol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    reference,
+    mScanner,
+    referenceVol,
+    nSubsets,
+    nullptr,
+    projections::Projector::PACKET,
+    projections::Accumulation::ATOMIC,
+    0.0,
+    0,
+    &lorList);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    reference,
+    mScanner,
+    vol,
+    nSubsets,
+    nullptr,
+    projections::Projector::PACKET,
+    projections::Accumulation::ATOMIC,
+    0.0,
+    0,
+    &orderedLORList);
+  EXPECT_LT(
+    maxRelativeDifference(referenceVol, vol),
+    TOLERANCE);
+}
+
+// Lists of non-zero bins keep the LORs of the lists whose bin
+// is not zero, in the same order
+TEST_F(ProjectionsTest, LORListNonZeroBins)
+{
+  const auto nSubsets = 2;
+
+  // Sparse projection
+  projections::forward(mVol, mScanner, mProj);
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<float> distribution(0, 1);
+  LOOP_SEG(seg, mProj)
+  {
+    const auto nBinsInSegment =
+      mProj.getGeometry().nViews *
+      mProj.getGeometry().getNAxialCoords(seg) *
+      mProj.getHeader().nTangCoords;
+
+    LOOP(binIndex, 0, nBinsInSegment - 1)
+    {
+      if (distribution(generator) < 0.9)
+      {
+        BIN(mProj, seg, binIndex) = 0.0;
+      }
+    }
+  }
+
+  const LORList lorList(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    0.0,
+    LORList::Ordering::MORTON);
+  const LORList nonZeroLORList(lorList, mProj);
+
+  EXPECT_THROW(
+    nonZeroLORList.checkConfiguration(mProj, mVol, nSubsets),
+    std::runtime_error);
+  EXPECT_NO_THROW(nonZeroLORList.checkConfiguration(
+    mProj,
+    mVol,
+    nSubsets,
+    0.0,
+    true));
+
+  const LORCache cache(mProj, nSubsets);
+
+  LOOP(subset, 0, nSubsets - 1)
+  LOOP_SEG(seg, mProj)
+  {
+    const auto isNonZero = [&](int index)
+    {
+      const auto binIndex =
+        std::get<1>(cache.getLOR(subset, seg, index));
+
+      return BIN(mProj, seg, binIndex) != 0.0;
+    };
+
+    std::vector<int> indices;
+    std::vector<int> orderedIndices;
+    LOOP(position, 0, lorList.getNLORs(subset, seg) - 1)
+    {
+      const auto index =
+        lorList.getIndex(subset, seg, position);
+      if (isNonZero(index))
+      {
+        indices.push_back(index);
+      }
+
+      const auto orderedIndex =
+        lorList.getOrderedIndex(subset, seg, position);
+      if (isNonZero(orderedIndex))
+      {
+        orderedIndices.push_back(orderedIndex);
+      }
+    }
+
+    ASSERT_EQ(
+      nonZeroLORList.getNLORs(subset, seg),
+      (int)indices.size());
+    LOOP(position, 0, (int)indices.size() - 1)
+    {
+      EXPECT_EQ(
+        nonZeroLORList.getIndex(subset, seg, position),
+        indices[position]);
+      EXPECT_EQ(
+        nonZeroLORList.getOrderedIndex(subset, seg, position),
+        orderedIndices[position]);
+    }
+  }
+}
+
+// Fused OSEM updates give the same volumes as the separate
+// operations
+TEST_F(ProjectionsTest, FusedOSEMUpdate)
+{
+  const auto cutRadius = 60.0f;
+
+  // Random volumes with voxels at zero
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> distribution(-0.2, 1);
+  const auto getRandomVol = [&]()
+  {
+    VolData vol(mVol, VolData::ConstructionMode::ALLOCATE);
+    LOOP(i, 0, vol.getNVoxelsPerFrame() - 1)
+    {
+      vol.getDataArray()[i] =
+        MAX(0.0f, distribution(generator));
+    }
+    return vol;
+  };
+
+  auto backProj = getRandomVol();
+  const auto sensVol = getRandomVol();
+  operations::cutCircle(mVol, cutRadius);
+
+  const auto circleRows =
+    operations::getCircleRows(mVol, cutRadius);
+
+  // OSEM
+  VolData reference(mVol, VolData::ConstructionMode::READ_DATA);
+  VolData referenceBackProj(
+    backProj,
+    VolData::ConstructionMode::READ_DATA);
+  referenceBackProj /= sensVol;
+  reference *= referenceBackProj;
+  operations::cutCircle(reference, cutRadius);
+
+  VolData vol(mVol, VolData::ConstructionMode::READ_DATA);
+  VolData fusedBackProj(
+    backProj,
+    VolData::ConstructionMode::READ_DATA);
+  operations::updateOSEM(
+    vol,
+    fusedBackProj,
+    sensVol,
+    circleRows);
+
+  const auto* referenceDataArray = reference.getDataArray();
+  LOOP(i, 0, vol.getNVoxelsPerFrame() - 1)
+  {
+    ASSERT_EQ(vol.getDataArray()[i], referenceDataArray[i]);
+    ASSERT_EQ(fusedBackProj.getDataArray()[i], 0.0);
+  }
+
+  // OSEM_ResoReco
+  reference.assign(mVol);
+  reference /= sensVol;
+  reference *= backProj;
+  operations::cutCircle(reference, cutRadius);
+
+  vol.assign(mVol);
+  VolData blur(mVol, VolData::ConstructionMode::ALLOCATE);
+  operations::updateOSEM_ResoReco(
+    vol,
+    backProj,
+    sensVol,
+    circleRows,
+    &blur);
+
+  LOOP(i, 0, vol.getNVoxelsPerFrame() - 1)
+  {
+    ASSERT_EQ(vol.getDataArray()[i], referenceDataArray[i]);
+    ASSERT_EQ(blur.getDataArray()[i], referenceDataArray[i]);
+    ASSERT_EQ(backProj.getDataArray()[i], 0.0);
+  }
+}
+
+// Gaussian filter gives the normalized sums of the voxels
+// weighted by the kernel, keeps the voxels far from the center
+// with a cut radius, and filters all frames the same way
+TEST_F(ProjectionsTest, GaussianFilter)
+{
+  const std::vector<float> fwhmXYZ{8.0, 6.0, 4.0};
+  const auto cutRadius = 70.0f;
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, 2);
+  LOOP(frame, 0, 1)
+  {
+    vol.setActiveFrame(frame);
+    std::copy(
+      mVol.getDataArray(),
+      mVol.getDataArray() + mVol.getNVoxelsPerFrame(),
+      vol.getDataArray());
+  }
+
+  GaussianFilter filter(mVol, fwhmXYZ, cutRadius);
+  filter.apply(vol);
+
+  const auto& volSize = mVol.getHeader().volSize;
+  const auto& voxelExtent = mVol.getHeader().voxelExtent;
+  const std::vector<double> sigmas{
+    fwhmXYZ[0] / 2.3548 / voxelExtent.pixelWidth,
+    fwhmXYZ[1] / 2.3548 / voxelExtent.pixelHeight,
+    fwhmXYZ[2] / 2.3548 / voxelExtent.sliceThickness};
+  const std::vector<int> halfSizes{3, 2, 3};
+
+  // Voxels near the center and at the edges
+  for (const auto& [i, j, k] :
+       std::vector<std::tuple<int, int, int>>{
+         {20, 20, 7},
+         {18, 23, 0},
+         {0, 20, 14}})
+  {
+    double sum{0.0};
+    double norm{0.0};
+    LOOP(di, -halfSizes[0], halfSizes[0])
+    LOOP(dj, -halfSizes[1], halfSizes[1])
+    LOOP(dk, -halfSizes[2], halfSizes[2])
+    {
+      if (
+        i + di < 0 || i + di >= volSize.nPixelsX ||
+        j + dj < 0 || j + dj >= volSize.nPixelsY ||
+        k + dk < 0 || k + dk >= volSize.nSlices)
+      {
+        continue;
+      }
+
+      const auto weight = std::exp(
+        -di * di / (2 * sigmas[0] * sigmas[0]) -
+        dj * dj / (2 * sigmas[1] * sigmas[1]) -
+        dk * dk / (2 * sigmas[2] * sigmas[2]));
+      sum += weight * mVol.getVoxel(i + di, j + dj, k + dk);
+      norm += weight;
+    }
+
+    // Voxels far from the center keep their values
+    const auto expected =
+      i == 0 ? mVol.getVoxel(i, j, k) : sum / norm;
+
+    LOOP(frame, 0, 1)
+    {
+      vol.setActiveFrame(frame);
+      EXPECT_NEAR(vol.getVoxel(i, j, k), expected, 1e-5);
+    }
+  }
+}
+
+// Recursive and FFT backends give the filtering of the direct
+// backend, approximately for the recursive one
+TEST_F(ProjectionsTest, GaussianFilterBackends)
+{
+  const std::vector<float> fwhmXYZ{20.0, 20.0, 20.0};
+
+  VolData direct(mVol);
+  GaussianFilter(
+    mVol,
+    fwhmXYZ,
+    0.0,
+    GaussianFilter::Backend::DIRECT)
+    .apply(direct);
+
+  // Kernel in Z has more voxels on a side than direct filtering
+  // is used for
+  GaussianFilter recursiveFilter(mVol, fwhmXYZ);
+  EXPECT_EQ(
+    recursiveFilter.getBackend(),
+    GaussianFilter::Backend::RECURSIVE);
+
+  VolData recursive(mVol);
+  recursiveFilter.apply(recursive);
+  EXPECT_LT(maxRelativeDifference(direct, recursive), 2e-2);
+
+  VolData fft(mVol);
+  GaussianFilter(
+    mVol,
+    fwhmXYZ,
+    0.0,
+    GaussianFilter::Backend::FFT)
+    .apply(fft);
+  EXPECT_LT(maxRelativeDifference(direct, fft), 1e-5);
+}
+
+// Measured kernel is applied as is, and mirrored for the
+// adjoint
+TEST_F(ProjectionsTest, GaussianFilterMeasuredKernel)
+{
+  VolData kernel(VolHeader{
+    {3, 3, 3},
+    mVol.getHeader().voxelExtent,
+    {0.0, 0.0, 0.0},
+    1
+  });
+  std::fill_n(kernel.getDataArray(), 27, 0.0);
+  kernel.setVoxel(1, 1, 1, 1.0);
+  kernel.setVoxel(2, 1, 1, 0.5);
+
+  VolData vol(mVol);
+  GaussianFilter(mVol, kernel, {0.0, 0.0, 0.0}).apply(vol);
+
+  VolData adjointVol(mVol);
+  GaussianFilter(mVol, kernel, {0.0, 0.0, 0.0}, 0.0, true)
+    .apply(adjointVol);
+
+  for (const auto& [i, j, k] :
+       std::vector<std::tuple<int, int, int>>{
+         {20, 20, 7},
+         {1, 0, 14}})
+  {
+    const auto value = mVol.getVoxel(i, j, k);
+
+    EXPECT_NEAR(
+      vol.getVoxel(i, j, k),
+      (value + 0.5 * mVol.getVoxel(i - 1, j, k)) / 1.5,
+      1e-5);
+    EXPECT_NEAR(
+      adjointVol.getVoxel(i, j, k),
+      (value + 0.5 * mVol.getVoxel(i + 1, j, k)) / 1.5,
+      1e-5);
+  }
+}
+
+// Paths are shifted axially only if the slices of the volume
+// have the spacing of those of the scanner
+TEST_F(ProjectionsTest, AxiallyAligned)
+{
+  EXPECT_TRUE(Siddon(mVol).isAxiallyAligned(mScanner));
+
+  const VolData thinSliceVol(VolHeader{
+    {   40,    40,  30},
+    {  4.0,   4.0, 1.0},
+    {-78.0, -78.0, 0.0},
+    1
+  });
+  EXPECT_FALSE(Siddon(thinSliceVol).isAxiallyAligned(mScanner));
+}
+
+// Symmetries of the scanner reduce the number of LORs traced,
+// less with subsets
+TEST_F(ProjectionsTest, Symmetries)
+{
+  const auto nLORs =
+    mProj.getGeometry().nViews * mProj.getHeader().nTangCoords;
+
+  const Symmetries symmetries(mProj, mScanner, mVol);
+  EXPECT_EQ(symmetries.getNSymmetries(), 7);
+  EXPECT_LE(symmetries.getNFundamentalLORs(), nLORs / 7);
+
+  const Symmetries subsetSymmetries(mProj, mScanner, mVol, 4);
+  EXPECT_LT(
+    symmetries.getNFundamentalLORs(),
+    subsetSymmetries.getNFundamentalLORs());
+  EXPECT_LT(subsetSymmetries.getNFundamentalLORs(), nLORs);
+}
+
+// Symmetric projector gives the same forward projection, with
+// and without symmetric system matrix
+TEST_F(ProjectionsTest, ForwardSymmetric)
+{
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+
+  SystemMatrix systemMatrix(
+    mProj,
+    mScanner,
+    mVol,
+    1,
+    0.0,
+    "",
+    true);
+
+  const SystemMatrix* systemMatrices[]{nullptr, &systemMatrix};
+  for (const auto* systemMatrixPtr : systemMatrices)
+  {
+    ProjData proj(
+      mProj,
+      ProjData::ConstructionMode::ALLOCATE);
+    projections::forward(
+      mVol,
+      mScanner,
+      proj,
+      systemMatrixPtr,
+      projections::Projector::SYMMETRIC);
+
+    EXPECT_LT(
+      maxRelativeDifference(reference, proj),
+      FACTORIZED_TOLERANCE);
+  }
+}
+
+// Symmetric projector gives the same back projection
+TEST_F(ProjectionsTest, BackwardSymmetric)
+{
+  const auto nSubsets = 4;
+
+  projections::forward(mVol, mScanner, mProj);
+
+  VolData reference;
+  reference.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(mProj, mScanner, reference, nSubsets);
+
+  VolData vol;
+  vol.allocateAsMultiVol(mVol, nSubsets);
+  projections::backward(
+    mProj,
+    mScanner,
+    vol,
+    nSubsets,
+    nullptr,
+    projections::Projector::SYMMETRIC);
+
+  EXPECT_LT(
+    maxRelativeDifference(reference, vol),
+    FACTORIZED_TOLERANCE);
+}
+
+// System matrix is saved and read back for the same
+// configuration only
+TEST_F(ProjectionsTest, SystemMatrixFile)
+{
+  const auto fileName = testing::TempDir() + "systemMatrix.bin";
+  std::remove(fileName.c_str());
+
+  SystemMatrix computed(
+    mProj,
+    mScanner,
+    mVol,
+    2,
+    0.0,
+    fileName);
+  EXPECT_FALSE(computed.wasReadFromFile());
+
+  SystemMatrix read(
+    mProj,
+    mScanner,
+    mVol,
+    2,
+    0.0,
+    fileName);
+  EXPECT_TRUE(read.wasReadFromFile());
+  EXPECT_DOUBLE_EQ(computed.getMemoryMB(), read.getMemoryMB());
+
+  // Different number of subsets: Recomputed
+  SystemMatrix recomputed(
+    mProj,
+    mScanner,
+    mVol,
+    4,
+    0.0,
+    fileName);
+  EXPECT_FALSE(recomputed.wasReadFromFile());
+
+  // Matrix left incomplete by a memory budget: Read with the
+  // same budget, computed again without budget
+  std::remove(fileName.c_str());
+  SystemMatrix partial(mProj, mScanner, mVol, 2, 5.0, fileName);
+  EXPECT_LT(partial.getMemoryMB(), computed.getMemoryMB());
+
+  SystemMatrix partialRead(
+    mProj,
+    mScanner,
+    mVol,
+    2,
+    5.0,
+    fileName);
+  EXPECT_TRUE(partialRead.wasReadFromFile());
+  EXPECT_DOUBLE_EQ(
+    partial.getMemoryMB(),
+    partialRead.getMemoryMB());
+
+  SystemMatrix completed(
+    mProj,
+    mScanner,
+    mVol,
+    2,
+    0.0,
+    fileName);
+  EXPECT_FALSE(completed.wasReadFromFile());
+  EXPECT_DOUBLE_EQ(
+    computed.getMemoryMB(),
+    completed.getMemoryMB());
+
+  // Complete matrix read with a smaller budget: Reading stops
+  // within a subset, with the blocks a computation with this
+  // budget stores, and projects as the matrix computed
+  std::remove(fileName.c_str());
+  const auto nSubsets = 24;
+  SystemMatrix complete(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    0.0,
+    fileName);
+  const auto maxMemoryMB = 0.02 * complete.getMemoryMB();
+
+  SystemMatrix budgetRead(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    maxMemoryMB,
+    fileName);
+  EXPECT_TRUE(budgetRead.wasReadFromFile());
+  EXPECT_GT(budgetRead.getMemoryMB(), 0.0);
+  EXPECT_LE(budgetRead.getMemoryMB(), maxMemoryMB);
+
+  const SystemMatrix budgetComputed(
+    mProj,
+    mScanner,
+    mVol,
+    nSubsets,
+    maxMemoryMB);
+  EXPECT_DOUBLE_EQ(
+    budgetComputed.getMemoryMB(),
+    budgetRead.getMemoryMB());
+
+  ProjData reference(
+    mProj,
+    ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, reference);
+  ProjData proj(mProj, ProjData::ConstructionMode::ALLOCATE);
+  projections::forward(mVol, mScanner, proj, &budgetRead);
+  EXPECT_LT(maxRelativeDifference(reference, proj), TOLERANCE);
+
+  std::remove(fileName.c_str());
+}
@@ -1,5 +1,6 @@
 #include <Siddon.h>
 #include <VolData.h>
+#include <operations.h>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -7,12 +8,19 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <exception>
 #include <numeric>
+#include <random>
+#include <type_traits>
 #include <vector>
 
 namespace
 {
-const double TOLERANCE = 1e-7;
+// Single precision paths (FIR_SINGLE_PRECISION_PATHS)
+constexpr bool SINGLE_PRECISION =
+  std::is_same_v<types::PathExtent, float>;
+
+const double TOLERANCE = SINGLE_PRECISION ? 1e-4 : 1e-7;
 
 void CheckPath(
   const int line,
@@ -421,3 +429,556 @@ TEST(SiddonUnitTest, LongPaths)
     expectedIndices2,
     expectedLengths2);
 }
+
+// Paths of a packet are the same as paths computed one by one
+TEST(SiddonUnitTest, PacketPaths)
+{
+  VolData vol({
+    {  10,   12,  5},
+    { 2.0,  3.0, 4.0},
+    {-9.0, 10.0, 0.0},
+    1
+  });
+
+  // Packets of each instruction set supported by the CPU
+  for (const auto packetSize :
+       Siddon::getSupportedPacketSizes())
+  {
+    SCOPED_TRACE(packetSize);
+
+    Siddon siddon(vol, 0.0, packetSize);
+    ASSERT_EQ(siddon.getPacketSize(), packetSize);
+
+    std::vector<types::PathElement*> packetPathElements(
+      packetSize);
+    for (auto lane = 0; lane < packetSize; ++lane)
+    {
+      packetPathElements[lane] =
+        siddon.getThreadLocalPathElements(lane);
+    }
+
+    // Separate path element vector for reference paths
+    std::vector<types::PathElement> pathElements(
+      10 + 12 + 5);
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(
+      -60.0,
+      60.0);
+
+    for (auto packetIndex = 0; packetIndex < 500; ++packetIndex)
+    {
+      // Full and partial packets
+      const auto nLORs = 1 + packetIndex % packetSize;
+
+      Siddon::Packet packet;
+      for (auto lane = 0; lane < nLORs; ++lane)
+      {
+        types::SpatialCoord* crys1[]{
+          &packet.crys1X[lane],
+          &packet.crys1Y[lane],
+          &packet.crys1Z[lane]};
+        types::SpatialCoord* crys2[]{
+          &packet.crys2X[lane],
+          &packet.crys2Y[lane],
+          &packet.crys2Z[lane]};
+
+        for (auto dim = 0; dim < 3; ++dim)
+        {
+          *crys1[dim] = distribution(generator);
+          *crys2[dim] = distribution(generator);
+        }
+
+        // Some LORs without component along a dimension
+        if (lane % 3 == 1)
+        {
+          *crys2[lane % 2 * 2] = *crys1[lane % 2 * 2];
+        }
+      }
+      packet.nLORs = nLORs;
+
+      bool crosses[Siddon::MAX_PACKET_SIZE];
+      siddon.computePathPacket(
+        packet,
+        packetPathElements.data(),
+        crosses);
+
+      for (auto lane = 0; lane < nLORs; ++lane)
+      {
+        const auto expectedCrosses = siddon.computePath(
+          packet.crys1X[lane],
+          packet.crys1Y[lane],
+          packet.crys1Z[lane],
+          packet.crys2X[lane],
+          packet.crys2Y[lane],
+          packet.crys2Z[lane],
+          pathElements.data());
+
+        ASSERT_EQ(crosses[lane], expectedCrosses);
+
+        const auto* actual = packetPathElements[lane];
+        auto pathIndex = 0;
+        for (; pathElements[pathIndex].coord != -1; ++pathIndex)
+        {
+          ASSERT_EQ(
+            actual[pathIndex].coord,
+            pathElements[pathIndex].coord);
+          ASSERT_NEAR(
+            actual[pathIndex].length,
+            pathElements[pathIndex].length,
+            TOLERANCE);
+        }
+
+        ASSERT_EQ(actual[pathIndex].coord, -1);
+      }
+    }
+  }
+
+  // Packet size of no instruction set
+  EXPECT_THROW(Siddon(vol, 0.0, 3), std::exception);
+}
+
+TEST(SiddonUnitTest, TransaxialPaths)
+{
+  VolData vol({
+    {  10,   12,  5},
+    { 2.0,  3.0, 4.0},
+    {-9.0, 10.0, 0.0},
+    1
+  });
+
+  Siddon siddon(vol);
+
+  const auto nVoxels = vol.getNVoxelsPerFrame();
+
+  std::vector<types::PathElement> pathElements(
+    10 + 12 + 5);
+  std::vector<types::PathElement> expectedPathElements(
+    10 + 12 + 5);
+
+  Siddon::TransaxialPath transaxialPath;
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> distribution(
+    -60.0,
+    60.0);
+
+  for (auto lorIndex = 0; lorIndex < 200; ++lorIndex)
+  {
+    double crys1[3], crys2[3];
+    for (auto dim = 0; dim < 3; ++dim)
+    {
+      crys1[dim] = distribution(generator);
+      crys2[dim] = distribution(generator);
+    }
+
+    // Some LORs without component along X or Y
+    if (lorIndex % 5 == 1)
+    {
+      crys2[lorIndex % 2] = crys1[lorIndex % 2];
+    }
+
+    siddon.computeTransaxialPath(
+      crys1[0],
+      crys1[1],
+      crys2[0],
+      crys2[1],
+      transaxialPath);
+
+    // Same transaxial path for several axial coordinates
+    for (auto zIndex = 0; zIndex < 10; ++zIndex)
+    {
+      // Some LORs without component along Z
+      if (zIndex > 0)
+      {
+        crys1[2] = distribution(generator);
+        crys2[2] = zIndex % 4 == 1 ? crys1[2] :
+                                     distribution(generator);
+      }
+
+      const auto expectedCrosses = siddon.computePath(
+        crys1[0],
+        crys1[1],
+        crys1[2],
+        crys2[0],
+        crys2[1],
+        crys2[2],
+        expectedPathElements.data());
+
+      const auto crosses = siddon.computePathFromTransaxial(
+        transaxialPath,
+        crys1[2],
+        crys2[2],
+        pathElements.data());
+
+      ASSERT_EQ(crosses, expectedCrosses);
+
+      // Length of the LOR in each voxel
+      // Note: Planes crossed at the same point within
+      // tolerance can give different path elements
+      std::vector<double> lengths(nVoxels, 0.0);
+      std::vector<double> expectedLengths(nVoxels, 0.0);
+      for (auto i = 0; pathElements[i].coord != -1; ++i)
+      {
+        lengths[pathElements[i].coord] +=
+          pathElements[i].length;
+      }
+      for (auto i = 0; expectedPathElements[i].coord != -1; ++i)
+      {
+        expectedLengths[expectedPathElements[i].coord] +=
+          expectedPathElements[i].length;
+      }
+
+      for (auto voxel = 0; voxel < nVoxels; ++voxel)
+      {
+        ASSERT_NEAR(
+          lengths[voxel],
+          expectedLengths[voxel],
+          1e-3);
+      }
+    }
+  }
+}
+
+// Paths clipped to a cylinder have the lengths of the full
+// paths in the voxels kept by operations::cutCircle, with the
+// scalar, packet and transaxial paths
+TEST(SiddonUnitTest, ClippedPaths)
+{
+  VolData vol({
+    {  10,   12,  5},
+    { 2.0,  3.0, 4.0},
+    {-9.0, 10.0, 0.0},
+    1
+  });
+
+  const auto cutRadius = 8.0;
+
+  Siddon siddon(vol);
+  Siddon clippedSiddon(vol, cutRadius);
+
+  const auto circleRows =
+    operations::getCircleRows(vol, cutRadius);
+  const auto nPixelsX = vol.getHeader().volSize.nPixelsX;
+  const auto nPixelsY = vol.getHeader().volSize.nPixelsY;
+  const auto nVoxels = vol.getNVoxelsPerFrame();
+
+  const auto packetSize = clippedSiddon.getPacketSize();
+
+  std::vector<types::PathElement*> packetPathElements(
+    packetSize);
+  for (auto lane = 0; lane < packetSize; ++lane)
+  {
+    packetPathElements[lane] =
+      clippedSiddon.getThreadLocalPathElements(lane);
+  }
+
+  std::vector<types::PathElement> pathElements(
+    10 + 12 + 5);
+  std::vector<types::PathElement> clippedPathElements(
+    10 + 12 + 5);
+  std::vector<types::PathElement> transaxialPathElements(
+    10 + 12 + 5);
+
+  Siddon::TransaxialPath transaxialPath;
+
+  // Length of the LOR in each voxel
+  const auto getLengths =
+    [nVoxels](const types::PathElement* path)
+  {
+    std::vector<double> lengths(nVoxels, 0.0);
+    for (auto i = 0; path[i].coord != -1; ++i)
+    {
+      lengths[path[i].coord] += path[i].length;
+    }
+
+    return lengths;
+  };
+
+  // Voxels crossed by the full paths only
+  auto nClippedVoxels = 0;
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> distribution(
+    -60.0,
+    60.0);
+
+  for (auto packetIndex = 0; packetIndex < 100; ++packetIndex)
+  {
+    Siddon::Packet packet;
+    for (auto lane = 0; lane < packetSize; ++lane)
+    {
+      packet.crys1X[lane] = distribution(generator);
+      packet.crys1Y[lane] = distribution(generator);
+      packet.crys1Z[lane] = distribution(generator);
+      packet.crys2X[lane] = distribution(generator);
+      packet.crys2Y[lane] = distribution(generator);
+      packet.crys2Z[lane] = distribution(generator);
+    }
+    packet.nLORs = packetSize;
+
+    bool crosses[Siddon::MAX_PACKET_SIZE];
+    clippedSiddon.computePathPacket(
+      packet,
+      packetPathElements.data(),
+      crosses);
+
+    for (auto lane = 0; lane < packetSize; ++lane)
+    {
+      siddon.computePath(
+        packet.crys1X[lane],
+        packet.crys1Y[lane],
+        packet.crys1Z[lane],
+        packet.crys2X[lane],
+        packet.crys2Y[lane],
+        packet.crys2Z[lane],
+        pathElements.data());
+
+      const auto clippedCrosses = clippedSiddon.computePath(
+        packet.crys1X[lane],
+        packet.crys1Y[lane],
+        packet.crys1Z[lane],
+        packet.crys2X[lane],
+        packet.crys2Y[lane],
+        packet.crys2Z[lane],
+        clippedPathElements.data());
+
+      ASSERT_EQ(crosses[lane], clippedCrosses);
+
+      clippedSiddon.computeTransaxialPath(
+        packet.crys1X[lane],
+        packet.crys1Y[lane],
+        packet.crys2X[lane],
+        packet.crys2Y[lane],
+        transaxialPath);
+      clippedSiddon.computePathFromTransaxial(
+        transaxialPath,
+        packet.crys1Z[lane],
+        packet.crys2Z[lane],
+        transaxialPathElements.data());
+
+      const auto lengths = getLengths(pathElements.data());
+      const auto clippedLengths =
+        getLengths(clippedPathElements.data());
+      const auto packetLengths =
+        getLengths(packetPathElements[lane]);
+      const auto transaxialLengths =
+        getLengths(transaxialPathElements.data());
+
+      for (auto voxel = 0; voxel < nVoxels; ++voxel)
+      {
+        const auto i = voxel % nPixelsX;
+        const auto j = voxel / nPixelsX % nPixelsY;
+        const auto [firstX, endX] = circleRows[j];
+
+        // Clipped paths only miss voxels outside the circle
+        if (i >= firstX && i < endX)
+        {
+          ASSERT_NEAR(
+            clippedLengths[voxel],
+            lengths[voxel],
+            1e-3);
+        }
+        else
+        {
+          ASSERT_LE(
+            clippedLengths[voxel],
+            lengths[voxel] + 1e-3);
+
+          nClippedVoxels += lengths[voxel] > 0.0 &&
+            clippedLengths[voxel] == 0.0;
+        }
+
+        ASSERT_NEAR(
+          packetLengths[voxel],
+          clippedLengths[voxel],
+          1e-3);
+        ASSERT_NEAR(
+          transaxialLengths[voxel],
+          clippedLengths[voxel],
+          1e-3);
+      }
+    }
+  }
+
+  ASSERT_GT(nClippedVoxels, 0);
+}
+
+// Line integrals accumulated during traversal are the same as
+// those of the stored paths
+TEST(SiddonUnitTest, TracedLineIntegrals)
+{
+  VolData vol({
+    {  10,   12,  5},
+    { 2.0,  3.0, 4.0},
+    {-9.0, 10.0, 0.0},
+    1
+  });
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> voxelDistribution(0, 1);
+  for (auto i = 0; i < vol.getNVoxelsPerFrame(); ++i)
+  {
+    vol.getDataArray()[i] = voxelDistribution(generator);
+  }
+
+  Siddon siddon(vol);
+
+  std::vector<types::PathElement> pathElements(
+    10 + 12 + 5);
+
+  Siddon::TransaxialPath transaxialPath;
+
+  std::uniform_real_distribution<double> distribution(
+    -60.0,
+    60.0);
+
+  for (auto lorIndex = 0; lorIndex < 200; ++lorIndex)
+  {
+    double crys1[3], crys2[3];
+    for (auto dim = 0; dim < 3; ++dim)
+    {
+      crys1[dim] = distribution(generator);
+      crys2[dim] = distribution(generator);
+    }
+
+    const auto* dataArray = vol.getDataArray();
+
+    types::VoxelValue line{0.0};
+    const auto crosses = siddon.trace(
+      crys1[0],
+      crys1[1],
+      crys1[2],
+      crys2[0],
+      crys2[1],
+      crys2[2],
+      [&](types::Index coord, types::PathExtent length)
+      {
+        line += length * dataArray[coord];
+      });
+
+    const auto expectedCrosses = siddon.computePath(
+      crys1[0],
+      crys1[1],
+      crys1[2],
+      crys2[0],
+      crys2[1],
+      crys2[2],
+      pathElements.data());
+
+    ASSERT_EQ(crosses, expectedCrosses);
+    ASSERT_EQ(
+      line,
+      vol.computeLineIntegral(pathElements.data()));
+
+    siddon.computeTransaxialPath(
+      crys1[0],
+      crys1[1],
+      crys2[0],
+      crys2[1],
+      transaxialPath);
+
+    line = 0.0;
+    const auto transaxialCrosses = siddon.traceFromTransaxial(
+      transaxialPath,
+      crys1[2],
+      crys2[2],
+      [&](types::Index coord, types::PathExtent length)
+      {
+        line += length * dataArray[coord];
+      });
+
+    const auto expectedTransaxialCrosses =
+      siddon.computePathFromTransaxial(
+        transaxialPath,
+        crys1[2],
+        crys2[2],
+        pathElements.data());
+
+    ASSERT_EQ(transaxialCrosses, expectedTransaxialCrosses);
+    ASSERT_EQ(
+      line,
+      vol.computeLineIntegral(pathElements.data()));
+  }
+}
+
+// Total length of the path is the length of the LOR inside the
+// volume computed in double precision, also with single
+// precision paths
+TEST(SiddonUnitTest, PathPrecision)
+{
+  EXPECT_EQ(
+    sizeof(types::PathElement),
+    SINGLE_PRECISION ? 8u : 16u);
+
+  VolData vol({
+    {  10,   12,  5},
+    { 2.0,  3.0, 4.0},
+    {-9.0, 10.0, 0.0},
+    1
+  });
+
+  Siddon siddon(vol);
+
+  std::vector<types::PathElement> pathElements(
+    10 + 12 + 5);
+
+  // Borders of the volume
+  const double lowPlanes[]{-10.0, 8.5, -10.0};
+  const double highPlanes[]{10.0, 44.5, 10.0};
+
+  // Error of single precision alpha accumulated along the path
+  const auto lengthTolerance = SINGLE_PRECISION ? 1e-3 : 1e-7;
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> distribution(
+    -60.0,
+    60.0);
+
+  for (auto lorIndex = 0; lorIndex < 1000; ++lorIndex)
+  {
+    double crys1[3], crys2[3];
+    for (auto dim = 0; dim < 3; ++dim)
+    {
+      crys1[dim] = distribution(generator);
+      crys2[dim] = distribution(generator);
+    }
+
+    const auto crosses = siddon.computePath(
+      crys1[0],
+      crys1[1],
+      crys1[2],
+      crys2[0],
+      crys2[1],
+      crys2[2],
+      pathElements.data());
+
+    // Clip the LOR to the volume
+    auto alphaMin = 0.0;
+    auto alphaMax = 1.0;
+    auto d12 = 0.0;
+    for (auto dim = 0; dim < 3; ++dim)
+    {
+      const auto diff = crys2[dim] - crys1[dim];
+      const auto alpha1 = (lowPlanes[dim] - crys1[dim]) / diff;
+      const auto alpha2 = (highPlanes[dim] - crys1[dim]) / diff;
+
+      alphaMin = std::max(alphaMin, std::min(alpha1, alpha2));
+      alphaMax = std::min(alphaMax, std::max(alpha1, alpha2));
+      d12 += diff * diff;
+    }
+
+    const auto expectedLength =
+      std::max(0.0, alphaMax - alphaMin) * std::sqrt(d12);
+
+    ASSERT_EQ(crosses, expectedLength > 0.0);
+
+    auto length = 0.0;
+    for (auto i = 0; pathElements[i].coord != -1; ++i)
+    {
+      length += pathElements[i].length;
+    }
+
+    ASSERT_NEAR(length, expectedLength, lengthTolerance);
+  }
+}